@@ -22,6 +22,8 @@
     #include <sys/types.h>
 #endif
 
+#include <chrono>
+
 #include "GraphicsWindow.h"
 
 GraphicsWindow::GraphicsWindow(QWidget* parent) : QWidget(parent)
@@ -75,11 +77,11 @@ GraphicsWindow::~GraphicsWindow()
 #elif defined(Q_OS_LINUX)
 	// Linux-specific code
 	shm_unlink(MAPPED_NAME);
-	munmap(memptr, MEM_SIZE);
+	munmap(memptr, memSize);
 #elif defined(Q_OS_MAC)
 	// macOS-specific code
 	shm_unlink(MAPPED_NAME);
-	munmap(memptr, MEM_SIZE);
+	munmap(memptr, memSize);
 #endif
 
 }
@@ -133,11 +135,14 @@ void GraphicsWindow::test()
 
 uchar* GraphicsWindow::setupMemMap()
 {
+	// Versioned layout shared with the emulator, see shm_layout.h
+	memSize = shmBlockSize();
+
 	#ifdef Q_OS_WIN
 		// Windows-specific code
 
 	// Create Mapping
-	handle = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, MEM_SIZE, (LPCWSTR)MAPPED_NAME);
+	handle = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)memSize, (LPCWSTR)MAPPED_NAME);
 
 	if (handle == NULL) {
 		qDebug() << "Error mapping memory";
@@ -145,7 +150,7 @@ uchar* GraphicsWindow::setupMemMap()
 	}
 
 	// Get Map location
-	memptr = (uchar*)MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, MEM_SIZE);
+	memptr = (uchar*)MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, memSize);
 
 	if (memptr == NULL) {
 		qDebug() << "Error accessing memory";
@@ -154,9 +159,11 @@ uchar* GraphicsWindow::setupMemMap()
 	}
 
 	// Initiallizing memory
-	memset(memptr, 0, MEM_SIZE);
-	map = memptr + 0x2400;
-	ports = memptr + 0x10000;
+	memset(memptr, 0, memSize);
+	initShmHeader(memptr);
+	if (!useSharedRegions()) {
+		return nullptr;
+	}
 
 	#elif defined(Q_OS_LINUX)
 	    // Linux-specific code
@@ -168,14 +175,14 @@ uchar* GraphicsWindow::setupMemMap()
         }
 
         // Set the size of the shared memory
-        if (ftruncate(fd, MEM_SIZE) == -1) {
+        if (ftruncate(fd, memSize) == -1) {
             qDebug() << "Error setting size of shared memory";
             ::close(fd);
             return nullptr;
         }
 
         // Get Map location
-        memptr = static_cast<uchar*>(mmap(NULL, MEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        memptr = static_cast<uchar*>(mmap(NULL, memSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
         if (memptr == MAP_FAILED) {
             qDebug() << "Error accessing memory";
             ::close(fd);
@@ -185,9 +192,11 @@ uchar* GraphicsWindow::setupMemMap()
         ::close(fd);
 
         // Set up specific regions
-        memset(memptr, 0, MEM_SIZE);
-        map = memptr + 0x2400;
-        ports = memptr + 0x10000;
+        memset(memptr, 0, memSize);
+        initShmHeader(memptr);
+        if (!useSharedRegions()) {
+            return nullptr;
+        }
 
 	// // Create Mapping
 	// int handle;
@@ -219,14 +228,14 @@ uchar* GraphicsWindow::setupMemMap()
         }
 
         // Set the size of the shared memory
-        if (ftruncate(fd, MEM_SIZE) == -1) {
+        if (ftruncate(fd, memSize) == -1) {
             qDebug() << "Error setting size of shared memory";
             ::close(fd);
             return nullptr;
         }
 
         // Get Map location
-        memptr = static_cast<uchar*>(mmap(NULL, MEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        memptr = static_cast<uchar*>(mmap(NULL, memSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
         if (memptr == MAP_FAILED) {
             qDebug() << "Error accessing memory";
             ::close(fd);
@@ -236,15 +245,34 @@ uchar* GraphicsWindow::setupMemMap()
         ::close(fd);
 
         // Set up specific regions
-        memset(memptr, 0, MEM_SIZE);
-        map = memptr + 0x2400;
-        ports = memptr + 0x10000;
+        memset(memptr, 0, memSize);
+        initShmHeader(memptr);
+        if (!useSharedRegions()) {
+            return nullptr;
+        }
 
 	#endif
 
 	return memptr;
 }
 
+bool GraphicsWindow::useSharedRegions()
+{
+	// Validate what was just written, so a layout bug shows up here and not as corruption
+	ShmHeader* header = reinterpret_cast<ShmHeader*>(memptr);
+	ShmStatus status = validateShmHeader(header, memSize);
+	uchar* vram = status == SHM_OK ? static_cast<uchar*>(shmRegion(header, SHM_REGION_VRAM, SHM_VRAM_SIZE)) : nullptr;
+	uchar* latches = status == SHM_OK ? static_cast<uchar*>(shmRegion(header, SHM_REGION_PORTS, SHM_PORTS_SIZE)) : nullptr;
+	if (vram == nullptr || latches == nullptr) {
+		qDebug() << "Invalid shared memory layout:" << shmStatusText(status);
+		return false;
+	}
+	map = vram;
+	ports = latches;
+	inputRing = static_cast<ShmInputRing*>(shmRegion(header, SHM_REGION_INPUT_RING, sizeof(ShmInputRing)));
+	return true;
+}
+
 void GraphicsWindow::keyPressEvent(QKeyEvent* event)
 {
 	if (event->isAutoRepeat()) {
@@ -323,6 +351,18 @@ void GraphicsWindow::keyReleaseEvent(QKeyEvent* event)
 
 void GraphicsWindow::editMemInputBit(int bit, bool set)
 {
+	if (inputRing) {
+		// Queued with the key's time; the emulator applies it at the matching cycle
+		ShmInputRecord record = {};
+		record.host_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		record.port = (uint8_t)(bit / 8);
+		record.mask = (uint8_t)(1 << (bit % 8));
+		record.value = set ? record.mask : 0;
+		if (pushShmInput(inputRing, record)) {
+			return;
+		}
+	}
 	uchar* port = ports + bit / 8;
 	if (set) {
 		// Create bitmask to set input bit
@@ -24,7 +24,9 @@
 #include <qtransform.h>
 #include <qwidget.h>
 
-const int MEM_SIZE = 0x10007;
+// Layout of the block shared with the emulator
+#include "../shm_layout.h"
+
 const int SCREEN_RESOLUTION = 57344; //(256x224)
 const int FRAME_RATE = 60;
 const char MAPPED_NAME[] = "/SpaceInvaders";
@@ -149,7 +151,16 @@ protected:
 
 private:
 	/**
-	   Edits the given bit on the input ports stored in memory
+	   Points map, ports and the input ring at their regions of the shared block,
+	   after validating its header
+
+	   @return bool true if the layout is valid and has the VRAM and port regions
+	*/
+	bool useSharedRegions();
+
+	/**
+	   Queues a change of the given input bit for the emulator, or edits it
+	   on the input ports stored in memory if there is no input ring
 
 	   @param bit - the bit offset to edit
 	   @param set - if true set bit to 1 else set to 0
@@ -173,10 +184,12 @@ public:
 
 private:
 	// Memory variables
-	uchar mem[MEM_SIZE] = { 0 };
-	uchar* map = mem + 0x2400;
-	uchar* ports = mem + 0x10000;
+	uchar mem[SHM_MEMORY_SIZE] = { 0 };
+	uchar* map = mem + SHM_VRAM_OFFSET;
+	uchar* ports = mem + SHM_PORTS_OFFSET;
 	uchar* memptr;
+	size_t memSize = 0;
+	ShmInputRing* inputRing = nullptr;
 	void* handle;
 	int o = 0;
 	int change = 85;
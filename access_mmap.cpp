@@ -1,7 +1,13 @@
 #include "access_mmap.h"
+#include "input.h"
 
-int init_mmap(State8080* state) {
+static_assert(SHM_MEMORY_SIZE == MEMORY_SIZE, "shm_layout.h must match the memory block in initcpu.h");
+static_assert(SHM_PORTS_OFFSET == PORT_LOCATION && SHM_PORTS_SIZE == PORT_BLOCK_SIZE,
+    "shm_layout.h must match the port block in initcpu.h");
+
+int init_mmap(State8080* state, SharedBlock* block) {
     memory_map mem_map;
+    size_t size = 0;
 
 #if defined(_WIN32) || defined(_WIN64)
     mem_map.h_map_file = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, (LPCWSTR)MAPPED_NAME);
@@ -10,11 +16,16 @@ int init_mmap(State8080* state) {
         return 1;
     }
 
-    mem_map.buffer_ptr = MapViewOfFile(mem_map.h_map_file, FILE_MAP_ALL_ACCESS, 0, 0, MEMORY_SIZE);
+    // Map all of it; the header says how much is in use
+    mem_map.buffer_ptr = MapViewOfFile(mem_map.h_map_file, FILE_MAP_ALL_ACCESS, 0, 0, 0);
     if (mem_map.buffer_ptr == NULL) {
         CloseHandle(mem_map.h_map_file);
         return 1;
     }
+    MEMORY_BASIC_INFORMATION info;
+    if (VirtualQuery(mem_map.buffer_ptr, &info, sizeof(info)) != 0) {
+        size = info.RegionSize;
+    }
 
 #else
     mem_map.fd = shm_open(MAPPED_NAME, O_RDWR, 0666);
@@ -22,15 +33,67 @@ int init_mmap(State8080* state) {
         return 1;
     }
 
-    mem_map.buffer_ptr = mmap(NULL, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, mem_map.fd, 0);
+    struct stat info;
+    if (fstat(mem_map.fd, &info) != 0 || info.st_size == 0) {
+        close(mem_map.fd);
+        return 1;
+    }
+    size = (size_t)info.st_size;
+
+    mem_map.buffer_ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_map.fd, 0);
     if (mem_map.buffer_ptr == MAP_FAILED) {
         close(mem_map.fd);
         return 1;
     }
 #endif
 
-    // buffer_ptr for initcpu
-    initCPU(state, mem_map.buffer_ptr);
+    // Refuse a block laid out by another build rather than corrupt it
+    ShmHeader* header = (ShmHeader*)mem_map.buffer_ptr;
+    ShmStatus status = validateShmHeader(header, size);
+    void* memory = status == SHM_OK ? shmRegion(header, SHM_REGION_MEMORY, MEMORY_SIZE) : nullptr;
+    if (memory == nullptr) {
+        std::cerr << "Not using shared memory " << MAPPED_NAME << ": "
+            << (status == SHM_OK ? "no CPU memory region" : shmStatusText(status));
+        if (status == SHM_BAD_VERSION) {
+            std::cerr << " (UI " << header->version_major << "." << header->version_minor
+                << ", emulator " << SHM_VERSION_MAJOR << "." << SHM_VERSION_MINOR << ")";
+        }
+        std::cerr << std::endl;
+#if defined(_WIN32) || defined(_WIN64)
+        UnmapViewOfFile(mem_map.buffer_ptr);
+        CloseHandle(mem_map.h_map_file);
+#else
+        munmap(mem_map.buffer_ptr, size);
+        close(mem_map.fd);
+#endif
+        return 1;
+    }
+
+    // Memory region for initcpu
+    initCPU(state, memory);
 
+    if (block) {
+        block->header = header;
+        block->stats = (ShmStats*)shmRegion(header, SHM_REGION_STATS, sizeof(ShmStats));
+        block->input = (ShmInputRing*)shmRegion(header, SHM_REGION_INPUT_RING, sizeof(ShmInputRing));
+    }
     return 0;
 }
+
+void forwardSharedInput(SharedBlock* block, InputQueue* queue) {
+    if (block->input == nullptr) {
+        return;
+    }
+    ShmInputRecord record;
+    while (popShmInput(block->input, &record)) {
+        postInput(queue, record.port, record.mask, record.value, record.host_ns);
+    }
+}
+
+void publishSharedFrame(SharedBlock* block, const State8080* cpu) {
+    if (block->stats == nullptr) {
+        return;
+    }
+    block->stats->cycles.store(cpu->cycles, std::memory_order_relaxed);
+    block->stats->frames.fetch_add(1, std::memory_order_release);
+}
@@ -4,17 +4,21 @@
 #define MEMORY_MAP
 
 #include "initcpu.h"
+#include "shm_layout.h"
 
 #if defined(_WIN32) || defined(_WIN64)
     #include <windows.h>
 const char MAPPED_NAME[] = "/SpaceInvaders";
 #else
     #include <sys/mman.h>
+    #include <sys/stat.h>
     #include <fcntl.h>
     #include <unistd.h>
     #define MAPPED_NAME "/SpaceInvaders"
 #endif
 
+struct InputQueue;
+
 struct memory_map {
 #if defined(_WIN32) || defined(_WIN64)
     HANDLE h_map_file;
@@ -25,6 +29,36 @@ struct memory_map {
 #endif
 };
 
-int init_mmap(State8080* state);
+/**
+* The regions of the UI's shared block used besides the CPU memory, see
+* shm_layout.h. Each is null if the UI did not create it.
+*/
+struct SharedBlock {
+    ShmHeader* header = nullptr;
+    ShmStats* stats = nullptr;
+    ShmInputRing* input = nullptr;
+};
+
+/**
+* Opens the shared memory block the UI created, validates its layout
+* header and initializes {state} on its memory region.
+*
+* @param block Set to the block's other regions; may be null.
+* @return 0 on success, 1 if there is no block or its layout is not
+*         one this build understands (printed); the caller then runs on
+*         private memory.
+*/
+int init_mmap(State8080* state, SharedBlock* block = nullptr);
+
+/**
+* Moves the input the UI queued in the shared ring into {queue}, with
+* the UI's timestamps. Call before scheduleInput.
+*/
+void forwardSharedInput(SharedBlock* block, InputQueue* queue);
+
+/**
+* Tells the UI a frame has finished. Call after each runFrame.
+*/
+void publishSharedFrame(SharedBlock* block, const State8080* cpu);
 
 #endif
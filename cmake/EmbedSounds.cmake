@@ -0,0 +1,43 @@
+# Writes the sound effects into a C++ source, so the emulator does not
+# depend on a sounds/ directory next to its working directory.
+#
+# cmake -DSOUND_DIR=path/to/sounds -DOUTPUT=sound_assets.cpp -P EmbedSounds.cmake
+#
+# The table is in SoundEffect order (sound.h); keep SOUND_FILES in step.
+
+set(SOUND_FILES
+    shoot.wav
+    invaderkilled.wav
+    fastinvader1.wav
+    fastinvader2.wav
+    fastinvader3.wav
+    fastinvader4.wav
+    ufo_highpitch.wav
+    ufo_lowpitch.wav
+    explosion.wav
+    extendedplay.wav
+)
+
+# CMake regexes have no {n}: spell out 32 bytes per line
+set(line "")
+foreach(i RANGE 31)
+    string(APPEND line "0x..,")
+endforeach()
+
+set(source "// Generated by cmake/EmbedSounds.cmake from ${SOUND_DIR}. Do not edit.\n\n")
+string(APPEND source "#include \"sound_assets.h\"\n\n")
+set(table "")
+set(index 0)
+foreach(name ${SOUND_FILES})
+    file(READ "${SOUND_DIR}/${name}" hex HEX)
+    string(LENGTH "${hex}" size)
+    math(EXPR size "${size} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(REGEX REPLACE "(${line})" "\\1\n    " bytes "${bytes}")
+    string(APPEND source "static const uint8_t sound_${index}[] = {\n    ${bytes}\n};\n\n")
+    string(APPEND table "    { \"${name}\", sound_${index}, ${size} },\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+string(APPEND source "const SoundAsset SOUND_ASSETS[SOUND_COUNT] = {\n${table}};\n")
+
+file(WRITE "${OUTPUT}" "${source}")
@@ -0,0 +1,174 @@
+#include "codetracker.h"
+
+/**
+* Backing page of cpu->memory for a direct page pointer, or -1 if the
+* pointer lies outside the 64 KB address space buffer.
+*/
+static int backingPage(const State8080* cpu, const uint8_t* page) {
+    if (page == nullptr || page < cpu->memory || page >= cpu->memory + ADDRESS_SPACE_SIZE) {
+        return -1;
+    }
+    return (int)((page - cpu->memory) >> PAGE_SHIFT);
+}
+
+static void removeBlock(State8080* cpu, uint32_t block);
+
+static void codePageWrite(State8080* cpu, uint16_t addr, uint8_t value) {
+    CodeTracker* tracker = cpu->pages.code_tracker;
+    uint8_t* page = tracker->saved_write[addr >> PAGE_SHIFT];
+    uint8_t offset = addr & (PAGE_SIZE - 1);
+    storeDirect(cpu, page + offset, value);
+    tracker->trapped_writes++;
+
+    // Collect first: removing a block edits the range list being scanned
+    std::vector<uint32_t> hits;
+    for (const CodeRange& range : tracker->page_ranges[backingPage(cpu, page)]) {
+        if (range.first <= offset && offset <= range.last) {
+            hits.push_back(range.block);
+        }
+    }
+    if (hits.empty()) {
+        return;
+    }
+    tracker->invalidating_writes++;
+    for (uint32_t id : hits) {
+        const CodeBlock block = tracker->blocks[id];
+        removeBlock(cpu, id);
+        tracker->invalidated_blocks++;
+        if (tracker->on_invalidate) {
+            tracker->on_invalidate(tracker->context, id, block.start, block.length);
+        }
+    }
+}
+
+/**
+* Routes stores to every CPU page backed by {physical} through the
+* tracker. Read-only pages have no direct write pointer and are left alone.
+*/
+static void protectPage(State8080* cpu, int physical) {
+    CodeTracker* tracker = cpu->pages.code_tracker;
+    uint8_t* backing = cpu->memory + (physical << PAGE_SHIFT);
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        if (cpu->pages.write[page] == backing) {
+            tracker->saved_write[page] = backing;
+            tracker->saved_handler[page] = cpu->pages.write_handler[page];
+            cpu->pages.write[page] = nullptr;
+            cpu->pages.write_handler[page] = codePageWrite;
+        }
+    }
+    tracker->pages_protected++;
+}
+
+static void releasePage(State8080* cpu, int physical) {
+    CodeTracker* tracker = cpu->pages.code_tracker;
+    uint8_t* backing = cpu->memory + (physical << PAGE_SHIFT);
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        if (tracker->saved_write[page] == backing) {
+            cpu->pages.write[page] = backing;
+            cpu->pages.write_handler[page] = tracker->saved_handler[page];
+            tracker->saved_write[page] = nullptr;
+        }
+    }
+    tracker->pages_released++;
+}
+
+/**
+* Calls {visit}(physical page, first, last) for each run of the block's
+* bytes that shares a backing page.
+*/
+template <typename Visit>
+static void forEachBlockRange(const State8080* cpu, uint16_t start, uint16_t length, Visit visit) {
+    uint32_t addr = start;
+    uint32_t end = (uint32_t)start + length;
+    while (addr < end) {
+        uint16_t cpu_addr = (uint16_t)addr;
+        uint32_t run = PAGE_SIZE - (cpu_addr & (PAGE_SIZE - 1));
+        if (run > end - addr) {
+            run = end - addr;
+        }
+        int physical = backingPage(cpu, cpu->pages.read[cpu_addr >> PAGE_SHIFT]);
+        if (physical >= 0) {
+            uint8_t first = cpu_addr & (PAGE_SIZE - 1);
+            visit(physical, first, (uint8_t)(first + run - 1));
+        }
+        addr += run;
+    }
+}
+
+static void removeBlock(State8080* cpu, uint32_t block) {
+    CodeTracker* tracker = cpu->pages.code_tracker;
+    CodeBlock& entry = tracker->blocks[block];
+    if (!entry.valid) {
+        return;
+    }
+    entry.valid = false;
+    forEachBlockRange(cpu, entry.start, entry.length, [&](int physical, uint8_t first, uint8_t last) {
+        std::vector<CodeRange>& ranges = tracker->page_ranges[physical];
+        for (size_t i = 0; i < ranges.size();) {
+            if (ranges[i].block == block) {
+                ranges[i] = ranges.back();
+                ranges.pop_back();
+            }
+            else {
+                i++;
+            }
+        }
+        if (ranges.empty()) {
+            releasePage(cpu, physical);
+        }
+    });
+}
+
+void attachCodeTracker(State8080* cpu, CodeTracker* tracker, CodeInvalidateCallback on_invalidate, void* context) {
+    if (cpu->pages.code_tracker) {
+        detachCodeTracker(cpu);
+    }
+    tracker->on_invalidate = on_invalidate;
+    tracker->context = context;
+    cpu->pages.code_tracker = tracker;
+}
+
+void detachCodeTracker(State8080* cpu) {
+    CodeTracker* tracker = cpu->pages.code_tracker;
+    if (tracker == nullptr) {
+        return;
+    }
+    for (int physical = 0; physical < PAGE_COUNT; physical++) {
+        if (!tracker->page_ranges[physical].empty()) {
+            tracker->page_ranges[physical].clear();
+            releasePage(cpu, physical);
+        }
+    }
+    tracker->blocks.clear();
+    cpu->pages.code_tracker = nullptr;
+}
+
+uint32_t registerCodeBlock(State8080* cpu, uint16_t start, uint16_t length) {
+    CodeTracker* tracker = cpu->pages.code_tracker;
+    uint32_t block = (uint32_t)tracker->blocks.size();
+    tracker->blocks.push_back({ start, length, true });
+    forEachBlockRange(cpu, start, length, [&](int physical, uint8_t first, uint8_t last) {
+        std::vector<CodeRange>& ranges = tracker->page_ranges[physical];
+        if (ranges.empty()) {
+            protectPage(cpu, physical);
+        }
+        ranges.push_back({ block, first, last });
+    });
+    return block;
+}
+
+void releaseCodeBlock(State8080* cpu, uint32_t block) {
+    removeBlock(cpu, block);
+}
+
+void printCodeTrackerStats(const CodeTracker* tracker, FILE* out) {
+    size_t live = 0;
+    for (const CodeBlock& block : tracker->blocks) {
+        live += block.valid;
+    }
+    fprintf(out, "code tracker: %zu live blocks, %llu trapped writes, %llu hit code, %llu blocks invalidated, "
+        "%llu pages protected, %llu released\n",
+        live, (unsigned long long)tracker->trapped_writes, (unsigned long long)tracker->invalidating_writes,
+        (unsigned long long)tracker->invalidated_blocks, (unsigned long long)tracker->pages_protected,
+        (unsigned long long)tracker->pages_released);
+}
@@ -0,0 +1,88 @@
+#ifndef CODE_TRACKER_H
+#define CODE_TRACKER_H
+
+#include "initcpu.h"
+#include "pagetable.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/*
+ * Self-modifying code detection for anything that caches work derived
+ * from memory contents (a decode cache, a JIT, a disassembly view).
+ *
+ * The owner registers each translated block. Every page of memory that
+ * holds a block gets its direct write pointer removed, so stores to it
+ * fall into the tracker's page handler. The handler performs the store,
+ * invalidates only the blocks covering that byte and hands the page back
+ * to the fast path once no blocks remain on it. Pages without code never
+ * leave the fast path, so there is no per-store "has code" check.
+ *
+ * Pages are tracked by their backing memory, so a store through a mirror
+ * (0x6000 on Space Invaders) invalidates code registered at 0x2000.
+ * Attach after the memory map is set up; mapPages drops the protection.
+ */
+
+typedef void (*CodeInvalidateCallback)(void* context, uint32_t block, uint16_t start, uint16_t length);
+
+struct CodeBlock {
+    uint16_t start;
+    uint16_t length;
+    bool valid;
+};
+
+// Bytes [first, last] of a block that live on one page of backing memory
+struct CodeRange {
+    uint32_t block;
+    uint8_t first;
+    uint8_t last;
+};
+
+struct CodeTracker {
+    std::vector<CodeBlock> blocks;
+    std::vector<CodeRange> page_ranges[PAGE_COUNT];   // indexed by page of cpu->memory, not CPU address
+    uint8_t* saved_write[PAGE_COUNT] = {};            // direct write pointer of each trapped CPU page
+    PageWriteHandler saved_handler[PAGE_COUNT] = {};
+    CodeInvalidateCallback on_invalidate = nullptr;
+    void* context = nullptr;
+
+    // Statistics
+    uint64_t trapped_writes = 0;        // stores that landed on a page holding code
+    uint64_t invalidating_writes = 0;   // of those, stores that hit registered bytes
+    uint64_t invalidated_blocks = 0;
+    uint64_t pages_protected = 0;
+    uint64_t pages_released = 0;
+};
+
+/**
+* Starts tracking code for {cpu}.
+*
+* @param cpu Pointer to a State8080 struct with its memory map set up.
+* @param tracker Tracker to attach; must outlive the attachment.
+* @param on_invalidate Called once per invalidated block, after the store; may be null.
+* @param context Passed to {on_invalidate}.
+*/
+void attachCodeTracker(State8080* cpu, CodeTracker* tracker, CodeInvalidateCallback on_invalidate, void* context);
+
+/**
+* Drops every block without calling back and restores the fast store
+* path on all pages.
+*/
+void detachCodeTracker(State8080* cpu);
+
+/**
+* Registers {length} bytes of translated code at {start} and traps
+* stores to the pages holding them.
+*
+* @return block id passed to the invalidation callback.
+*/
+uint32_t registerCodeBlock(State8080* cpu, uint16_t start, uint16_t length);
+
+/**
+* Removes {block}, e.g. when the cache evicts it. Does not call back.
+*/
+void releaseCodeBlock(State8080* cpu, uint32_t block);
+
+void printCodeTrackerStats(const CodeTracker* tracker, FILE* out);
+
+#endif
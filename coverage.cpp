@@ -0,0 +1,82 @@
+#include "coverage.h"
+#include "disassembler.h"
+#include <cstdio>
+#include <cstring>
+
+void attachCoverage(State8080* cpu, CoverageMap* map) {
+    cpu->pages.coverage = map->bits;
+}
+
+void detachCoverage(State8080* cpu) {
+    cpu->pages.coverage = nullptr;
+}
+
+uint32_t countCovered(const CoverageMap* map, uint32_t start, uint32_t end) {
+    uint32_t count = 0;
+    for (uint32_t addr = start; addr < end && addr < 0x10000; addr++) {
+        count += isCovered(map, (uint16_t)addr);
+    }
+    return count;
+}
+
+void mergeCoverage(CoverageMap* into, const CoverageMap* from) {
+    for (int i = 0; i < COVERAGE_BYTES; i++) {
+        into->bits[i] |= from->bits[i];
+    }
+}
+
+bool writeCoverage(const CoverageMap* map, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    CoverageFileHeader header = {};
+    memcpy(header.magic, COVERAGE_MAGIC, sizeof(header.magic));
+    header.bitmap_bytes = COVERAGE_BYTES;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(map->bits, 1, COVERAGE_BYTES, file) == COVERAGE_BYTES;
+    return fclose(file) == 0 && ok;
+}
+
+bool readCoverage(CoverageMap* map, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    CoverageFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, COVERAGE_MAGIC, sizeof(header.magic)) == 0
+        && header.bitmap_bytes == COVERAGE_BYTES
+        && fread(map->bits, 1, COVERAGE_BYTES, file) == COVERAGE_BYTES;
+    fclose(file);
+    return ok;
+}
+
+bool writeCoverageLcov(const CoverageMap* map, const uint8_t* rom, uint32_t rom_size,
+    const char* source_name, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "TN:\nSF:%s\n", source_name);
+    uint32_t found = 0, hit = 0;
+    uint32_t addr = 0;
+    while (addr < rom_size) {
+        bool covered = isCovered(map, (uint16_t)addr);
+        fprintf(file, "DA:%u,%d\n", addr, covered ? 1 : 0);
+        found++;
+        hit += covered;
+
+        uint32_t next = addr + Instruction8080Length(rom[addr]);
+        // Never step over a covered address: it is a known instruction start
+        for (uint32_t skip = addr + 1; skip < next && skip < rom_size; skip++) {
+            if (isCovered(map, (uint16_t)skip)) {
+                next = skip;
+                break;
+            }
+        }
+        addr = next;
+    }
+    fprintf(file, "LF:%u\nLH:%u\nend_of_record\n", found, hit);
+    return fclose(file) == 0;
+}
@@ -0,0 +1,75 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include "initcpu.h"
+#include <cstdint>
+
+#define COVERAGE_MAGIC "SICOV001"
+#define COVERAGE_BYTES (0x10000 / 8)
+
+/*
+ * Code coverage: one bit per address, set when an instruction is fetched
+ * from it. fetchOpcode sets the bit when a map is attached, which costs
+ * a well predicted branch when none is.
+ *
+ * Binary file layout: CoverageFileHeader followed by the COVERAGE_BYTES
+ * bitmap (bit addr & 7 of byte addr >> 3). Files from many runs are
+ * merged by ORing, see coverage_tool.cpp.
+ */
+
+struct CoverageMap {
+    uint8_t bits[COVERAGE_BYTES];
+};
+
+struct CoverageFileHeader {
+    char magic[8];
+    uint32_t bitmap_bytes;
+    uint32_t reserved;
+};
+
+/**
+* Starts recording executed addresses of {cpu} into {map}. The map is
+* not cleared, so coverage accumulates across attachments.
+*/
+void attachCoverage(State8080* cpu, CoverageMap* map);
+
+void detachCoverage(State8080* cpu);
+
+inline bool isCovered(const CoverageMap* map, uint16_t addr) {
+    return (map->bits[addr >> 3] >> (addr & 7)) & 1;
+}
+
+/**
+* @return number of covered addresses in [start, end).
+*/
+uint32_t countCovered(const CoverageMap* map, uint32_t start, uint32_t end);
+
+/**
+* ORs {from} into {into}.
+*/
+void mergeCoverage(CoverageMap* into, const CoverageMap* from);
+
+/**
+* @return true on success.
+*/
+bool writeCoverage(const CoverageMap* map, const char* path);
+
+/**
+* @return false if the file is missing, truncated or not a coverage file.
+*/
+bool readCoverage(CoverageMap* map, const char* path);
+
+/**
+* Writes lcov tracefile records for {rom}. Every instruction start found
+* by a linear sweep of [0, rom_size) is one "line" numbered by its
+* address; a sweep that reaches a covered address resynchronizes on it,
+* so executed code is always decoded at the right boundaries.
+*
+* @param rom ROM image, e.g. state->memory after loadROM.
+* @param source_name Name written to the SF: record.
+* @return true on success.
+*/
+bool writeCoverageLcov(const CoverageMap* map, const uint8_t* rom, uint32_t rom_size,
+    const char* source_name, const char* path);
+
+#endif
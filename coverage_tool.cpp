@@ -0,0 +1,169 @@
+/*
+ * Merges and exports code coverage collected by the headless runner:
+ *
+ * ./SpaceInvadersHeadless ./path/to/invaders --inputs movie1.txt --frames N --coverage movie1.cov
+ *
+ * ./SpaceInvadersCoverage merge all.cov movie1.cov movie2.cov ... [--threads T]
+ * ./SpaceInvadersCoverage lcov all.cov ./path/to/invaders coverage.info [--min-gap BYTES]
+ *
+ * merge ORs any number of bitmaps, reading them on all cores. lcov
+ * writes an lcov tracefile for the ROM (one line per instruction,
+ * numbered by address) and lists the largest never-executed ranges.
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "coverage.h"
+
+static void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " merge <out.cov> <in.cov>... [--threads T]\n"
+        << "       " << argv0 << " lcov <in.cov> <rom> <out.info> [--min-gap BYTES]\n";
+}
+
+/**
+* ORs {inputs} into {out}. Each thread folds a share of the files into
+* its own map; the per-thread maps are combined at the end.
+*
+* @return number of files that could not be read.
+*/
+static int mergeFiles(const std::vector<const char*>& inputs, int threads, CoverageMap* out) {
+    std::vector<CoverageMap> partial(threads);
+    std::atomic<size_t> next(0);
+    std::atomic<int> failed(0);
+
+    auto work = [&](CoverageMap* into) {
+        memset(into, 0, sizeof(CoverageMap));
+        CoverageMap map;
+        size_t i;
+        while ((i = next.fetch_add(1)) < inputs.size()) {
+            if (!readCoverage(&map, inputs[i])) {
+                std::cerr << "Failed to read coverage file " << inputs[i] << std::endl;
+                failed++;
+                continue;
+            }
+            mergeCoverage(into, &map);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(work, &partial[t]);
+    }
+    work(&partial[0]);
+    for (std::thread& w : workers) {
+        w.join();
+    }
+
+    memset(out, 0, sizeof(CoverageMap));
+    for (const CoverageMap& map : partial) {
+        mergeCoverage(out, &map);
+    }
+    return failed;
+}
+
+static int runMerge(int argc, char** argv) {
+    const char* out_path = argv[2];
+    std::vector<const char*> inputs;
+    int threads = 0;
+    for (int i = 3; i < argc; ++i) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = atoi(argv[++i]);
+        else inputs.push_back(argv[i]);
+    }
+    if (inputs.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, (int)inputs.size());
+
+    CoverageMap merged;
+    int failed = mergeFiles(inputs, threads, &merged);
+    if (!writeCoverage(&merged, out_path)) {
+        std::cerr << "Failed to write coverage file " << out_path << std::endl;
+        return 1;
+    }
+    printf("merged %zu files (%d unreadable), %u addresses covered\n",
+        inputs.size(), failed, countCovered(&merged, 0, 0x10000));
+    return failed ? 1 : 0;
+}
+
+static int runLcov(int argc, char** argv) {
+    if (argc < 5) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    uint32_t min_gap = 16;
+    for (int i = 5; i < argc; ++i) {
+        if (!strcmp(argv[i], "--min-gap") && i + 1 < argc) min_gap = strtoul(argv[++i], nullptr, 0);
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    CoverageMap map;
+    if (!readCoverage(&map, argv[2])) {
+        std::cerr << "Failed to read coverage file " << argv[2] << std::endl;
+        return 1;
+    }
+    std::ifstream in(argv[3], std::ios::binary);
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (rom.empty() || rom.size() > 0x10000) {
+        std::cerr << "Failed to read ROM " << argv[3] << std::endl;
+        return 1;
+    }
+    if (!writeCoverageLcov(&map, rom.data(), (uint32_t)rom.size(), argv[3], argv[4])) {
+        std::cerr << "Failed to write " << argv[4] << std::endl;
+        return 1;
+    }
+
+    // Never-executed stretches of ROM, largest first
+    std::vector<std::pair<uint32_t, uint32_t>> gaps;
+    uint32_t start = 0;
+    for (uint32_t addr = 0; addr <= rom.size(); addr++) {
+        bool covered = addr < rom.size() && isCovered(&map, (uint16_t)addr);
+        if (covered || addr == rom.size()) {
+            if (addr - start >= min_gap) {
+                gaps.emplace_back(start, addr - start);
+            }
+            start = addr + 1;
+        }
+    }
+    std::sort(gaps.begin(), gaps.end(),
+        [](const std::pair<uint32_t, uint32_t>& x, const std::pair<uint32_t, uint32_t>& y) { return x.second > y.second; });
+
+    printf("%u of %zu ROM addresses executed as opcodes\n", countCovered(&map, 0, (uint32_t)rom.size()), rom.size());
+    printf("%zu never-executed ranges of %u+ bytes:\n", gaps.size(), min_gap);
+    for (const auto& gap : gaps) {
+        printf("  %04x-%04x  %5u bytes\n", gap.first, gap.first + gap.second - 1, gap.second);
+    }
+    return 0;
+}
+
+/**
+   Entry point for the coverage tool.
+
+   @param argc - argument count
+   @param argv - argument vector (expects a command as argv[1])
+   @return 0 on success, 1 on failure
+*/
+int main(int argc, char** argv) {
+    if (argc >= 4 && !strcmp(argv[1], "merge")) {
+        return runMerge(argc, argv);
+    }
+    if (argc >= 5 && !strcmp(argv[1], "lcov")) {
+        return runLcov(argc, argv);
+    }
+    printUsage(argv[0]);
+    return 1;
+}
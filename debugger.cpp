@@ -0,0 +1,369 @@
+#include "debugger.h"
+#include "emulator.h"
+#include "trace.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static uint16_t registerValue(const State8080* cpu, BreakRegister reg) {
+    switch (reg) {
+    case BREAK_REG_A: return cpu->a;
+    case BREAK_REG_B: return cpu->b;
+    case BREAK_REG_C: return cpu->c;
+    case BREAK_REG_D: return cpu->d;
+    case BREAK_REG_E: return cpu->e;
+    case BREAK_REG_H: return cpu->h;
+    case BREAK_REG_L: return cpu->l;
+    case BREAK_REG_BC: return (cpu->b << 8) | cpu->c;
+    case BREAK_REG_DE: return (cpu->d << 8) | cpu->e;
+    case BREAK_REG_HL: return (cpu->h << 8) | cpu->l;
+    case BREAK_REG_SP: return cpu->sp;
+    }
+    return 0;
+}
+
+static bool conditionHolds(const State8080* cpu, const Breakpoint& bp) {
+    uint16_t value = registerValue(cpu, bp.reg);
+    switch (bp.compare) {
+    case BREAK_ALWAYS: return true;
+    case BREAK_EQ: return value == bp.value;
+    case BREAK_NE: return value != bp.value;
+    case BREAK_LT: return value < bp.value;
+    case BREAK_LE: return value <= bp.value;
+    case BREAK_GT: return value > bp.value;
+    case BREAK_GE: return value >= bp.value;
+    }
+    return false;
+}
+
+/**
+* Records a hit on a watched access, if it falls in a range of the right kind.
+*/
+static void checkWatch(State8080* cpu, uint16_t addr, uint8_t value, uint8_t kind) {
+    Debugger* debugger = cpu->debugger;
+    for (size_t i = 0; i < debugger->watchpoints.size(); i++) {
+        Watchpoint& watch = debugger->watchpoints[i];
+        if ((watch.kinds & kind) && watch.start <= addr && addr <= watch.end) {
+            watch.hits++;
+            if (debugger->pending.reason == DEBUG_STOP_NONE) {
+                debugger->pending.reason = (kind == WATCH_READ) ? DEBUG_STOP_WATCH_READ : DEBUG_STOP_WATCH_WRITE;
+                debugger->pending.addr = addr;
+                debugger->pending.value = value;
+                debugger->pending.index = (int)i;
+            }
+            return;
+        }
+    }
+}
+
+static uint8_t watchRead(State8080* cpu, uint16_t addr) {
+    Debugger* debugger = cpu->debugger;
+    int page = addr >> PAGE_SHIFT;
+    const uint8_t* direct = debugger->saved_read[page];
+    uint8_t value = direct ? direct[addr & (PAGE_SIZE - 1)] : debugger->saved_read_handler[page](cpu, addr);
+    checkWatch(cpu, addr, value, WATCH_READ);
+    return value;
+}
+
+static void watchWrite(State8080* cpu, uint16_t addr, uint8_t value) {
+    Debugger* debugger = cpu->debugger;
+    int page = addr >> PAGE_SHIFT;
+    uint8_t* direct = debugger->saved_write[page];
+    if (direct) {
+        storeDirect(cpu, direct + (addr & (PAGE_SIZE - 1)), value);
+    }
+    else {
+        debugger->saved_write_handler[page](cpu, addr, value);
+    }
+    checkWatch(cpu, addr, value, WATCH_WRITE);
+}
+
+static void watchPage(State8080* cpu, int page) {
+    Debugger* debugger = cpu->debugger;
+    if (debugger->watched[page]) {
+        return;
+    }
+    debugger->watched[page] = 1;
+    debugger->saved_read[page] = cpu->pages.read[page];
+    debugger->saved_write[page] = cpu->pages.write[page];
+    debugger->saved_read_handler[page] = cpu->pages.read_handler[page];
+    debugger->saved_write_handler[page] = cpu->pages.write_handler[page];
+    cpu->pages.read[page] = nullptr;
+    cpu->pages.write[page] = nullptr;
+    cpu->pages.read_handler[page] = watchRead;
+    cpu->pages.write_handler[page] = watchWrite;
+}
+
+static void unwatchPage(State8080* cpu, int page) {
+    Debugger* debugger = cpu->debugger;
+    if (!debugger->watched[page]) {
+        return;
+    }
+    debugger->watched[page] = 0;
+    cpu->pages.read[page] = debugger->saved_read[page];
+    cpu->pages.write[page] = debugger->saved_write[page];
+    cpu->pages.read_handler[page] = debugger->saved_read_handler[page];
+    cpu->pages.write_handler[page] = debugger->saved_write_handler[page];
+}
+
+void attachDebugger(State8080* cpu, Debugger* debugger) {
+    if (cpu->debugger) {
+        detachDebugger(cpu);
+    }
+    cpu->debugger = debugger;
+}
+
+void detachDebugger(State8080* cpu) {
+    if (cpu->debugger == nullptr) {
+        return;
+    }
+    removeWatchpoints(cpu);
+    cpu->debugger = nullptr;
+}
+
+int addBreakpoint(State8080* cpu, uint16_t addr, BreakRegister reg, BreakCompare compare, uint16_t value) {
+    Debugger* debugger = cpu->debugger;
+    debugger->breakpoints.push_back({ addr, reg, compare, value, 0 });
+    debugger->pc_bits[addr >> 3] |= 1 << (addr & 7);
+    return (int)debugger->breakpoints.size() - 1;
+}
+
+void removeBreakpoint(State8080* cpu, uint16_t addr) {
+    Debugger* debugger = cpu->debugger;
+    std::vector<Breakpoint>& list = debugger->breakpoints;
+    for (size_t i = 0; i < list.size();) {
+        if (list[i].addr == addr) {
+            list.erase(list.begin() + i);
+        }
+        else {
+            i++;
+        }
+    }
+    debugger->pc_bits[addr >> 3] &= ~(1 << (addr & 7));
+}
+
+int addWatchpoint(State8080* cpu, uint16_t start, uint16_t end, uint8_t kinds) {
+    Debugger* debugger = cpu->debugger;
+    if (end < start) {
+        uint16_t swap = start;
+        start = end;
+        end = swap;
+    }
+    debugger->watchpoints.push_back({ start, end, kinds, 0 });
+    for (int page = start >> PAGE_SHIFT; page <= end >> PAGE_SHIFT; page++) {
+        watchPage(cpu, page);
+    }
+    return (int)debugger->watchpoints.size() - 1;
+}
+
+void removeWatchpoint(State8080* cpu, uint16_t start, uint16_t end, uint8_t kinds) {
+    Debugger* debugger = cpu->debugger;
+    std::vector<Watchpoint>& list = debugger->watchpoints;
+    for (size_t i = 0; i < list.size();) {
+        if (list[i].start == start && list[i].end == end && list[i].kinds == kinds) {
+            list.erase(list.begin() + i);
+        }
+        else {
+            i++;
+        }
+    }
+    for (int page = start >> PAGE_SHIFT; page <= end >> PAGE_SHIFT; page++) {
+        bool needed = false;
+        for (const Watchpoint& watch : list) {
+            needed |= (watch.start >> PAGE_SHIFT) <= page && page <= (watch.end >> PAGE_SHIFT);
+        }
+        if (!needed) {
+            unwatchPage(cpu, page);
+        }
+    }
+}
+
+void removeWatchpoints(State8080* cpu) {
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        unwatchPage(cpu, page);
+    }
+    cpu->debugger->watchpoints.clear();
+}
+
+bool debugCheck(State8080* cpu) {
+    Debugger* debugger = cpu->debugger;
+    if (debugger->resuming) {
+        debugger->resuming = false;
+        if (cpu->pc == debugger->stop.pc && debugger->pending.reason == DEBUG_STOP_NONE && !debugger->stop_requested) {
+            return false;
+        }
+    }
+
+    DebugStop stop = {};
+    if (debugger->pending.reason != DEBUG_STOP_NONE) {
+        stop = debugger->pending;
+        debugger->pending = {};
+    }
+    else if (debugger->stop_requested) {
+        stop.reason = DEBUG_STOP_REQUEST;
+        stop.index = -1;
+    }
+    else {
+        for (size_t i = 0; i < debugger->breakpoints.size(); i++) {
+            Breakpoint& bp = debugger->breakpoints[i];
+            if (bp.addr == cpu->pc && conditionHolds(cpu, bp)) {
+                bp.hits++;
+                stop.reason = DEBUG_STOP_BREAKPOINT;
+                stop.index = (int)i;
+                break;
+            }
+        }
+        if (stop.reason == DEBUG_STOP_NONE) {
+            return false;
+        }
+    }
+    debugger->stop_requested = false;
+    stop.pc = cpu->pc;
+    debugger->stop = stop;
+    debugger->resuming = (debugger->pc_bits[cpu->pc >> 3] >> (cpu->pc & 7)) & 1;
+    return true;
+}
+
+void requestDebugStop(State8080* cpu) {
+    cpu->debugger->stop_requested = true;
+}
+
+void stepInstruction(State8080* cpu) {
+    if (cpu->trace) {
+        traceInstruction(cpu);
+    }
+    Emulate8080Op(cpu);
+    Debugger* debugger = cpu->debugger;
+    if (debugger == nullptr) {
+        return;
+    }
+    DebugStop stop = {};
+    if (debugger->pending.reason != DEBUG_STOP_NONE) {
+        stop = debugger->pending;
+        debugger->pending = {};
+    }
+    else {
+        stop.reason = DEBUG_STOP_STEP;
+        stop.index = -1;
+    }
+    stop.pc = cpu->pc;
+    debugger->stop = stop;
+    debugger->resuming = (debugger->pc_bits[cpu->pc >> 3] >> (cpu->pc & 7)) & 1;
+}
+
+uint8_t peekMemory(const State8080* cpu, uint16_t addr) {
+    int page = addr >> PAGE_SHIFT;
+    const Debugger* debugger = cpu->debugger;
+    const uint8_t* direct = (debugger && debugger->watched[page]) ? debugger->saved_read[page] : cpu->pages.read[page];
+    return direct ? direct[addr & (PAGE_SIZE - 1)] : 0xFF;
+}
+
+bool pokeMemory(State8080* cpu, uint16_t addr, uint8_t value) {
+    int page = addr >> PAGE_SHIFT;
+    const Debugger* debugger = cpu->debugger;
+    uint8_t* direct = (debugger && debugger->watched[page]) ? debugger->saved_read[page] : cpu->pages.read[page];
+    if (direct == nullptr) {
+        return false;
+    }
+    storeDirect(cpu, direct + (addr & (PAGE_SIZE - 1)), value);
+    return true;
+}
+
+static bool parseRegister(const char* name, size_t len, BreakRegister* reg) {
+    static const char* NAMES[] = { "a", "b", "c", "d", "e", "h", "l", "bc", "de", "hl", "sp" };
+    for (int i = 0; i < (int)(sizeof(NAMES) / sizeof(NAMES[0])); i++) {
+        if (strlen(NAMES[i]) == len && !strncmp(NAMES[i], name, len)) {
+            *reg = (BreakRegister)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool addBreakpointSpec(State8080* cpu, const char* spec) {
+    char* end;
+    unsigned long addr = strtoul(spec, &end, 16);
+    if (end == spec || addr > 0xFFFF) {
+        return false;
+    }
+    if (*end == '\0') {
+        addBreakpoint(cpu, (uint16_t)addr);
+        return true;
+    }
+    if (*end != ':') {
+        return false;
+    }
+
+    static const struct { const char* text; BreakCompare compare; } OPS[] = {
+        { "==", BREAK_EQ }, { "!=", BREAK_NE }, { "<=", BREAK_LE }, { ">=", BREAK_GE }, { "<", BREAK_LT }, { ">", BREAK_GT }
+    };
+    const char* condition = end + 1;
+    for (const auto& op : OPS) {
+        const char* at = strstr(condition, op.text);
+        if (at == nullptr) {
+            continue;
+        }
+        BreakRegister reg;
+        const char* value_text = at + strlen(op.text);
+        unsigned long value = strtoul(value_text, &end, 16);
+        if (!parseRegister(condition, at - condition, &reg) || end == value_text || *end != '\0' || value > 0xFFFF) {
+            return false;
+        }
+        addBreakpoint(cpu, (uint16_t)addr, reg, op.compare, (uint16_t)value);
+        return true;
+    }
+    return false;
+}
+
+bool addWatchpointSpec(State8080* cpu, const char* spec) {
+    char* end;
+    unsigned long start = strtoul(spec, &end, 16);
+    if (end == spec || start > 0xFFFF) {
+        return false;
+    }
+    unsigned long last = start;
+    if (*end == '-') {
+        const char* last_text = end + 1;
+        last = strtoul(last_text, &end, 16);
+        if (end == last_text || last > 0xFFFF) {
+            return false;
+        }
+    }
+    uint8_t kinds = WATCH_READ | WATCH_WRITE;
+    if (*end == ':') {
+        const char* mode = end + 1;
+        if (!strcmp(mode, "r")) kinds = WATCH_READ;
+        else if (!strcmp(mode, "w")) kinds = WATCH_WRITE;
+        else if (strcmp(mode, "rw")) return false;
+    }
+    else if (*end != '\0') {
+        return false;
+    }
+    addWatchpoint(cpu, (uint16_t)start, (uint16_t)last, kinds);
+    return true;
+}
+
+void printDebugStop(const State8080* cpu, FILE* out) {
+    const DebugStop& stop = cpu->debugger->stop;
+    switch (stop.reason) {
+    case DEBUG_STOP_BREAKPOINT:
+        fprintf(out, "breakpoint %d at %04x", stop.index, stop.pc);
+        break;
+    case DEBUG_STOP_WATCH_READ:
+    case DEBUG_STOP_WATCH_WRITE:
+        fprintf(out, "watchpoint %d: %s %04x = %02x, stopped at %04x", stop.index,
+            stop.reason == DEBUG_STOP_WATCH_READ ? "read" : "write", stop.addr, stop.value, stop.pc);
+        break;
+    case DEBUG_STOP_REQUEST:
+        fprintf(out, "stopped at %04x", stop.pc);
+        break;
+    case DEBUG_STOP_STEP:
+        fprintf(out, "stepped to %04x", stop.pc);
+        break;
+    default:
+        fprintf(out, "running");
+        break;
+    }
+    fprintf(out, "  a=%02x bc=%02x%02x de=%02x%02x hl=%02x%02x sp=%04x\n",
+        cpu->a, cpu->b, cpu->c, cpu->d, cpu->e, cpu->h, cpu->l, cpu->sp);
+}
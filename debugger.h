@@ -0,0 +1,182 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include "initcpu.h"
+#include "pagetable.h"
+#include <cstdint>
+#include <vector>
+
+/*
+ * Breakpoints and watchpoints.
+ *
+ * PC breakpoints live in a 64 Kbit bitmap that runFrame tests before
+ * each instruction, and only while a debugger is attached. A clear bit
+ * costs one load and a predictable branch, so code running far from any
+ * breakpoint keeps full speed. A set bit goes on to evaluate that
+ * address's conditions.
+ *
+ * Watchpoints use the page table. Only the pages holding a watched range
+ * lose their direct pointers. Their accesses go through the debugger's
+ * handlers, which check the range, forward to whatever the page did
+ * before and request a stop once the instruction completes.
+ *
+ * Attach after the memory map and any code tracker are set up.
+ */
+
+#define WATCH_READ 0x01
+#define WATCH_WRITE 0x02
+
+enum BreakRegister : uint8_t {
+    BREAK_REG_A, BREAK_REG_B, BREAK_REG_C, BREAK_REG_D, BREAK_REG_E, BREAK_REG_H, BREAK_REG_L,
+    BREAK_REG_BC, BREAK_REG_DE, BREAK_REG_HL, BREAK_REG_SP
+};
+
+enum BreakCompare : uint8_t {
+    BREAK_ALWAYS, BREAK_EQ, BREAK_NE, BREAK_LT, BREAK_LE, BREAK_GT, BREAK_GE
+};
+
+struct Breakpoint {
+    uint16_t addr;
+    BreakRegister reg;
+    BreakCompare compare;   // BREAK_ALWAYS for an unconditional breakpoint
+    uint16_t value;
+    uint32_t hits;
+};
+
+struct Watchpoint {
+    uint16_t start;
+    uint16_t end;           // inclusive
+    uint8_t kinds;          // WATCH_READ | WATCH_WRITE
+    uint32_t hits;
+};
+
+enum DebugStopReason : uint8_t {
+    DEBUG_STOP_NONE, DEBUG_STOP_BREAKPOINT, DEBUG_STOP_WATCH_READ, DEBUG_STOP_WATCH_WRITE, DEBUG_STOP_REQUEST,
+    DEBUG_STOP_STEP
+};
+
+struct DebugStop {
+    DebugStopReason reason;
+    uint16_t pc;            // instruction the CPU stopped in front of
+    uint16_t addr;          // watched address that was accessed
+    uint8_t value;          // byte read or written
+    int index;              // breakpoint or watchpoint that fired
+};
+
+struct Debugger {
+    uint8_t pc_bits[0x10000 / 8] = {};
+    std::vector<Breakpoint> breakpoints;
+    std::vector<Watchpoint> watchpoints;
+
+    // What each watched page did before the debugger took it over
+    uint8_t watched[PAGE_COUNT] = {};
+    uint8_t* saved_read[PAGE_COUNT] = {};
+    uint8_t* saved_write[PAGE_COUNT] = {};
+    PageReadHandler saved_read_handler[PAGE_COUNT] = {};
+    PageWriteHandler saved_write_handler[PAGE_COUNT] = {};
+
+    DebugStop stop = {};
+    DebugStop pending = {};     // watch hit waiting for its instruction to finish
+    bool stop_requested = false;
+    bool resuming = false;      // stopped on a breakpoint bit: let stop.pc run once before breaking again
+};
+
+void attachDebugger(State8080* cpu, Debugger* debugger);
+
+/**
+* Removes every watchpoint from the page table and detaches.
+*/
+void detachDebugger(State8080* cpu);
+
+/**
+* @return index of the new breakpoint.
+*/
+int addBreakpoint(State8080* cpu, uint16_t addr, BreakRegister reg = BREAK_REG_A,
+    BreakCompare compare = BREAK_ALWAYS, uint16_t value = 0);
+
+/**
+* Removes all breakpoints at {addr}.
+*/
+void removeBreakpoint(State8080* cpu, uint16_t addr);
+
+/**
+* @param kinds WATCH_READ, WATCH_WRITE or both.
+* @return index of the new watchpoint.
+*/
+int addWatchpoint(State8080* cpu, uint16_t start, uint16_t end, uint8_t kinds);
+
+/**
+* Removes the watchpoints exactly matching {start}, {end} and {kinds}.
+* Pages no other watchpoint needs get their direct pointers back.
+*/
+void removeWatchpoint(State8080* cpu, uint16_t start, uint16_t end, uint8_t kinds);
+
+void removeWatchpoints(State8080* cpu);
+
+/**
+* Parses "ADDR" or "ADDR:REG<op>VALUE" (hex, op one of == != < <= > >=,
+* REG one of a b c d e h l bc de hl sp), e.g. "0a9e" or "15f9:b==1".
+*
+* @return false if {spec} is malformed.
+*/
+bool addBreakpointSpec(State8080* cpu, const char* spec);
+
+/**
+* Parses "START[-END][:r|w|rw]" (hex), e.g. "20c0" or "2400-3fff:w".
+*
+* @return false if {spec} is malformed.
+*/
+bool addWatchpointSpec(State8080* cpu, const char* spec);
+
+/**
+* Slow half of debugBreak: evaluates pending watch hits, stop requests
+* and the conditions of the breakpoint bit that matched.
+*/
+bool debugCheck(State8080* cpu);
+
+/**
+* Called by runFrame before each instruction while a debugger is
+* attached. Fills debugger->stop and returns true to stop in front of
+* the instruction at cpu->pc.
+*/
+inline bool debugBreak(State8080* cpu) {
+    Debugger* debugger = cpu->debugger;
+    if (!((debugger->pc_bits[cpu->pc >> 3] >> (cpu->pc & 7)) & 1)
+        && debugger->pending.reason == DEBUG_STOP_NONE && !debugger->stop_requested) {
+        return false;
+    }
+    return debugCheck(cpu);
+}
+
+/**
+* Asks the CPU to stop before its next instruction (e.g. from a UI key).
+*/
+void requestDebugStop(State8080* cpu);
+
+/**
+* Runs the single instruction at cpu->pc outside runFrame and records a
+* DEBUG_STOP_STEP (or the watch hit it caused) in debugger->stop.
+* Resuming afterwards does not break again on the new pc.
+*/
+void stepInstruction(State8080* cpu);
+
+/**
+* Reads {addr} the way the CPU would, without watch hits or other side
+* effects. Unmapped addresses read 0xFF.
+*/
+uint8_t peekMemory(const State8080* cpu, uint16_t addr);
+
+/**
+* Stores into whatever backs {addr}, ROM included, bypassing write
+* protection and watchpoints.
+*
+* @return false if {addr} is unmapped.
+*/
+bool pokeMemory(State8080* cpu, uint16_t addr, uint8_t value);
+
+/**
+* One line description of debugger->stop.
+*/
+void printDebugStop(const State8080* cpu, FILE* out);
+
+#endif
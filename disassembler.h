@@ -0,0 +1,26 @@
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include <stdio.h>
+
+/**
+* Prints one instruction as "pc: opcode: MNEMONIC operands" to stdout.
+*
+* @param codebuffer Valid pointer to 8080 machine code.
+* @param pc Offset of the instruction in {codebuffer}.
+* @return number of bytes in the instruction.
+*/
+int Disassemble8080Op(unsigned char* codebuffer, int pc);
+
+/**
+* Same as above, printed to {out}.
+*/
+int Disassemble8080Op(FILE* out, const unsigned char* codebuffer, int pc);
+
+/**
+* @param opcode First byte of an instruction.
+* @return number of bytes in the instruction, 1 - 3, as decoded by the emulator.
+*/
+int Instruction8080Length(unsigned char opcode);
+
+#endif
@@ -20,6 +20,8 @@
 #include <cstdint>
 #include <map>
 #include "emulator.h"
+#include "pagetable.h"
+#include "io_ports.h"
 
 
 void setZSPflags(State8080* cpu, uint8_t result) {
@@ -44,7 +46,8 @@ void setZSPflags(State8080* cpu, uint8_t result) {
 
 
 void Emulate8080Op(State8080* cpu) {
-    uint8_t* code = &cpu->memory[cpu->pc];
+    uint8_t code[4];
+    fetchOpcode(cpu, code);
     #ifdef DEBUG
 		printf("pc: %04x  sp: %04x  a: %02x  bc: %02x%02x  de: %02x%02x  hl: %02x%02x  flags: z: %01x  s: %01x  p: %01x  cy: %01x  ac: %01x\n\t",
             cpu->pc, cpu->sp, cpu->a, cpu->b, cpu->c, cpu->d, cpu->e, cpu->h, cpu->l, cpu->flags.z, cpu->flags.s, cpu->flags.p, cpu->flags.c, cpu->flags.ac);
@@ -76,7 +79,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("STAX   B");
 		#endif
         uint16_t addr = (cpu->b << 8) | cpu->c;
-        cpu->memory[addr] = cpu->a;
+        writeByte(cpu, addr, cpu->a);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -170,7 +173,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("LDAX   B");
 		#endif // Load A indirect
         uint16_t addr = (cpu->b << 8) | cpu->c;
-        cpu->a = cpu->memory[addr];
+        cpu->a = readByte(cpu, addr);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -260,7 +263,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("STAX   D");
 		#endif // Store A indirect
         uint16_t addr = (cpu->d << 8) | cpu->e;
-        cpu->memory[addr] = cpu->a;
+        writeByte(cpu, addr, cpu->a);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -355,7 +358,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("LDAX   D");
 		#endif // Load A indirect
         uint16_t addr = (cpu->d << 8) | cpu->e;
-        cpu->a = cpu->memory[addr];
+        cpu->a = readByte(cpu, addr);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -451,8 +454,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("SHLD   addr: %04x", addr);
 		#endif // Store HL direct: from HL to memory
-        cpu->memory[addr] = cpu->l;
-        cpu->memory[addr + 1] = cpu->h;
+        writeByte(cpu, addr, cpu->l);
+        writeByte(cpu, addr + 1, cpu->h);
         cpu->pc += 3;
         cpu->cycles += 16;
         break;
@@ -561,8 +564,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("LHLD   addr: %04x", addr);
 		#endif // Load HL direct: from memory to HL
-        cpu->l = cpu->memory[addr];
-        cpu->h = cpu->memory[addr + 1];
+        cpu->l = readByte(cpu, addr);
+        cpu->h = readByte(cpu, addr + 1);
         cpu->pc += 3;
         cpu->cycles += 16;
         break;
@@ -649,7 +652,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("STA    addr: %04x", addr);
 		#endif // Store A direct: from A to memory
-        cpu->memory[addr] = cpu->a;
+        writeByte(cpu, addr, cpu->a);
         cpu->pc += 3;
         cpu->cycles += 13;
         break;
@@ -670,10 +673,10 @@ void Emulate8080Op(State8080* cpu) {
 			printf("INR    M");
 		#endif // Increment value stored in memory at HL
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint8_t value = cpu->memory[addr];
+        uint8_t value = readByte(cpu, addr);
         cpu->flags.ac = ((value & 0x0F) + 1) > 0x0F;
         value += 1;
-        cpu->memory[addr] = value;
+        writeByte(cpu, addr, value);
         setZSPflags(cpu, value);
         cpu->pc += 1;
         cpu->cycles += 10;
@@ -685,10 +688,10 @@ void Emulate8080Op(State8080* cpu) {
 			printf("DCR    M");
 		#endif // Decrement value in memory at HL
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint8_t value = cpu->memory[addr];
+        uint8_t value = readByte(cpu, addr);
         cpu->flags.ac = ((value & 0x0F) == 0);
         value -= 1;
-        cpu->memory[addr] = value;
+        writeByte(cpu, addr, value);
         setZSPflags(cpu, value);
         cpu->pc += 1;
         cpu->cycles += 10;
@@ -700,7 +703,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("MVI    M, %02x", code[1]);
 		#endif // Move immediate to memory (memory designated by HL)
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        cpu->memory[addr] = code[1];
+        writeByte(cpu, addr, code[1]);
         cpu->pc += 2;
         cpu->cycles += 10;
         break;
@@ -744,7 +747,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("LDA    addr: %04x", addr);
 		#endif // Load into A direct from memory
-        cpu->a = cpu->memory[addr];
+        cpu->a = readByte(cpu, addr);
         cpu->pc += 3;
         cpu->cycles += 13;
         break;
@@ -869,7 +872,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    B, M");
 		#endif // Move value at memory (HL) to register B
-        cpu->b = cpu->memory[(cpu->h << 8) | cpu->l];
+        cpu->b = readByte(cpu, (cpu->h << 8) | cpu->l);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -949,7 +952,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    C, M");
 		#endif
-        cpu->c = cpu->memory[(cpu->h << 8) | cpu->l];
+        cpu->c = readByte(cpu, (cpu->h << 8) | cpu->l);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1029,7 +1032,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    D, M");
 		#endif
-        cpu->d = cpu->memory[(cpu->h << 8) | cpu->l];
+        cpu->d = readByte(cpu, (cpu->h << 8) | cpu->l);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1109,7 +1112,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    E, M");
 		#endif
-        cpu->e = cpu->memory[(cpu->h << 8) | cpu->l];
+        cpu->e = readByte(cpu, (cpu->h << 8) | cpu->l);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1189,7 +1192,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    H, M");
 		#endif
-        cpu->h = cpu->memory[(cpu->h << 8) | cpu->l];
+        cpu->h = readByte(cpu, (cpu->h << 8) | cpu->l);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1269,7 +1272,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    L, M");
 		#endif
-        cpu->l = cpu->memory[(cpu->h << 8) | cpu->l];
+        cpu->l = readByte(cpu, (cpu->h << 8) | cpu->l);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1289,7 +1292,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    M, B");
 		#endif
-        cpu->memory[(cpu->h << 8) | cpu->l] = cpu->b;
+        writeByte(cpu, (cpu->h << 8) | cpu->l, cpu->b);
         cpu->pc += 1; cpu->cycles += 7;
         break;
     }
@@ -1298,7 +1301,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    M, C");
 		#endif
-        cpu->memory[(cpu->h << 8) | cpu->l] = cpu->c;
+        writeByte(cpu, (cpu->h << 8) | cpu->l, cpu->c);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1308,7 +1311,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    M, D");
 		#endif
-        cpu->memory[(cpu->h << 8) | cpu->l] = cpu->d;
+        writeByte(cpu, (cpu->h << 8) | cpu->l, cpu->d);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1318,7 +1321,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    M, E");
 		#endif
-        cpu->memory[(cpu->h << 8) | cpu->l] = cpu->e;
+        writeByte(cpu, (cpu->h << 8) | cpu->l, cpu->e);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1328,7 +1331,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    M, H");
 		#endif
-        cpu->memory[(cpu->h << 8) | cpu->l] = cpu->h;
+        writeByte(cpu, (cpu->h << 8) | cpu->l, cpu->h);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1338,7 +1341,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    M, L");
 		#endif
-        cpu->memory[(cpu->h << 8) | cpu->l] = cpu->l;
+        writeByte(cpu, (cpu->h << 8) | cpu->l, cpu->l);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1362,7 +1365,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    M, A");
 		#endif
-        cpu->memory[(cpu->h << 8) | cpu->l] = cpu->a;
+        writeByte(cpu, (cpu->h << 8) | cpu->l, cpu->a);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1432,7 +1435,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("MOV    A, M");
 		#endif
-        cpu->a = cpu->memory[(cpu->h << 8) | cpu->l];
+        cpu->a = readByte(cpu, (cpu->h << 8) | cpu->l);
         cpu->pc += 1;
         cpu->cycles += 7;
         break;
@@ -1537,7 +1540,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("ADD    M");
 		#endif // Adds contents of register M to register A
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint8_t value = cpu->memory[addr];
+        uint8_t value = readByte(cpu, addr);
         uint16_t answer = cpu->a + value;
         cpu->flags.c = (answer > 0xFF);
         cpu->flags.ac = ((cpu->a & 0x0F) + (value & 0x0F)) > 0x0F; // Auxiliary carry
@@ -1651,7 +1654,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("ADC    M");
 		#endif // Adds contents of register M to register A with carry
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint8_t value = cpu->memory[addr];
+        uint8_t value = readByte(cpu, addr);
         uint16_t answer = cpu->a + value + cpu->flags.c;
         cpu->flags.c = (answer > 0xFF);
         cpu->flags.ac = ((cpu->a & 0x0F) + (value & 0x0F) + cpu->flags.c) > 0x0F; // Auxiliary carry
@@ -1765,7 +1768,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("SUB    M");
 		#endif // Subtracts contents of memory[HL] from register A
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint16_t value = cpu->memory[addr];
+        uint16_t value = readByte(cpu, addr);
         uint16_t answer = (uint16_t)cpu->a - value;
         cpu->flags.ac = (cpu->a & 0x0F) < (value & 0x0F);
         cpu->flags.c = (cpu->a < value);
@@ -1879,7 +1882,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("SBB    M");
 		#endif // Subtracts contents of register M from register A with borrow
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint16_t value = cpu->memory[addr];
+        uint16_t value = readByte(cpu, addr);
         uint16_t answer = (uint16_t)cpu->a - value - cpu->flags.c;
         cpu->flags.ac = (cpu->a & 0x0F) < ((value + cpu->flags.c) & 0x0F);
         cpu->flags.c = (cpu->a < (value + cpu->flags.c));
@@ -1987,7 +1990,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("ANA    M");
 		#endif // Register M AND register A
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint8_t value = cpu->memory[addr];
+        uint8_t value = readByte(cpu, addr);
         cpu->a = cpu->a & value;
         cpu->flags.c = 0;
         cpu->flags.ac = ((cpu->a | value) & 0x08) != 0; // Not sure if this is correct, but space-invaders does not use auxiliary carry
@@ -2093,7 +2096,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("XRA    M");
 		#endif // Register B OR register A (exclusive)
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint8_t value = cpu->memory[addr];
+        uint8_t value = readByte(cpu, addr);
         cpu->a = cpu->a ^ value;
         cpu->flags.c = 0;
         cpu->flags.ac = 0;
@@ -2199,7 +2202,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("ORA    M");
 		#endif // Register M OR register A
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint8_t value = cpu->memory[addr];
+        uint8_t value = readByte(cpu, addr);
         cpu->a = cpu->a | value;
         cpu->flags.c = 0;
         cpu->flags.ac = 0;
@@ -2305,7 +2308,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("CMP    M");
 		#endif // Compare register M with register A
         uint16_t addr = (cpu->h << 8) | cpu->l;
-        uint8_t value = cpu->memory[addr];
+        uint8_t value = readByte(cpu, addr);
         uint8_t difference = cpu->a - value;
         cpu->flags.c = (cpu->a < value);
         cpu->flags.ac = (cpu->a & 0x0F) < (value & 0x0F);
@@ -2333,7 +2336,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("RNZ");
 		#endif // Return on no zero: if zero flag is not set, jump to address stored on stack
         if (cpu->flags.z == 0) {
-            cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+            cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
             cpu->sp += 2;
             cpu->cycles += 11;
         }
@@ -2348,8 +2351,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("POP    B");
 		#endif // Pop BC from stack
-        cpu->c = cpu->memory[cpu->sp];
-        cpu->b = cpu->memory[cpu->sp + 1];
+        cpu->c = readByte(cpu, cpu->sp);
+        cpu->b = readByte(cpu, cpu->sp + 1);
         cpu->sp += 2;
         cpu->pc += 1;
         cpu->cycles += 10;
@@ -2389,8 +2392,8 @@ void Emulate8080Op(State8080* cpu) {
 		#endif // Call on non-zero: jump to a new location in memory if the zero flag is not set
         cpu->pc += 3;
         if (cpu->flags.z == 0) {
-            cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-            cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+            writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+            writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
             cpu->sp -= 2;
             cpu->pc = addr;
             cpu->cycles += 17;
@@ -2405,8 +2408,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("PUSH   B");
 		#endif // Push contents of register BC to stack
-        cpu->memory[cpu->sp - 1] = cpu->b;
-        cpu->memory[cpu->sp - 2] = cpu->c;
+        writeByte(cpu, cpu->sp - 1, cpu->b);
+        writeByte(cpu, cpu->sp - 2, cpu->c);
         cpu->sp -= 2;
         cpu->pc += 1;
         cpu->cycles += 11;
@@ -2431,8 +2434,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RST    0");
 		#endif // Restart 0
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = 0x00;
         cpu->cycles += 11;
@@ -2444,7 +2447,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("RZ");
 		#endif // Return on zero: if zero flag is set, jump to address stored on stack
         if (cpu->flags.z) {
-            cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+            cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
             cpu->sp += 2;
             cpu->cycles += 11;
         }
@@ -2459,7 +2462,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RET");
 		#endif // Unconditional return: jump to address on stack
-        cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+        cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
         cpu->sp += 2;
         cpu->cycles += 10;
         break;
@@ -2495,8 +2498,8 @@ void Emulate8080Op(State8080* cpu) {
 		#endif // Call on zero: jump to new location in memory if zero flag is set
         cpu->pc += 3;
         if (cpu->flags.z) {
-            cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-            cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+            writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+            writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
             cpu->sp -= 2;
             cpu->pc = addr;
             cpu->cycles += 17;
@@ -2513,8 +2516,8 @@ void Emulate8080Op(State8080* cpu) {
 			printf("CALL   addr: %04x", addr);
 		#endif // Unconditional call: jump to new location in memory
         cpu->pc += 3;
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = addr;
         cpu->cycles += 17;
@@ -2539,8 +2542,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RST    1");
 		#endif // Restart 1
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = 0x08;
         cpu->cycles += 11;
@@ -2552,7 +2555,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("RNC");
 		#endif // Return on no carry: if carry flag is not set, jump to address stored on stack
         if (cpu->flags.c == 0) {
-            cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+            cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
             cpu->sp += 2;
             cpu->cycles += 11;
         }
@@ -2567,8 +2570,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("POP    D");
 		#endif // Pop DE from stack
-        cpu->e = cpu->memory[cpu->sp];
-        cpu->d = cpu->memory[cpu->sp + 1];
+        cpu->e = readByte(cpu, cpu->sp);
+        cpu->d = readByte(cpu, cpu->sp + 1);
         cpu->sp += 2;
         cpu->pc += 1;
         cpu->cycles += 10;
@@ -2611,8 +2614,8 @@ void Emulate8080Op(State8080* cpu) {
 		#endif // Call on non-carry: jump to a new location in memory if the carry flag is not set
         cpu->pc += 3;
         if (cpu->flags.c == 0) {
-            cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-            cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+            writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+            writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
             cpu->sp -= 2;
             cpu->pc = addr;
             cpu->cycles += 17;
@@ -2627,8 +2630,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("PUSH   D");
 		#endif // Push contents of register DE to stack
-        cpu->memory[cpu->sp - 1] = cpu->d;
-        cpu->memory[cpu->sp - 2] = cpu->e;
+        writeByte(cpu, cpu->sp - 1, cpu->d);
+        writeByte(cpu, cpu->sp - 2, cpu->e);
         cpu->sp -= 2;
         cpu->pc += 1;
         cpu->cycles += 11;
@@ -2653,8 +2656,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RST    2");
 		#endif // Restart 2
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = 0x10;
         cpu->cycles += 11;
@@ -2666,7 +2669,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("RC");
 		#endif // Return on carry: if carry flag is set, jump to address stored on stack
         if (cpu->flags.c) {
-            cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+            cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
             cpu->sp += 2;
             cpu->cycles += 11;
         }
@@ -2681,7 +2684,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RET");
 		#endif // Unconditional return: jump to address on stack
-        cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+        cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
         cpu->sp += 2;
         cpu->cycles += 10;
         break;
@@ -2724,8 +2727,8 @@ void Emulate8080Op(State8080* cpu) {
 		#endif // Call on carry: jump to new location in memory if carry flag is set
         cpu->pc += 3;
         if (cpu->flags.c) {
-            cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-            cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+            writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+            writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
             cpu->sp -= 2;
             cpu->pc = addr;
             cpu->cycles += 17;
@@ -2742,8 +2745,8 @@ void Emulate8080Op(State8080* cpu) {
 			printf("CALL   addr: %04x", addr);
 		#endif // Unconditional call: jump to new location in memory
         cpu->pc += 3;
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = addr;
         cpu->cycles += 17;
@@ -2768,8 +2771,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RST    3");
 		#endif // Restart 3
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = 0x18;
         cpu->cycles += 11;
@@ -2781,7 +2784,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("RPO");
 		#endif // Return on parity odd: if parity flag is odd, jump to address stored on stack
         if (cpu->flags.p == 0) {
-            cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+            cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
             cpu->sp += 2;
             cpu->cycles += 11;
         }
@@ -2796,8 +2799,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("POP    H");
 		#endif // Pop HL from stack
-        cpu->l = cpu->memory[cpu->sp];
-        cpu->h = cpu->memory[cpu->sp + 1];
+        cpu->l = readByte(cpu, cpu->sp);
+        cpu->h = readByte(cpu, cpu->sp + 1);
         cpu->sp += 2;
         cpu->pc += 1;
         cpu->cycles += 10;
@@ -2823,10 +2826,10 @@ void Emulate8080Op(State8080* cpu) {
 		#endif // Exchange contents from HL and top of stack
         uint8_t h = cpu->h;
         uint8_t l = cpu->l;
-        cpu->l = cpu->memory[cpu->sp];
-        cpu->h = cpu->memory[cpu->sp + 1];
-        cpu->memory[cpu->sp] = l;
-        cpu->memory[cpu->sp + 1] = h;
+        cpu->l = readByte(cpu, cpu->sp);
+        cpu->h = readByte(cpu, cpu->sp + 1);
+        writeByte(cpu, cpu->sp, l);
+        writeByte(cpu, cpu->sp + 1, h);
         cpu->pc += 1;
         cpu->cycles += 18;
         break;
@@ -2839,8 +2842,8 @@ void Emulate8080Op(State8080* cpu) {
 		#endif // Call on parity-odd: jump to a new location in memory if the parity flag is odd
         cpu->pc += 3;
         if (cpu->flags.p == 0) {
-            cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-            cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+            writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+            writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
             cpu->sp -= 2;
             cpu->pc = addr;
             cpu->cycles += 17;
@@ -2855,8 +2858,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("PUSH   H");
 		#endif // Push contents of register HL to stack
-        cpu->memory[cpu->sp - 1] = cpu->h;
-        cpu->memory[cpu->sp - 2] = cpu->l;
+        writeByte(cpu, cpu->sp - 1, cpu->h);
+        writeByte(cpu, cpu->sp - 2, cpu->l);
         cpu->sp -= 2;
         cpu->pc += 1;
         cpu->cycles += 11;
@@ -2880,8 +2883,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RST    4");
 		#endif // Restart 4
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = 0x20;
         cpu->cycles += 11;
@@ -2893,7 +2896,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("RPE");
 		#endif // Return on parity even: if parity flag is even, jump to address stored on stack
         if (cpu->flags.p) {
-            cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+            cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
             cpu->sp += 2;
             cpu->cycles += 11;
         }
@@ -2948,8 +2951,8 @@ void Emulate8080Op(State8080* cpu) {
 		#endif // Call on parity-even: jump to a new location in memory if the parity flag is even
         cpu->pc += 3;
         if (cpu->flags.p) {
-            cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-            cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+            writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+            writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
             cpu->sp -= 2;
             cpu->pc = addr;
             cpu->cycles += 17; //should this be CPE?
@@ -2966,8 +2969,8 @@ void Emulate8080Op(State8080* cpu) {
 			printf("CALL   addr: %04x", addr);
 		#endif // Unconditional call: jump to new location in memory
         cpu->pc += 3;
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = addr;
         cpu->cycles += 17;
@@ -2991,8 +2994,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RST    5");
 		#endif // Restart 3
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = 0x28;
         cpu->cycles += 11;
@@ -3004,7 +3007,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("RP");
 		#endif // Return on positive: if sign flag is not set, jump to address stored on stack
         if (cpu->flags.s == 0) {
-            cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+            cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
             cpu->sp += 2;
             cpu->cycles += 11;
         }
@@ -3019,8 +3022,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("POP    PSW");
 		#endif // Pop A and flags from stack
-        uint8_t flags = cpu->memory[cpu->sp];
-        cpu->a = cpu->memory[cpu->sp + 1];
+        uint8_t flags = readByte(cpu, cpu->sp);
+        cpu->a = readByte(cpu, cpu->sp + 1);
 
         cpu->flags.c = flags & 1;
         cpu->flags.p = (flags >> 2) & 1;
@@ -3064,8 +3067,8 @@ void Emulate8080Op(State8080* cpu) {
 		#endif // Call on positive: jump to a new location in memory if the sign flag is not set
         cpu->pc += 3;
         if (cpu->flags.s == 0) {
-            cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-            cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+            writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+            writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
             cpu->sp -= 2;
             cpu->pc = addr;
             cpu->cycles += 17;
@@ -3080,7 +3083,7 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("PUSH   PSW");
 		#endif // Push contents of register A and flags to stack
-        cpu->memory[cpu->sp - 1] = cpu->a;
+        writeByte(cpu, cpu->sp - 1, cpu->a);
 
         uint8_t flags = 0;
         flags |= cpu->flags.s << 7;
@@ -3090,7 +3093,7 @@ void Emulate8080Op(State8080* cpu) {
         flags |= 1 << 1;
         flags |= cpu->flags.c;
 
-        cpu->memory[cpu->sp - 2] = flags;
+        writeByte(cpu, cpu->sp - 2, flags);
         cpu->sp -= 2;
         cpu->pc += 1;
         cpu->cycles += 11;
@@ -3114,8 +3117,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RST    6");
 		#endif // Restart 6
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = 0x30;
         cpu->cycles += 11;
@@ -3127,7 +3130,7 @@ void Emulate8080Op(State8080* cpu) {
 			printf("RM");
 		#endif // Return on minus: if sign flag is set, jump to address stored on stack
         if (cpu->flags.s) {
-            cpu->pc = (cpu->memory[cpu->sp + 1] << 8) | cpu->memory[cpu->sp];
+            cpu->pc = (readByte(cpu, cpu->sp + 1) << 8) | readByte(cpu, cpu->sp);
             cpu->sp += 2;
             cpu->cycles += 11;
         }
@@ -3178,8 +3181,8 @@ void Emulate8080Op(State8080* cpu) {
 		#endif // Call on minus: jump to new location in memory if sign flag is set
         cpu->pc += 3;
         if (cpu->flags.s == 0) {
-            cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-            cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+            writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+            writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
             cpu->sp -= 2;
             cpu->pc = addr;
             cpu->cycles += 17;
@@ -3196,8 +3199,8 @@ void Emulate8080Op(State8080* cpu) {
 			printf("CALL   addr: %04x", addr);
 		#endif // Unconditional call: jump to new location in memory
         cpu->pc += 3;
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = addr;
         cpu->cycles += 17;
@@ -3221,8 +3224,8 @@ void Emulate8080Op(State8080* cpu) {
         #ifdef DEBUG
 			printf("RST    7");
 		#endif // Restart 7
-        cpu->memory[cpu->sp - 1] = (cpu->pc >> 8) & 0xFF;
-        cpu->memory[cpu->sp - 2] = cpu->pc & 0xFF;
+        writeByte(cpu, cpu->sp - 1, (cpu->pc >> 8) & 0xFF);
+        writeByte(cpu, cpu->sp - 2, cpu->pc & 0xFF);
         cpu->sp -= 2;
         cpu->pc = 0x38;
         cpu->cycles += 11;
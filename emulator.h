@@ -52,10 +52,6 @@ struct State8080 {
 */
 void setZSPflags(State8080* cpu, uint8_t result);
 
-uint8_t input_port(State8080* cpu, uint8_t port); //Is this necessary with it in the io_ports.h file?
-
-void output_port(State8080* cpu, uint8_t port, uint8_t a);//Is this necessary with it in the io_ports.h file?
-
 /**
 * Emulates the Intel 8080 cpu. The cpu has been initialized and the
 * rom file should be loaded into memory. This function reads the
@@ -68,3 +64,14 @@ void output_port(State8080* cpu, uint8_t port, uint8_t a);//Is this necessary wi
 * @return void: executes instruction sets and updates cpu state.
 */
 void Emulate8080Op(State8080* cpu);
+
+/**
+* Packs the condition flags into the PSW byte pushed by PUSH PSW
+* (S Z 0 AC 0 P 1 CY, bit 7 first).
+*
+* @param cpu State of the cpu object.
+* @return flags byte.
+*/
+inline uint8_t packFlags(const State8080* cpu) {
+    return (cpu->flags.s << 7) | (cpu->flags.z << 6) | (cpu->flags.ac << 4) | (cpu->flags.p << 2) | (1 << 1) | cpu->flags.c;
+}
@@ -0,0 +1,585 @@
+#if defined(_WIN32) || defined(_WIN64)
+    // Before Windows.h (via initcpu.h) so it does not pull in winsock 1
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    typedef SOCKET SocketHandle;
+    #define closeSocket(s) closesocket((SocketHandle)(s))
+#else
+    #include <sys/socket.h>
+    #include <sys/select.h>
+    #include <sys/un.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    typedef int SocketHandle;
+    #define closeSocket(s) close((SocketHandle)(s))
+#endif
+
+#include "gdbstub.h"
+#include "emulator.h"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+// Largest 'm' request answered in one reply (PacketSize below is in hex)
+#define GDB_MAX_MEMORY 0x1000
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void appendHexByte(std::string& out, uint8_t value) {
+    out += HEX_DIGITS[value >> 4];
+    out += HEX_DIGITS[value & 0x0F];
+}
+
+/**
+* @return the byte at {text}, or -1 if it is not two hex digits.
+*/
+static int parseHexByte(const char* text) {
+    int hi = hexValue(text[0]);
+    int lo = hi < 0 ? -1 : hexValue(text[1]);
+    return lo < 0 ? -1 : (hi << 4) | lo;
+}
+
+// --- Network thread ---
+
+/**
+* @return true if {socket} has data (or a connection) within {timeout_ms}.
+*/
+static bool waitReadable(intptr_t socket, int timeout_ms) {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET((SocketHandle)socket, &set);
+    timeval timeout = { 0, timeout_ms * 1000 };
+    return select((int)socket + 1, &set, nullptr, nullptr, &timeout) > 0;
+}
+
+static bool sendAll(intptr_t socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int n = send((SocketHandle)socket, data.data() + sent, (int)(data.size() - sent), 0);
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+/**
+* Hands {command} to the emulation thread, waiting while its queue is full.
+*/
+static void pushCommand(GdbStub* stub, GdbCommand command) {
+    while (!stub->commands.push(command) && !stub->quit) {
+        std::this_thread::yield();
+    }
+}
+
+static void networkLoop(GdbStub* stub) {
+    enum { IDLE, BODY, ESCAPE, CHECK_HI, CHECK_LO } rx = IDLE;
+    intptr_t client = -1;
+    bool no_ack = false;
+    std::string packet;
+    uint8_t sum = 0;
+    int check_hi = 0;
+
+    while (!stub->quit) {
+        if (client < 0) {
+            if (!waitReadable(stub->listen_socket, 100)) {
+                continue;
+            }
+            client = (intptr_t)accept((SocketHandle)stub->listen_socket, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            int one = 1;
+            setsockopt((SocketHandle)client, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one)); // fails harmlessly on Unix sockets
+            rx = IDLE;
+            no_ack = false;
+            pushCommand(stub, { GDB_CONNECTED, std::string() });
+            continue;
+        }
+
+        std::string out, reply;
+        while (stub->replies.pop(&reply)) {
+            uint8_t reply_sum = 0;
+            for (char c : reply) reply_sum += (uint8_t)c;
+            out += '$';
+            out += reply;
+            out += '#';
+            appendHexByte(out, reply_sum);
+        }
+        if (!out.empty()) {
+            sendAll(client, out);
+        }
+
+        if (!waitReadable(client, 2)) {
+            continue;
+        }
+        char buffer[1024];
+        int received = recv((SocketHandle)client, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            closeSocket(client);
+            client = -1;
+            pushCommand(stub, { GDB_DISCONNECTED, std::string() });
+            continue;
+        }
+
+        for (int i = 0; i < received; i++) {
+            char c = buffer[i];
+            switch (rx) {
+            case IDLE:
+                if (c == '$') {
+                    packet.clear();
+                    sum = 0;
+                    rx = BODY;
+                }
+                else if (c == 0x03) {
+                    pushCommand(stub, { GDB_INTERRUPT, std::string() });
+                }
+                break; // '+' and '-' acks are not tracked: nothing is resent
+            case BODY:
+            case ESCAPE:
+                if (rx == BODY && c == '#') {
+                    rx = CHECK_HI;
+                    break;
+                }
+                sum += (uint8_t)c;
+                if (rx == BODY && c == '}') {
+                    rx = ESCAPE;
+                    break;
+                }
+                packet += (rx == ESCAPE) ? (char)(c ^ 0x20) : c;
+                rx = BODY;
+                break;
+            case CHECK_HI:
+                check_hi = hexValue(c);
+                rx = CHECK_LO;
+                break;
+            case CHECK_LO: {
+                rx = IDLE;
+                bool valid = check_hi >= 0 && hexValue(c) >= 0 && ((check_hi << 4) | hexValue(c)) == sum;
+                if (!no_ack) {
+                    sendAll(client, valid ? "+" : "-");
+                }
+                if (!valid) {
+                    break;
+                }
+                if (packet == "QStartNoAckMode") {
+                    sendAll(client, "$OK#9a");
+                    no_ack = true;
+                    break;
+                }
+                pushCommand(stub, { GDB_PACKET, packet });
+                break;
+            }
+            }
+        }
+    }
+    if (client >= 0) {
+        closeSocket(client);
+    }
+}
+
+bool startGdbStub(GdbStub* stub, const char* address) {
+#if defined(_WIN32) || defined(_WIN64)
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        std::cerr << "WSAStartup failed\n";
+        return false;
+    }
+#endif
+    intptr_t listener;
+    if (!strncmp(address, "unix:", 5)) {
+#if defined(_WIN32) || defined(_WIN64)
+        std::cerr << "Unix domain sockets are not supported on Windows, use a TCP port\n";
+        return false;
+#else
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(addr.sun_path)) {
+            std::cerr << "Socket path too long: " << address + 5 << "\n";
+            return false;
+        }
+        strcpy(addr.sun_path, address + 5);
+        unlink(addr.sun_path);
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || bind((SocketHandle)listener, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            std::cerr << "Cannot bind GDB socket " << addr.sun_path << "\n";
+            if (listener >= 0) closeSocket(listener);
+            return false;
+        }
+        stub->unix_path = addr.sun_path;
+#endif
+    }
+    else {
+        int port = atoi(address);
+        if (port <= 0 || port > 0xFFFF) {
+            std::cerr << "Bad GDB port " << address << "\n";
+            return false;
+        }
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons((uint16_t)port);
+        listener = (intptr_t)socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt((SocketHandle)listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+        if (listener < 0 || bind((SocketHandle)listener, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            std::cerr << "Cannot bind GDB port " << port << "\n";
+            if (listener >= 0) closeSocket(listener);
+            return false;
+        }
+    }
+    if (listen((SocketHandle)listener, 1) != 0) {
+        std::cerr << "Cannot listen on GDB socket\n";
+        closeSocket(listener);
+        return false;
+    }
+    stub->listen_socket = listener;
+    stub->quit = false;
+    stub->thread = std::thread(networkLoop, stub);
+    std::cout << "Waiting for GDB on " << address << "\n";
+    return true;
+}
+
+void stopGdbStub(GdbStub* stub) {
+    if (stub->listen_socket < 0) {
+        return;
+    }
+    stub->quit = true;
+    stub->thread.join();
+    closeSocket(stub->listen_socket);
+    stub->listen_socket = -1;
+#if defined(_WIN32) || defined(_WIN64)
+    WSACleanup();
+#else
+    if (!stub->unix_path.empty()) {
+        unlink(stub->unix_path.c_str());
+    }
+#endif
+}
+
+// --- Emulation thread ---
+
+static uint16_t readRegister(const State8080* cpu, int index) {
+    switch (index) {
+    case 0: return (cpu->a << 8) | packFlags(cpu);
+    case 1: return (cpu->b << 8) | cpu->c;
+    case 2: return (cpu->d << 8) | cpu->e;
+    case 3: return (cpu->h << 8) | cpu->l;
+    case 4: return cpu->sp;
+    case 5: return cpu->pc;
+    }
+    return 0;
+}
+
+static void writeRegister(State8080* cpu, int index, uint16_t value) {
+    uint8_t hi = value >> 8, lo = value & 0xFF;
+    switch (index) {
+    case 0:
+        cpu->a = hi;
+        cpu->flags.s = (lo >> 7) & 1;
+        cpu->flags.z = (lo >> 6) & 1;
+        cpu->flags.ac = (lo >> 4) & 1;
+        cpu->flags.p = (lo >> 2) & 1;
+        cpu->flags.c = lo & 1;
+        break;
+    case 1: cpu->b = hi; cpu->c = lo; break;
+    case 2: cpu->d = hi; cpu->e = lo; break;
+    case 3: cpu->h = hi; cpu->l = lo; break;
+    case 4: cpu->sp = value; break;
+    case 5: cpu->pc = value; break;
+    }
+}
+
+#define GDB_REGISTER_COUNT 6
+
+/**
+* Stop reply for debugger->stop: SIGINT for interrupts, SIGTRAP for the
+* rest, with the address of a watch hit.
+*/
+static std::string stopReply(const State8080* cpu) {
+    const DebugStop& stop = cpu->debugger->stop;
+    if (stop.reason == DEBUG_STOP_REQUEST) {
+        return "S02";
+    }
+    if (stop.reason != DEBUG_STOP_WATCH_READ && stop.reason != DEBUG_STOP_WATCH_WRITE) {
+        return "S05";
+    }
+    uint8_t kinds = cpu->debugger->watchpoints[stop.index].kinds;
+    const char* name = kinds == (WATCH_READ | WATCH_WRITE) ? "awatch" : (kinds == WATCH_READ ? "rwatch" : "watch");
+    char reply[32];
+    snprintf(reply, sizeof(reply), "T05%s:%04x;", name, stop.addr);
+    return reply;
+}
+
+/**
+* Parses "ADDR,LEN" (hex) at {text}.
+*
+* @return pointer past the parsed text, or nullptr if malformed.
+*/
+static const char* parseRange(const char* text, unsigned* addr, unsigned* length) {
+    char* end;
+    *addr = strtoul(text, &end, 16);
+    if (end == text || *end != ',') {
+        return nullptr;
+    }
+    text = end + 1;
+    *length = strtoul(text, &end, 16);
+    if (end == text || *addr > 0xFFFF) {
+        return nullptr;
+    }
+    return end;
+}
+
+/**
+* Inserts or removes a Z0 - Z4 breakpoint or watchpoint.
+*/
+static bool handleBreakpoint(State8080* cpu, GdbStub* stub, const std::string& packet) {
+    int type = packet[1] - '0';
+    unsigned addr, length;
+    if (packet.size() < 3 || packet[2] != ',' || !parseRange(packet.c_str() + 3, &addr, &length)) {
+        return false;
+    }
+    bool insert = packet[0] == 'Z';
+    if (type == 0 || type == 1) {
+        if (insert) {
+            addBreakpoint(cpu, (uint16_t)addr);
+            stub->breakpoints.push_back((uint16_t)addr);
+        }
+        else {
+            removeBreakpoint(cpu, (uint16_t)addr);
+            std::vector<uint16_t>& list = stub->breakpoints;
+            list.erase(std::remove(list.begin(), list.end(), (uint16_t)addr), list.end());
+        }
+        return true;
+    }
+    static const uint8_t KINDS[] = { WATCH_WRITE, WATCH_READ, WATCH_READ | WATCH_WRITE };
+    if (type < 2 || type > 4) {
+        return false;
+    }
+    uint8_t kinds = KINDS[type - 2];
+    uint16_t last = (uint16_t)(addr + (length ? length : 1) - 1 > 0xFFFF ? 0xFFFF : addr + (length ? length : 1) - 1);
+    if (insert) {
+        addWatchpoint(cpu, (uint16_t)addr, last, kinds);
+        stub->watchpoints.push_back({ (uint16_t)addr, last, kinds, 0 });
+    }
+    else {
+        removeWatchpoint(cpu, (uint16_t)addr, last, kinds);
+        std::vector<Watchpoint>& list = stub->watchpoints;
+        list.erase(std::remove_if(list.begin(), list.end(), [&](const Watchpoint& watch) {
+            return watch.start == addr && watch.end == last && watch.kinds == kinds;
+        }), list.end());
+    }
+    return true;
+}
+
+/**
+* Runs one packet against the CPU.
+*
+* @param reply Filled with the response.
+* @return false if the packet takes no immediate response (c, k).
+*/
+static bool handlePacket(State8080* cpu, GdbStub* stub, const std::string& packet, std::string* reply) {
+    const char* args = packet.c_str() + 1;
+    unsigned addr, length;
+    char* end;
+    reply->clear();
+
+    switch (packet.empty() ? 0 : packet[0]) {
+    case '?':
+        *reply = stopReply(cpu);
+        return true;
+    case 'g':
+        for (int i = 0; i < GDB_REGISTER_COUNT; i++) {
+            uint16_t value = readRegister(cpu, i);
+            appendHexByte(*reply, value & 0xFF);
+            appendHexByte(*reply, value >> 8);
+        }
+        return true;
+    case 'G':
+        if (packet.size() < 1 + GDB_REGISTER_COUNT * 4) {
+            *reply = "E01";
+            return true;
+        }
+        for (int i = 0; i < GDB_REGISTER_COUNT; i++) {
+            int lo = parseHexByte(args + i * 4), hi = parseHexByte(args + i * 4 + 2);
+            if (lo < 0 || hi < 0) {
+                *reply = "E01";
+                return true;
+            }
+            writeRegister(cpu, i, (uint16_t)((hi << 8) | lo));
+        }
+        *reply = "OK";
+        return true;
+    case 'p': {
+        unsigned index = strtoul(args, &end, 16);
+        if (end == args || index >= GDB_REGISTER_COUNT) {
+            *reply = "E01";
+            return true;
+        }
+        uint16_t value = readRegister(cpu, index);
+        appendHexByte(*reply, value & 0xFF);
+        appendHexByte(*reply, value >> 8);
+        return true;
+    }
+    case 'P': {
+        unsigned index = strtoul(args, &end, 16);
+        int lo = *end == '=' ? parseHexByte(end + 1) : -1;
+        int hi = lo < 0 ? -1 : parseHexByte(end + 3);
+        if (end == args || index >= GDB_REGISTER_COUNT || hi < 0) {
+            *reply = "E01";
+            return true;
+        }
+        writeRegister(cpu, index, (uint16_t)((hi << 8) | lo));
+        *reply = "OK";
+        return true;
+    }
+    case 'm':
+        if (!parseRange(args, &addr, &length)) {
+            *reply = "E01";
+            return true;
+        }
+        for (unsigned i = 0; i < length && i < GDB_MAX_MEMORY; i++) {
+            appendHexByte(*reply, peekMemory(cpu, (uint16_t)(addr + i)));
+        }
+        return true;
+    case 'M': {
+        const char* data = parseRange(args, &addr, &length);
+        if (!data || *data != ':' || strlen(data + 1) < length * 2) {
+            *reply = "E01";
+            return true;
+        }
+        for (unsigned i = 0; i < length; i++) {
+            int value = parseHexByte(data + 1 + i * 2);
+            if (value < 0 || !pokeMemory(cpu, (uint16_t)(addr + i), (uint8_t)value)) {
+                *reply = "E01";
+                return true;
+            }
+        }
+        *reply = "OK";
+        return true;
+    }
+    case 'c':
+        if (*args) {
+            cpu->pc = (uint16_t)strtoul(args, nullptr, 16);
+        }
+        stub->run_state = GDB_RUNNING;
+        return false;
+    case 's':
+        if (*args) {
+            cpu->pc = (uint16_t)strtoul(args, nullptr, 16);
+        }
+        stepInstruction(cpu);
+        *reply = stopReply(cpu);
+        return true;
+    case 'Z':
+    case 'z':
+        *reply = handleBreakpoint(cpu, stub, packet) ? "OK" : "";
+        return true;
+    case 'D':
+        detachGdbClient(cpu, stub);
+        *reply = "OK";
+        return true;
+    case 'k':
+        detachGdbClient(cpu, stub);
+        return false;
+    case 'H':
+        *reply = "OK";
+        return true;
+    case 'q':
+        if (!packet.compare(0, 11, "qSupported:") || packet == "qSupported") *reply = "PacketSize=4000;QStartNoAckMode+";
+        else if (packet == "qAttached") *reply = "1";
+        else if (packet == "qC") *reply = "QC1";
+        else if (packet == "qfThreadInfo") *reply = "m1";
+        else if (packet == "qsThreadInfo") *reply = "l";
+        return true;
+    case 'T':
+        *reply = "OK";
+        return true;
+    default:
+        return true; // Empty reply: not supported
+    }
+}
+
+static void attachClient(State8080* cpu, GdbStub* stub) {
+    stub->own_debugger = cpu->debugger == nullptr;
+    if (stub->own_debugger) {
+        stub->debugger = Debugger();
+        attachDebugger(cpu, &stub->debugger);
+    }
+    cpu->debugger->stop = {};
+    cpu->debugger->stop.pc = cpu->pc;
+    stub->run_state = GDB_HALTED;
+    std::cout << "GDB attached at " << std::hex << cpu->pc << std::dec << "\n";
+}
+
+void detachGdbClient(State8080* cpu, GdbStub* stub) {
+    if (stub->run_state == GDB_NO_CLIENT) {
+        return;
+    }
+    for (uint16_t addr : stub->breakpoints) {
+        removeBreakpoint(cpu, addr);
+    }
+    for (const Watchpoint& watch : stub->watchpoints) {
+        removeWatchpoint(cpu, watch.start, watch.end, watch.kinds);
+    }
+    stub->breakpoints.clear();
+    stub->watchpoints.clear();
+    if (stub->own_debugger) {
+        detachDebugger(cpu);
+        stub->own_debugger = false;
+    }
+    stub->run_state = GDB_NO_CLIENT;
+    std::cout << "GDB detached\n";
+}
+
+GdbRunState serviceGdbStub(State8080* cpu, GdbStub* stub) {
+    GdbCommand command;
+    while (stub->commands.pop(&command)) {
+        switch (command.type) {
+        case GDB_CONNECTED:
+            detachGdbClient(cpu, stub);
+            attachClient(cpu, stub);
+            break;
+        case GDB_DISCONNECTED:
+            detachGdbClient(cpu, stub);
+            break;
+        case GDB_INTERRUPT:
+            if (stub->run_state == GDB_RUNNING) {
+                requestDebugStop(cpu); // Reported through reportGdbStop once runFrame stops
+            }
+            break;
+        case GDB_PACKET: {
+            if (stub->run_state == GDB_NO_CLIENT) {
+                break;
+            }
+            std::string reply;
+            if (handlePacket(cpu, stub, command.packet, &reply)) {
+                stub->replies.push(reply); // GDB waits for each reply, so the queue never fills
+            }
+            break;
+        }
+        }
+    }
+    return stub->run_state;
+}
+
+bool reportGdbStop(State8080* cpu, GdbStub* stub) {
+    if (stub->run_state == GDB_NO_CLIENT) {
+        return false;
+    }
+    stub->replies.push(stopReply(cpu));
+    stub->run_state = GDB_HALTED;
+    return true;
+}
@@ -0,0 +1,107 @@
+#ifndef GDB_STUB_H
+#define GDB_STUB_H
+
+#include "initcpu.h"
+#include "debugger.h"
+#include "spscqueue.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * GDB remote serial protocol stub.
+ *
+ * A network thread owns the socket. It frames and acknowledges packets
+ * and turns the 0x03 break byte into an interrupt. Everything that
+ * touches the CPU runs on the emulation thread. The two threads only
+ * share a pair of SpscQueues: commands flow to the emulation thread and
+ * replies flow back. The emulation thread drains its queue once per
+ * frame in serviceGdbStub.
+ *
+ * The stub attaches a Debugger only while a client is connected. With no
+ * client, runFrame keeps its no-debugger loop and the stub costs one
+ * queue check per frame.
+ *
+ * Registers ('g'/'G'/'p'/'P') are af bc de hl sp pc, 16 bits each,
+ * little endian: the first six registers of GDB's z80 target. Supported
+ * packets: ? g G p P m M c s Z0-Z4 z0-z4 D k, qSupported, qAttached,
+ * QStartNoAckMode and the thread queries GDB asks for at connect.
+ *
+ * Usage: --gdb 1234 (localhost TCP) or --gdb unix:/tmp/invaders.sock,
+ * then "target remote localhost:1234" in GDB.
+ */
+
+#define GDB_QUEUE_SIZE 64
+
+enum GdbCommandType : uint8_t {
+    GDB_CONNECTED, GDB_DISCONNECTED, GDB_PACKET, GDB_INTERRUPT
+};
+
+struct GdbCommand {
+    GdbCommandType type = GDB_PACKET;
+    std::string packet;     // payload between '$' and '#', GDB_PACKET only
+};
+
+enum GdbRunState : uint8_t {
+    GDB_NO_CLIENT,      // emulation runs normally
+    GDB_HALTED,         // client holds the CPU; the caller must not run frames
+    GDB_RUNNING         // client continued; stops are reported to it
+};
+
+struct GdbStub {
+    // Network thread
+    std::thread thread;
+    std::atomic<bool> quit{ false };
+    intptr_t listen_socket = -1;
+    std::string unix_path;
+
+    SpscQueue<GdbCommand, GDB_QUEUE_SIZE> commands;    // network -> emulation
+    SpscQueue<std::string, GDB_QUEUE_SIZE> replies;    // emulation -> network
+
+    // Emulation thread
+    GdbRunState run_state = GDB_NO_CLIENT;
+    Debugger debugger;                      // used when the CPU has no debugger of its own
+    bool own_debugger = false;
+    std::vector<uint16_t> breakpoints;      // inserted by the client, removed when it leaves
+    std::vector<Watchpoint> watchpoints;
+};
+
+/**
+* Opens the listening socket and starts the network thread.
+*
+* @param address Port number for localhost TCP, or "unix:PATH" for a
+*        Unix domain socket (not on Windows).
+* @return false, after printing why, if the socket could not be opened.
+*/
+bool startGdbStub(GdbStub* stub, const char* address);
+
+/**
+* Closes the sockets and joins the network thread. Call detachGdbClient
+* first if a client may still hold the CPU.
+*/
+void stopGdbStub(GdbStub* stub);
+
+/**
+* Runs the client's queued commands against {cpu}. Call once per frame,
+* and keep calling while it returns GDB_HALTED instead of running frames.
+*
+* @return Where the client wants the CPU.
+*/
+GdbRunState serviceGdbStub(State8080* cpu, GdbStub* stub);
+
+/**
+* Call when runFrame returns false. Sends the stop to a connected client
+* and halts the CPU for it.
+*
+* @return false if no client is connected, so the caller handles the stop.
+*/
+bool reportGdbStop(State8080* cpu, GdbStub* stub);
+
+/**
+* Drops the client's breakpoints and watchpoints and lets the CPU run.
+* Breakpoints the client shares an address with are removed too.
+*/
+void detachGdbClient(State8080* cpu, GdbStub* stub);
+
+#endif
@@ -0,0 +1,497 @@
+/*
+ * Headless runner for the intel8080 emulator.
+ *
+ * Runs the ROM without video, audio or keyboard so it can be used on
+ * build and farm hosts for regression runs, benchmarks and search.
+ *
+ * ./SpaceInvadersHeadless ./path/to/invaders [--frames N] [--inputs file] [--autostart]
+ * ./SpaceInvadersHeadless ./path/to/invaders --autostart --fork-at 600 --workers 8 --branch-frames 1800
+ *
+ * ./SpaceInvadersHeadless ./path/to/invaders --autostart --frames 100000 --trajectory run.traj
+ *
+ * --coverage run.cov records every executed address; merge and export
+ * runs with SpaceInvadersCoverage.
+ *
+ * --trace run.trace keeps the last --trace-size instructions (default 1M)
+ * in a binary ring, optionally only pcs in --trace-range START-END or only
+ * from --trace-trigger PC[:COUNT] on (hex). Decode with SpaceInvadersTrace.
+ * --hash-stream run.hashes writes the state hash at every frame; compare
+ * two runs with SpaceInvadersTraceDiff.
+ *
+ * --audio-null mixes the sound in step with the emulation and prints its
+ * hash; --audio-wav run.wav also writes it out. Neither needs a sound
+ * card. --synth synthesizes the effects instead of using the samples.
+ *
+ * With -DPROFILE_MEMORY=ON, --profile-memory run writes run.ppm (access
+ * heatmap) and run.txt (region totals, hottest lines and instructions).
+ *
+ * Input files hold one "<frame> <port1 hex>" pair per line; port 1 keeps
+ * the value from that frame onwards.
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <sys/types.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+    #include <limits.h>
+#endif
+
+#include "loadrom.h"
+#include "machine.h"
+#include "pagetable.h"
+#include "trajectory.h"
+#include "observation.h"
+#include "memprofile.h"
+#include "coverage.h"
+#include "trace.h"
+#include "sound.h"
+
+/**
+* Result record a forked worker streams back to the parent. Kept well
+* under PIPE_BUF so writes from many workers never interleave.
+*/
+struct BranchRecord {
+    uint32_t worker;
+    uint32_t frame;
+    uint32_t score;
+    uint32_t hash;
+    uint32_t done;
+};
+
+struct HeadlessOptions {
+    const char* rom_path = nullptr;
+    const char* input_path = nullptr;
+    const char* trajectory_path = nullptr;
+    uint16_t trajectory_ram_start = 0x2000;
+    uint16_t trajectory_ram_size = 0x400; // Work RAM, below VRAM
+    uint32_t frames = 600;
+    bool autostart = false;
+    int fork_at = -1;
+    int workers = 4;
+    uint32_t branch_frames = 1800;
+    uint32_t report_every = 300;
+    uint32_t seed = 1;
+    uint32_t observation_bench = 0;
+    const char* profile_prefix = nullptr;
+    const char* coverage_path = nullptr;
+    const char* trace_path = nullptr;
+    uint32_t trace_size = TRACE_DEFAULT_RECORDS;
+    const char* trace_range = nullptr;
+    const char* trace_trigger = nullptr;
+    const char* hash_stream_path = nullptr;
+    bool audio = false;
+    const char* audio_wav_path = nullptr;
+    bool synth = false;
+};
+
+/**
+* Per-frame outputs of the main run, see recordFrame.
+*/
+struct FrameRecorders {
+    TrajectoryWriter* trajectory = nullptr;
+    FILE* hash_stream = nullptr;
+    bool sound = false;
+};
+
+/**
+* Reads "<frame> <port1 hex>" pairs from {path}.
+*
+* @return false if the file could not be opened.
+*/
+static bool loadInputs(const char* path, std::vector<InputChange>& inputs) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    uint32_t frame;
+    std::string value;
+    while (in >> frame >> value) {
+        inputs.push_back({ frame, (uint8_t)strtoul(value.c_str(), nullptr, 16) });
+    }
+    std::sort(inputs.begin(), inputs.end(),
+        [](const InputChange& x, const InputChange& y) { return x.frame < y.frame; });
+    return true;
+}
+
+/**
+* Times the observation kernels on the current VRAM contents.
+*/
+static void benchObservations(const State8080* state, uint32_t iterations) {
+    static uint8_t full[OBS_SCREEN_WIDTH * OBS_SCREEN_HEIGHT];
+    static uint8_t pooled[OBS_POOLED_WIDTH * OBS_POOLED_HEIGHT];
+    static float pooled_f[OBS_POOLED_WIDTH * OBS_POOLED_HEIGHT];
+    static uint8_t small[84 * 84];
+    static float small_f[84 * 84];
+    static uint8_t stack[4][84 * 84];
+    const uint8_t* vram = state->memory + 0x2400;
+    ObservationResizer resizer;
+    initObservationResizer(&resizer, 84, 84);
+
+    auto time = [&](const char* name, auto kernel) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++) {
+            kernel();
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        printf("%-28s %8.0f ns/frame\n", name, ns / iterations);
+    };
+    time("unpack 224x256 u8", [&] { unpackScreen(vram, full); });
+    time("max pool 112x128 u8", [&] { maxPoolScreen(vram, pooled); });
+    time("max pool 112x128 f32", [&] { maxPoolScreen(vram, pooled_f); });
+    time("max 84x84 u8", [&] { resizeScreenMax(&resizer, vram, small); });
+    time("area 84x84 u8", [&] { resizeScreenArea(&resizer, vram, small); });
+    time("area 84x84 f32", [&] { resizeScreenArea(&resizer, vram, small_f); });
+    time("area 84x84 u8 + stack of 4", [&] {
+        resizeScreenArea(&resizer, vram, small);
+        pushFrameStack(stack, sizeof(small), 4, small);
+    });
+}
+
+static void recordFrame(State8080* state, uint32_t frame, void* context) {
+    FrameRecorders* recorders = (FrameRecorders*)context;
+    if (recorders->trajectory) {
+        appendTrajectoryFrame(recorders->trajectory, state, *state->ports.port1);
+    }
+    if (recorders->hash_stream) {
+        appendStateHash(recorders->hash_stream, state, frame);
+    }
+    if (recorders->sound) {
+        renderSound(state);
+    }
+}
+
+static uint32_t xorshift32(uint32_t* s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+/**
+* Body of a forked worker. The machine state was inherited copy-on-write
+* from the parent; only the pages this branch dirties get copied.
+*/
+static void runBranch(State8080* state, const HeadlessOptions& opt, int worker, int fd) {
+    static const uint8_t moves[] = {
+        0, INPUT_P1_FIRE, INPUT_P1_LEFT, INPUT_P1_RIGHT,
+        INPUT_P1_LEFT | INPUT_P1_FIRE, INPUT_P1_RIGHT | INPUT_P1_FIRE
+    };
+    uint32_t rng = opt.seed * 2654435761u + (uint32_t)worker * 40503u + 1;
+    BranchRecord rec = { (uint32_t)worker, 0, 0, 0, 0 };
+
+    for (uint32_t frame = 1; frame <= opt.branch_frames; ++frame) {
+        // Hold each move for a few frames, the game only polls once per frame
+        if (frame % 8 == 1) {
+            *state->ports.port1 = moves[xorshift32(&rng) % sizeof(moves)] | INPUT_ALWAYS_SET;
+        }
+        runFrame(state);
+
+        if (frame % opt.report_every == 0 || frame == opt.branch_frames) {
+            rec.frame = frame;
+            rec.score = readScore(state);
+            rec.hash = hashState(state);
+            rec.done = (frame == opt.branch_frames);
+            if (write(fd, &rec, sizeof(rec)) != sizeof(rec)) {
+                break;
+            }
+        }
+    }
+}
+
+/**
+* Forks {opt.workers} children from the current state and collects their
+* result records over one shared pipe.
+*
+* @return 0 on success, 1 on failure.
+*/
+static int forkBranches(State8080* state, const HeadlessOptions& opt) {
+    static_assert(sizeof(BranchRecord) <= PIPE_BUF, "pipe writes must stay atomic");
+
+    int fds[2];
+    if (pipe(fds) == -1) {
+        std::cerr << "Failed to create result pipe." << std::endl;
+        return 1;
+    }
+
+    // Anything still buffered would otherwise be flushed once per child
+    std::cout.flush();
+    fflush(stdout);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<pid_t> children;
+    for (int worker = 0; worker < opt.workers; ++worker) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            std::cerr << "fork() failed after " << worker << " workers." << std::endl;
+            break;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            runBranch(state, opt, worker, fds[1]);
+            close(fds[1]);
+            _exit(0);
+        }
+        children.push_back(pid);
+    }
+    close(fds[1]);
+
+    std::vector<BranchRecord> finals;
+    BranchRecord rec;
+    ssize_t got;
+    while ((got = read(fds[0], &rec, sizeof(rec))) == sizeof(rec)) {
+        if (rec.done) {
+            finals.push_back(rec);
+        } else {
+            std::cout << "worker " << rec.worker << " frame " << rec.frame << " score " << rec.score << "\n";
+        }
+    }
+    close(fds[0]);
+
+    int failed = 0;
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(finals.begin(), finals.end(),
+        [](const BranchRecord& x, const BranchRecord& y) { return x.score > y.score; });
+    for (const BranchRecord& r : finals) {
+        printf("worker %3u  score %4u  hash %08x\n", r.worker, r.score, r.hash);
+    }
+    printf("%zu/%zu branches finished, %u frames each, %.2f s (%.0f frames/s)\n",
+        finals.size(), children.size(), opt.branch_frames, seconds,
+        finals.size() * opt.branch_frames / seconds);
+
+    return (failed || finals.size() != children.size()) ? 1 : 0;
+}
+#endif
+
+static void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " <rom> [--frames N] [--inputs file] [--autostart]\n"
+        << "       [--fork-at FRAME --workers K --branch-frames M --report-every R --seed S]\n"
+        << "       [--trajectory file [--trajectory-ram START SIZE]] [--observation-bench ITERATIONS]\n"
+        << "       [--profile-memory PREFIX] [--coverage file]\n"
+        << "       [--trace file [--trace-size N] [--trace-range START-END] [--trace-trigger PC[:COUNT]]]\n"
+        << "       [--hash-stream file] [--audio-null | --audio-wav file] [--synth]\n";
+}
+
+/**
+   Entry point for the headless runner.
+
+   @param argc - argument count
+   @param argv - argument vector (expects the ROM file path as argv[1])
+   @return 0 on success, 1 on failure
+*/
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    HeadlessOptions opt;
+    opt.rom_path = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && has_value) opt.frames = strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--inputs") && has_value) opt.input_path = argv[++i];
+        else if (!strcmp(argv[i], "--autostart")) opt.autostart = true;
+        else if (!strcmp(argv[i], "--fork-at") && has_value) opt.fork_at = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--workers") && has_value) opt.workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--branch-frames") && has_value) opt.branch_frames = strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--report-every") && has_value) opt.report_every = strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--seed") && has_value) opt.seed = strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--observation-bench") && has_value) opt.observation_bench = strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--trajectory") && has_value) opt.trajectory_path = argv[++i];
+        else if (!strcmp(argv[i], "--profile-memory") && has_value) opt.profile_prefix = argv[++i];
+        else if (!strcmp(argv[i], "--coverage") && has_value) opt.coverage_path = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && has_value) opt.trace_path = argv[++i];
+        else if (!strcmp(argv[i], "--trace-size") && has_value) opt.trace_size = strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--trace-range") && has_value) opt.trace_range = argv[++i];
+        else if (!strcmp(argv[i], "--trace-trigger") && has_value) opt.trace_trigger = argv[++i];
+        else if (!strcmp(argv[i], "--hash-stream") && has_value) opt.hash_stream_path = argv[++i];
+        else if (!strcmp(argv[i], "--audio-null")) opt.audio = true;
+        else if (!strcmp(argv[i], "--audio-wav") && has_value) {
+            opt.audio = true;
+            opt.audio_wav_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--synth")) opt.synth = true;
+        else if (!strcmp(argv[i], "--trajectory-ram") && i + 2 < argc) {
+            opt.trajectory_ram_start = (uint16_t)strtoul(argv[++i], nullptr, 0);
+            opt.trajectory_ram_size = (uint16_t)strtoul(argv[++i], nullptr, 0);
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.report_every == 0) {
+        opt.report_every = opt.branch_frames;
+    }
+
+    std::vector<InputChange> inputs;
+    if (opt.input_path && !loadInputs(opt.input_path, inputs)) {
+        std::cerr << "Failed to open input file " << opt.input_path << std::endl;
+        return 1;
+    }
+    if (opt.autostart) {
+        addAutostart(inputs);
+    }
+
+    State8080 state;
+    initCPU(&state);
+    loadROM(opt.rom_path, &state, 0);
+    mapSpaceInvadersMemory(&state);
+    *state.ports.port1 = INPUT_ALWAYS_SET;
+
+    uint32_t frames = (opt.fork_at >= 0) ? (uint32_t)opt.fork_at : opt.frames;
+
+    MemoryProfile* profile = nullptr;
+    if (opt.profile_prefix) {
+        profile = new MemoryProfile;
+        if (!attachMemoryProfile(&state, profile)) {
+            std::cerr << "--profile-memory needs a build configured with -DPROFILE_MEMORY=ON" << std::endl;
+            return 1;
+        }
+    }
+
+    CoverageMap coverage = {};
+    if (opt.coverage_path) {
+        attachCoverage(&state, &coverage);
+    }
+
+    TraceBuffer trace;
+    if (opt.trace_path) {
+        if (!openTrace(&trace, opt.trace_path, opt.trace_size)) {
+            std::cerr << "Failed to create trace file " << opt.trace_path << std::endl;
+            return 1;
+        }
+        char* end;
+        if (opt.trace_range) {
+            uint16_t first = (uint16_t)strtoul(opt.trace_range, &end, 16);
+            setTraceRange(&trace, first, (*end == '-') ? (uint16_t)strtoul(end + 1, nullptr, 16) : first);
+        }
+        if (opt.trace_trigger) {
+            uint16_t pc = (uint16_t)strtoul(opt.trace_trigger, &end, 16);
+            setTraceTrigger(&trace, pc, (*end == ':') ? strtoull(end + 1, nullptr, 0) : 0);
+        }
+        attachTrace(&state, &trace);
+    }
+
+    FrameRecorders recorders;
+    if (opt.hash_stream_path) {
+        recorders.hash_stream = createHashStream(opt.hash_stream_path);
+        if (!recorders.hash_stream) {
+            std::cerr << "Failed to create hash stream " << opt.hash_stream_path << std::endl;
+            return 1;
+        }
+    }
+
+    if (opt.audio) {
+        SoundConfig sound_config;
+        sound_config.sink = opt.audio_wav_path ? SOUND_SINK_WAV : SOUND_SINK_NULL;
+        sound_config.wav_path = opt.audio_wav_path;
+        sound_config.synthesize = opt.synth;
+        if (!initSoundSystem(sound_config)) {
+            return 1;
+        }
+        attachSound(&state);
+        recorders.sound = true;
+    }
+
+    // Last, as it starts the compression thread
+    TrajectoryWriter trajectory;
+    if (opt.trajectory_path) {
+        if (!openTrajectory(&trajectory, opt.trajectory_path, opt.trajectory_ram_start, opt.trajectory_ram_size)) {
+            std::cerr << "Failed to create trajectory file " << opt.trajectory_path << std::endl;
+            return 1;
+        }
+        recorders.trajectory = &trajectory;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool record = recorders.trajectory || recorders.hash_stream || recorders.sound;
+    playInputs(&state, inputs, 0, frames, record ? recordFrame : nullptr, &recorders);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (recorders.hash_stream) {
+        // The state after the last frame closes the stream
+        bool written = appendStateHash(recorders.hash_stream, &state, frames);
+        if (fclose(recorders.hash_stream) != 0 || !written) {
+            std::cerr << "Failed to write hash stream " << opt.hash_stream_path << std::endl;
+            return 1;
+        }
+    }
+
+    if (opt.audio) {
+        detachSound(&state);
+        shutdownSoundSystem();
+        uint64_t samples;
+        uint32_t audio_hash = soundHash(&samples);
+        printf("audio hash %08x  (%llu samples)\n", audio_hash, (unsigned long long)samples);
+    }
+
+    if (opt.trace_path) {
+        detachTrace(&state);
+        printf("traced %llu instructions to %s\n", (unsigned long long)trace.header->written, opt.trace_path);
+        closeTrace(&trace);
+    }
+
+    if (opt.coverage_path) {
+        detachCoverage(&state);
+        if (!writeCoverage(&coverage, opt.coverage_path)) {
+            std::cerr << "Failed to write coverage file " << opt.coverage_path << std::endl;
+            return 1;
+        }
+    }
+
+    if (profile) {
+        detachMemoryProfile(&state);
+        std::string heatmap_path = std::string(opt.profile_prefix) + ".ppm";
+        std::string report_path = std::string(opt.profile_prefix) + ".txt";
+        FILE* report = fopen(report_path.c_str(), "w");
+        if (!report || !writeHeatmap(profile, heatmap_path.c_str())) {
+            std::cerr << "Failed to write memory profile " << opt.profile_prefix << std::endl;
+            return 1;
+        }
+        writeProfileReport(profile, &state, report);
+        fclose(report);
+        delete profile;
+    }
+
+    if (opt.trajectory_path && !closeTrajectory(&trajectory)) {
+        std::cerr << "Failed to write trajectory file " << opt.trajectory_path << std::endl;
+        return 1;
+    }
+
+    printf("frame %u  score %u  hash %08x  (%.0f frames/s)\n",
+        frames, readScore(&state), hashState(&state), seconds > 0 ? frames / seconds : 0.0);
+
+    if (opt.observation_bench) {
+        benchObservations(&state, opt.observation_bench);
+    }
+
+    if (opt.fork_at >= 0) {
+#if defined(_WIN32) || defined(_WIN64)
+        std::cerr << "--fork-at needs fork() and is only available on POSIX hosts." << std::endl;
+        return 1;
+#else
+        return forkBranches(&state, opt);
+#endif
+    }
+    return 0;
+}
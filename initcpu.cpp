@@ -1,5 +1,8 @@
 #include "initcpu.h"
+#include "pagetable.h"
+#include "io_ports.h"
 #include <iostream>
+#include <cstring>
 
 
 void initCPU(State8080* state) {
@@ -14,14 +17,22 @@ void initCPU(State8080* state) {
     state->pc = 0;
     state->flags = { 1, 1, 1, 1, 1, 3 };
     state->shift_registers = { 0, 0, 0 };
-    state->ports = { new uint8_t,  new uint8_t,  new uint8_t,  new uint8_t,  new uint8_t,  new uint8_t,  new uint8_t };
-
+    state->sound_latches = { 0 };
 
     if ((state->memory = (uint8_t*)malloc(MEMORY_SIZE)) == nullptr) {
         std::cerr << "Failed to allocate memory." << std::endl;
         exit(1);
     }
 
+    // Same layout as the shared memory block: ports after the guard bytes
+    state->ports = { state->memory + PORT_LOCATION,
+        state->memory + PORT_LOCATION + 1,
+        state->memory + PORT_LOCATION + 2,
+        state->memory + PORT_LOCATION + 3,
+        state->memory + PORT_LOCATION + 4,
+        state->memory + PORT_LOCATION + 5,
+        state->memory + PORT_LOCATION + 6 };
+
     *state->ports.port0 = 0;
     *state->ports.port1 = 0;
     *state->ports.port2 = 0;
@@ -29,7 +40,9 @@ void initCPU(State8080* state) {
     *state->ports.port4 = 0;
     *state->ports.port5 = 0;
     *state->ports.port6 = 0;
-    // memset(state->memory, 0, MEMORY_SIZE);
+    memset(state->memory, 0, MEMORY_SIZE);
+    mapFlatMemory(state);
+    mapSpaceInvadersPorts(state);
 }
 
 void initCPU(State8080* state, PlatformMemoryPtr memory_ptr) {
@@ -44,6 +57,7 @@ void initCPU(State8080* state, PlatformMemoryPtr memory_ptr) {
     state->pc = 0;
     state->flags = { 1, 1, 1, 1, 1, 3 };
     state->shift_registers = { 0, 0, 0 };
+    state->sound_latches = { 0 };
 
     // if null, memory_ptr not passed or invalid
     if (memory_ptr == nullptr) {
@@ -64,4 +78,6 @@ void initCPU(State8080* state, PlatformMemoryPtr memory_ptr) {
         state->memory + PORT_LOCATION + 6 };
 
     //memset(state->memory, 0, MEMORY_SIZE);
+    mapFlatMemory(state);
+    mapSpaceInvadersPorts(state);
 }
\ No newline at end of file
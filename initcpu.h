@@ -1,8 +1,23 @@
 #ifndef INIT_CPU
 #define INIT_CPU
 
-#define MEMORY_SIZE 0x10007 //0x10003 For now
-#define PORT_LOCATION 0x10000 //0x10000 
+// Buffer layout (also the memory region of the block shared with the UI, see shm_layout.h):
+//   0x00000 - 0x0FFFF  64 KB address space
+//   0x10000 - 0x1000F  guard bytes: a copy of 0x0000 - 0x000F taken when memory is mapped,
+//                      so wide loads near 0xFFFF stay in bounds
+//   0x10010 - 0x10016  port block
+#define ADDRESS_SPACE_SIZE 0x10000
+#define MEMORY_GUARD_SIZE 0x10
+#define PORT_LOCATION (ADDRESS_SPACE_SIZE + MEMORY_GUARD_SIZE)
+#define PORT_BLOCK_SIZE 8
+#define MEMORY_SIZE (PORT_LOCATION + PORT_BLOCK_SIZE)
+
+#define PAGE_SHIFT 8
+#define PAGE_SIZE 0x100
+#define PAGE_COUNT 0x100 // 256 byte pages cover the 64 KB address space
+#define DIRTY_LINE_SHIFT 5 // 32 byte lines: one rotated scanline of VRAM each
+#define DIRTY_LINE_COUNT (0x10000 >> DIRTY_LINE_SHIFT)
+#define PORT_COUNT 0x100
 
 //#define DEBUG
 
@@ -19,6 +34,21 @@
     typedef void* PlatformMemoryPtr;  // fallback for non-Windows
 #endif
 
+struct State8080;
+struct CodeTracker;
+struct MemoryProfile;
+struct Debugger;
+struct TraceBuffer;
+struct SoundEventQueue;
+
+// Page fallbacks, called when a page has no direct read or write pointer
+typedef uint8_t (*PageReadHandler)(State8080* cpu, uint16_t addr);
+typedef void (*PageWriteHandler)(State8080* cpu, uint16_t addr, uint8_t value);
+
+// I/O port devices, see io_ports.h
+typedef uint8_t (*PortReadHandler)(State8080* cpu, uint8_t port, void* context);
+typedef void (*PortWriteHandler)(State8080* cpu, uint8_t port, uint8_t value, void* context);
+
 // Registers, memory, and CoditionCodes maintain CPU state
 struct State8080 {
     uint8_t     a = 0;
@@ -53,6 +83,11 @@ struct State8080 {
         uint8_t shift_offset = 0;
     } shift_registers;
 
+    // Space Invaders sound latch 2 (port 5), see io_ports.h
+    struct {
+        uint8_t fleet_step = 0;     // which of the four fleet movement notes plays next
+    } sound_latches;
+
     struct {
         uint8_t* port0 = nullptr;
         uint8_t* port1 = nullptr;
@@ -64,12 +99,46 @@ struct State8080 {
 
     } ports;
 
+    // Device table for IN/OUT, see io_ports.h
+    struct {
+        PortReadHandler read[PORT_COUNT] = {};
+        PortWriteHandler write[PORT_COUNT] = {};
+        void* read_context[PORT_COUNT] = {};
+        void* write_context[PORT_COUNT] = {};
+        uint32_t unmapped_reads = 0;
+        uint32_t unmapped_writes = 0;
+    } io;
+
     // Interrupt enable
     uint8_t interrupt_enabled = false;
 
     // Halt capability
     uint8_t halted = false;
 
+    // Position inside runFrame, so a debugger stop can resume mid-frame
+    uint8_t frame_half = 0;         // 0 between frames, else the half frame being run
+    uint32_t half_start = 0;        // cycles at the start of that half
+
+    Debugger* debugger = nullptr;   // see debugger.h
+    TraceBuffer* trace = nullptr;   // see trace.h
+    SoundEventQueue* sound = nullptr; // see sound.h
+
+    // Page table, see pagetable.h. A null read/write pointer sends the
+    // access to that page's handler instead.
+    struct {
+        uint8_t* read[PAGE_COUNT] = {};
+        uint8_t* write[PAGE_COUNT] = {};
+        PageReadHandler read_handler[PAGE_COUNT] = {};
+        PageWriteHandler write_handler[PAGE_COUNT] = {};
+        uint32_t unmapped_reads = 0;
+        uint32_t unmapped_writes = 0;
+        uint8_t dirty_lines[DIRTY_LINE_COUNT] = {}; // nonzero once any of 32 bytes of cpu->memory is written
+        CodeTracker* code_tracker = nullptr;        // see codetracker.h
+        uint8_t* coverage = nullptr;                // executed address bitmap, see coverage.h
+#ifdef PROFILE_MEMORY
+        MemoryProfile* profile = nullptr;           // see memprofile.h
+#endif
+    } pages;
 
 };
 
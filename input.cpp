@@ -0,0 +1,131 @@
+#include "input.h"
+#include "io_ports.h"
+#include "machine.h"
+
+bool postInput(InputQueue* queue, uint8_t port, uint8_t mask, uint8_t value, uint64_t host_ns) {
+    if (!queue->events.push(InputEvent{ host_ns, port, mask, value })) {
+        queue->dropped++;
+        return false;
+    }
+    return true;
+}
+
+/**
+* Changes the latch of {event}'s port. Releases of bits no IN has
+* returned yet are held until one does.
+*/
+static void applyInput(InputQueue* queue, const InputEvent& event) {
+    if (event.port >= INPUT_PORTS) {
+        return;
+    }
+    uint8_t port = event.port;
+    uint8_t* latch = queue->latches[port];
+    uint8_t press = event.mask & event.value;
+    uint8_t release = event.mask & ~event.value;
+
+    // Pressed again before the held release: keep it pressed
+    queue->held_release[port] &= ~press;
+    uint8_t rising = press & ~*latch;
+    for (int bit = 0; bit < 8; bit++) {
+        if (rising & (1 << bit)) {
+            queue->press_ns[port][bit] = event.host_ns;
+        }
+    }
+    queue->unread[port] |= rising;
+
+    uint8_t hold = release & queue->unread[port];
+    if (hold) {
+        queue->sticky++;
+        queue->held_release[port] |= hold;
+    }
+    *latch = (*latch | press) & ~(release & ~hold);
+    queue->applied++;
+}
+
+/**
+* Applies the scheduled events up to and including {cycle}.
+*/
+static void applyDueInput(InputQueue* queue, uint32_t cycle) {
+    while (queue->next < queue->pending_count && (int32_t)(cycle - queue->pending[queue->next].cycle) >= 0) {
+        applyInput(queue, queue->pending[queue->next++].event);
+    }
+}
+
+/**
+* IN 0 - 2 with a queue attached: catches up on the input due by now,
+* returns the latch and lets go of the presses it has now shown.
+*/
+static uint8_t readInput(State8080* cpu, uint8_t port, void* context) {
+    InputQueue* queue = (InputQueue*)context;
+    applyDueInput(queue, cpu->cycles);
+    uint8_t value = *queue->latches[port];
+    uint8_t seen = queue->unread[port] & value;
+    if (seen) {
+        uint64_t now = inputHostTime();
+        for (int bit = 0; bit < 8; bit++) {
+            if (seen & (1 << bit)) {
+                uint64_t pressed = queue->press_ns[port][bit];
+                addLatency(&queue->latency, now > pressed ? now - pressed : 0);
+            }
+        }
+    }
+    queue->unread[port] = 0;
+    *queue->latches[port] &= ~queue->held_release[port];
+    queue->held_release[port] = 0;
+    return value;
+}
+
+void attachInput(State8080* cpu, InputQueue* queue) {
+    uint8_t* latches[INPUT_PORTS] = { cpu->ports.port0, cpu->ports.port1, cpu->ports.port2 };
+    for (int port = 0; port < INPUT_PORTS; port++) {
+        queue->latches[port] = latches[port];
+        mapInputPort(cpu, (uint8_t)port, readInput, queue);
+    }
+    queue->pending_count = 0;
+    queue->next = 0;
+    queue->frame_ns = 0;
+}
+
+void detachInput(State8080* cpu, InputQueue* queue) {
+    for (int port = 0; port < INPUT_PORTS; port++) {
+        mapInputLatch(cpu, (uint8_t)port, queue->latches[port]);
+    }
+    InputEvent event;
+    while (queue->events.pop(&event)) {
+    }
+    queue->pending_count = 0;
+    queue->next = 0;
+}
+
+void scheduleInput(State8080* cpu, InputQueue* queue, uint64_t now_ns) {
+    while (queue->next < queue->pending_count) {
+        applyInput(queue, queue->pending[queue->next++].event);
+    }
+    queue->pending_count = 0;
+    queue->next = 0;
+
+    // Map the host time since the last frame onto this frame's cycles
+    const uint64_t frame_cycles = 2 * CYCLES_PER_HALF_FRAME;
+    uint64_t span = (queue->frame_ns && now_ns > queue->frame_ns) ? now_ns - queue->frame_ns : 0;
+    InputEvent event;
+    while (queue->pending_count < INPUT_PENDING && queue->events.pop(&event)) {
+        uint64_t offset = 0;
+        if (span && event.host_ns > queue->frame_ns) {
+            uint64_t since = event.host_ns - queue->frame_ns;
+            offset = since < span ? since * frame_cycles / span : frame_cycles - 1;
+        }
+        queue->pending[queue->pending_count++] = ScheduledInput{ cpu->cycles + (uint32_t)offset, event };
+    }
+    queue->frame_ns = now_ns;
+}
+
+void printInputStats(const InputQueue* queue, std::ostream& out) {
+    out << "Input: " << queue->applied << " events, " << queue->dropped << " dropped, "
+        << queue->sticky << " short presses held for the game\n";
+    const LatencyHistogram* latency = &queue->latency;
+    if (latency->total) {
+        out << "  press to IN latency over " << latency->total << " presses: p50 "
+            << latencyPercentile(latency, 0.5) / 1e6 << " ms, p90 " << latencyPercentile(latency, 0.9) / 1e6
+            << " ms, p99 " << latencyPercentile(latency, 0.99) / 1e6 << " ms, max " << latency->max_ns / 1e6 << " ms\n";
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <cstdint>
+#include <chrono>
+#include <ostream>
+#include "initcpu.h"
+#include "spscqueue.h"
+#include "latency.h"
+
+#define INPUT_QUEUE_SIZE 64
+#define INPUT_PENDING 64        // events scheduled into one frame
+#define INPUT_PORTS 3           // IN 0 - 2 are the input ports of the Midway 8080 boards
+
+/*
+ * Cycle-timestamped input.
+ *
+ * Frontends post (host time, port, mask, value) records into an
+ * SpscQueue instead of writing the port latches. Before each frame the
+ * emulation thread drains the queue and spreads the events over the
+ * frame at the same relative positions they arrived in during the
+ * previous one. So every event lands on a cycle, at a fixed latency of
+ * one frame, and the gaps between presses are kept. The port devices
+ * apply the events that are due when the game executes IN. The game
+ * only ever sees input through IN, so applying them there is exact.
+ *
+ * Presses are sticky: a bit stays set until an IN has returned it at
+ * least once, so a tap shorter than the game's polling interval is
+ * never lost. The time from a press reaching the frontend to the first
+ * IN that sees it is measured per press (printInputStats).
+ *
+ * Without an attached queue the input ports stay plain latches, as
+ * scripted runs (playInputs) expect.
+ */
+
+/**
+* Host clock used to stamp input, in nanoseconds. Same clock as
+* soundHostTime, so the two latencies compare.
+*/
+inline uint64_t inputHostTime() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct InputEvent {
+    uint64_t host_ns;   // when the frontend saw it
+    uint8_t port;       // 0 - INPUT_PORTS-1
+    uint8_t mask;       // bits to change
+    uint8_t value;      // their new state
+};
+
+struct ScheduledInput {
+    uint32_t cycle;     // cpu->cycles it applies at
+    InputEvent event;
+};
+
+struct InputQueue {
+    SpscQueue<InputEvent, INPUT_QUEUE_SIZE> events;  // frontend -> emulation
+    uint32_t dropped = 0;           // frontend side: queue was full
+
+    // Emulation thread
+    uint8_t* latches[INPUT_PORTS] = {};
+    ScheduledInput pending[INPUT_PENDING];
+    uint32_t pending_count = 0;
+    uint32_t next = 0;              // first pending event not yet applied
+    uint64_t frame_ns = 0;          // host time of the last scheduleInput, 0 before the first
+
+    uint8_t unread[INPUT_PORTS] = {};           // pressed bits no IN has returned yet
+    uint8_t held_release[INPUT_PORTS] = {};     // releases waiting for that IN
+    uint64_t press_ns[INPUT_PORTS][8] = {};     // host time of each unread press
+
+    uint32_t applied = 0;
+    uint32_t sticky = 0;            // releases held back for an unread press
+    LatencyHistogram latency;       // press to first IN that returns it
+};
+
+/**
+* Frontend side: queues a change of {port}'s {mask} bits to {value}.
+*
+* @return false, counted in queue->dropped, if the queue is full.
+*/
+bool postInput(InputQueue* queue, uint8_t port, uint8_t mask, uint8_t value, uint64_t host_ns = inputHostTime());
+
+/**
+* Routes IN 0 - 2 through {queue}, latching into cpu->ports as before.
+*/
+void attachInput(State8080* cpu, InputQueue* queue);
+
+/**
+* Restores the plain latches. Events still queued are dropped.
+*/
+void detachInput(State8080* cpu, InputQueue* queue);
+
+/**
+* Emulation side: call before each runFrame. Applies what is left of the
+* last frame, then schedules the events queued since onto this frame.
+* Events beyond INPUT_PENDING stay queued for the next frame.
+*
+* @param now_ns Host time of the frame, inputHostTime().
+*/
+void scheduleInput(State8080* cpu, InputQueue* queue, uint64_t now_ns);
+
+/**
+* Prints the event counts and the press to IN latency percentiles.
+*/
+void printInputStats(const InputQueue* queue, std::ostream& out);
+
+#endif
@@ -1,84 +1,126 @@
 #include "io_ports.h"
 #include "sound.h"
-#include "miniaudio.h"
-#include "emulator.h"
-#include <bitset>
-
-uint8_t input_port(State8080* cpu, uint8_t port) {
-
-    uint8_t val = 0;
-    switch (port) {
-    case 0x00: val = *cpu->ports.port0; break;
-    case 0x01: val = *cpu->ports.port1; break; // Player 1 input
-    case 0x02: val = *cpu->ports.port2; break; // Player 2 input
-    case 0x03: {
-        uint16_t v = (cpu->shift_registers.shift1 << 8) | cpu->shift_registers.shift0;
-        val = ((v >> (8 - cpu->shift_registers.shift_offset)) & 0xff); // Shift register result
-        break;
+
+static uint8_t readUnmapped(State8080* cpu, uint8_t port, void* context) {
+    cpu->io.unmapped_reads++;
+    return 0;
+}
+
+static void writeUnmapped(State8080* cpu, uint8_t port, uint8_t value, void* context) {
+    cpu->io.unmapped_writes++;
+}
+
+static uint8_t readLatch(State8080* cpu, uint8_t port, void* context) {
+    return *(uint8_t*)context;
+}
+
+static void writeLatch(State8080* cpu, uint8_t port, uint8_t value, void* context) {
+    *(uint8_t*)context = value;
+}
+
+static uint8_t readShiftResult(State8080* cpu, uint8_t port, void* context) {
+    uint16_t v = (cpu->shift_registers.shift1 << 8) | cpu->shift_registers.shift0;
+    return (v >> (8 - cpu->shift_registers.shift_offset)) & 0xff;
+}
+
+static void writeShiftOffset(State8080* cpu, uint8_t port, uint8_t value, void* context) {
+    cpu->shift_registers.shift_offset = value & 0x7;
+}
+
+static void writeShiftData(State8080* cpu, uint8_t port, uint8_t value, void* context) {
+    cpu->shift_registers.shift0 = cpu->shift_registers.shift1;
+    cpu->shift_registers.shift1 = value;
+}
+
+/**
+* Space Invaders sound latch 1 (port 3). Rising edges start effects; the
+* UFO loops while its bit is set. {context} is the latch byte, which also
+* holds the previous value for edge detection.
+*/
+static void writeSoundLatch1(State8080* cpu, uint8_t port, uint8_t a, void* context) {
+    uint8_t* latch = (uint8_t*)context;
+    uint8_t last = *latch;
+    if ((a & 0x01) && !(last & 0x01)) {
+        postSoundEvent(cpu, SOUND_UFO_HIGH, true);
+    } else if (!(a & 0x01) && (last & 0x01)) {
+        postSoundEvent(cpu, SOUND_UFO_HIGH, false);
     }
-    default: {
-        printf("Error: Invalid input port %02x\n", port);
-        break;
+    if ((a & 0x02) && !(last & 0x02)) {
+        postSoundEvent(cpu, SOUND_SHOOT, true);
     }
+    if ((a & 0x04) && !(last & 0x04)) {
+        postSoundEvent(cpu, SOUND_EXPLOSION, true);
     }
-    return val;
-}
-
-void output_port(State8080* cpu, uint8_t port, uint8_t a) {
-    switch (port) {
-    case 0x02:
-        cpu->shift_registers.shift_offset = a & 0x7;
-        break;
-    case 0x03: {
-        static uint8_t last_port3 = 0;
-        if ((a & 0x01) && !(last_port3 & 0x01)) {
-            playSound(SOUND_UFO_HIGH);
-        } else if (!(a & 0x01) && (last_port3 & 0x01)) {
-            stopSound(SOUND_UFO_HIGH);
-        }
-        if ((a & 0x02) && !(last_port3 & 0x02)) {
-            playSound(SOUND_SHOOT);
-        }
-        if ((a & 0x04) && !(last_port3 & 0x04)) {
-            playSound(SOUND_EXPLOSION);
-        }
-        if ((a & 0x08) && !(last_port3 & 0x08)) {
-            playSound(SOUND_INVADER_KILLED);
-        }
-        last_port3 = a;
-        *cpu->ports.port3 = a;
-        break;
+    if ((a & 0x08) && !(last & 0x08)) {
+        postSoundEvent(cpu, SOUND_INVADER_KILLED, true);
     }
-    case 0x04:
-        cpu->shift_registers.shift0 = cpu->shift_registers.shift1;
-        cpu->shift_registers.shift1 = a;
-        break;
-    case 0x05: {
-        static uint8_t last_port5 = 0;
-        static int current_step = 0;
-        uint8_t changed = a ^ last_port5;
-        for (int bit = 0; bit <= 3; ++bit) {
-            if ((changed & (1 << bit)) && (a & (1 << bit))) {
-                playSound(static_cast<SoundEffect>(SOUND_FAST_INVADER_1 + current_step));
-                current_step = (current_step + 1) % 4;
-                break;
-            }
-        }
-        if ((a & 0x10) && !(last_port5 & 0x10)) {
-            playSound(SOUND_UFO_LOW);
-        }
-        if ((a & 0x20) && !(last_port5 & 0x20)) {
-            playSound(SOUND_EXTENDED_PLAY);
+    *latch = a;
+}
+
+/**
+* Space Invaders sound latch 2 (port 5): fleet movement steps, UFO hit
+* and extra life. Each step plays the next of four notes, counted in
+* cpu->sound_latches.
+*/
+static void writeSoundLatch2(State8080* cpu, uint8_t port, uint8_t a, void* context) {
+    uint8_t& step = cpu->sound_latches.fleet_step;
+    uint8_t* latch = (uint8_t*)context;
+    uint8_t last = *latch;
+    uint8_t changed = a ^ last;
+    for (int bit = 0; bit <= 3; ++bit) {
+        if ((changed & (1 << bit)) && (a & (1 << bit))) {
+            postSoundEvent(cpu, static_cast<SoundEffect>(SOUND_FAST_INVADER_1 + step), true);
+            step = (step + 1) % 4;
+            break;
         }
-        last_port5 = a;
-        *cpu->ports.port5 = a;
-        break;
     }
-    case 0x06:
-        *cpu->ports.port6 = a;
-        break;
-    default:
-        printf("Error: Invalid output port %02x\n", port);
-        break;
+    if ((a & 0x10) && !(last & 0x10)) {
+        postSoundEvent(cpu, SOUND_UFO_LOW, true);
     }
+    if ((a & 0x20) && !(last & 0x20)) {
+        postSoundEvent(cpu, SOUND_EXTENDED_PLAY, true);
+    }
+    *latch = a;
+}
+
+void mapInputPort(State8080* cpu, uint8_t port, PortReadHandler handler, void* context) {
+    cpu->io.read[port] = handler;
+    cpu->io.read_context[port] = context;
+}
+
+void mapOutputPort(State8080* cpu, uint8_t port, PortWriteHandler handler, void* context) {
+    cpu->io.write[port] = handler;
+    cpu->io.write_context[port] = context;
+}
+
+void unmapPorts(State8080* cpu) {
+    for (int port = 0; port < PORT_COUNT; port++) {
+        mapInputPort(cpu, (uint8_t)port, readUnmapped, nullptr);
+        mapOutputPort(cpu, (uint8_t)port, writeUnmapped, nullptr);
+    }
+}
+
+void mapInputLatch(State8080* cpu, uint8_t port, uint8_t* latch) {
+    mapInputPort(cpu, port, readLatch, latch);
+}
+
+void mapOutputLatch(State8080* cpu, uint8_t port, uint8_t* latch) {
+    mapOutputPort(cpu, port, writeLatch, latch);
+}
+
+void mapShiftRegister(State8080* cpu, uint8_t offset_port, uint8_t data_port, uint8_t result_port) {
+    mapOutputPort(cpu, offset_port, writeShiftOffset, nullptr);
+    mapOutputPort(cpu, data_port, writeShiftData, nullptr);
+    mapInputPort(cpu, result_port, readShiftResult, nullptr);
+}
+
+void mapSpaceInvadersPorts(State8080* cpu) {
+    unmapPorts(cpu);
+    mapInputLatch(cpu, 0x00, cpu->ports.port0);
+    mapInputLatch(cpu, 0x01, cpu->ports.port1); // Player 1 input
+    mapInputLatch(cpu, 0x02, cpu->ports.port2); // Player 2 input, DIP switches
+    mapShiftRegister(cpu, 0x02, 0x04, 0x03);
+    mapOutputPort(cpu, 0x03, writeSoundLatch1, cpu->ports.port3);
+    mapOutputPort(cpu, 0x05, writeSoundLatch2, cpu->ports.port5);
+    mapOutputLatch(cpu, 0x06, cpu->ports.port6); // Watchdog
 }
@@ -6,26 +6,85 @@
 
 // Block comments written partly by Burkely and updated by Zach after implementing code. Currently unable to test without keyboard mapping. 
 
-/**
-* Gets input from keyboard and returns value to instruction set 'IN'.
+/*
+ * I/O port device table.
+ *
+ * IN and OUT dispatch through cpu->io: one read and one write handler
+ * per port number, each with a context pointer for the device behind it.
+ * A board is configured by registering its devices (input latches,
+ * shift register, sound latches, watchdog) on the ports it wires them
+ * to, so IN/OUT themselves have no per-port branches. Ports nothing is
+ * registered on read 0 and are counted in cpu->io.unmapped_reads /
+ * unmapped_writes rather than printed.
+ *
+ * initCPU installs the Space Invaders board (mapSpaceInvadersPorts).
+ * Other Midway 8080 boards call unmapPorts and register their own map.
+ */
 
+/**
+* Gets input from the device on {port} and returns value to instruction set 'IN'.
 *
+* @param cpu maintains cpu state.
 * @param port location of input to be returned.
-* @return val sent to port after funciton. Could change to initalize port
-* within function using cpu->a.
+* @return value read from {port}.
 */
-uint8_t input_port(State8080* cpu, uint8_t port);
+inline uint8_t input_port(State8080* cpu, uint8_t port) {
+    return cpu->io.read[port](cpu, port, cpu->io.read_context[port]);
+}
 
 /**
-* Gets input from keyboard and returns value to instruction set 'IN'.
-
+* Sends register A to the device on {port}, for instruction set 'OUT'.
 *
-* @param cpu maintains cpu state. Can replace other arguments, but
-* keeping port and a for testing with other opcode implementations.
+* @param cpu maintains cpu state.
 * @param port Location for output to be sent.
 * @param a Value from register A, to be sent to {port}.
-* @return Value at {port} to be sent back to register A.
 */
-void output_port(State8080* cpu, uint8_t port, uint8_t a);
+inline void output_port(State8080* cpu, uint8_t port, uint8_t a) {
+    cpu->io.write[port](cpu, port, a, cpu->io.write_context[port]);
+}
+
+/**
+* Registers {handler} for IN from {port}; {context} is passed to every call.
+*/
+void mapInputPort(State8080* cpu, uint8_t port, PortReadHandler handler, void* context);
+
+/**
+* Registers {handler} for OUT to {port}; {context} is passed to every call.
+*/
+void mapOutputPort(State8080* cpu, uint8_t port, PortWriteHandler handler, void* context);
+
+/**
+* Points every port at the counting unmapped handlers.
+*/
+void unmapPorts(State8080* cpu);
+
+/**
+* IN from {port} returns the byte at {latch}, e.g. a DIP switch or
+* joystick latch the UI writes.
+*/
+void mapInputLatch(State8080* cpu, uint8_t port, uint8_t* latch);
+
+/**
+* OUT to {port} stores into {latch}, e.g. the watchdog.
+*/
+void mapOutputLatch(State8080* cpu, uint8_t port, uint8_t* latch);
+
+/**
+* Registers the MB14241 barrel shifter used by the Midway 8080 boards,
+* keeping its state in cpu->shift_registers.
+*
+* @param offset_port OUT: shift amount (low 3 bits).
+* @param data_port OUT: shifts a new byte in from the top.
+* @param result_port IN: the 8 bits at the current offset.
+*/
+void mapShiftRegister(State8080* cpu, uint8_t offset_port, uint8_t data_port, uint8_t result_port);
+
+/**
+* Space Invaders: inputs on 0 - 2, shifter on 2 / 4 / 3, sound latches
+* on 3 and 5 and the watchdog on 6, all latched in cpu->ports. The sound
+* latches post their edges to cpu->sound, see sound.h, and keep the
+* fleet note sequence in cpu->sound_latches.
+*/
+void mapSpaceInvadersPorts(State8080* cpu);
 
 #endif
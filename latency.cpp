@@ -0,0 +1,23 @@
+#include "latency.h"
+
+void addLatency(LatencyHistogram* histogram, uint64_t ns) {
+    uint64_t bucket = ns / LATENCY_BUCKET_NS;
+    histogram->counts[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+    histogram->total++;
+    histogram->max_ns = ns > histogram->max_ns ? ns : histogram->max_ns;
+}
+
+uint64_t latencyPercentile(const LatencyHistogram* histogram, double fraction) {
+    if (histogram->total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(fraction * (histogram->total - 1));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen > rank) {
+            return (uint64_t)(i + 1) * LATENCY_BUCKET_NS;
+        }
+    }
+    return histogram->max_ns;
+}
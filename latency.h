@@ -0,0 +1,27 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <cstdint>
+
+#define LATENCY_BUCKET_NS 100000    // 0.1 ms
+#define LATENCY_BUCKETS 2000        // up to 200 ms; slower samples land in the last bucket
+
+/*
+ * Fixed-size latency histogram, cheap enough to fill from the audio
+ * callback or per IN instruction, reported as percentiles.
+ */
+struct LatencyHistogram {
+    uint32_t counts[LATENCY_BUCKETS] = {};
+    uint32_t total = 0;
+    uint64_t max_ns = 0;
+};
+
+void addLatency(LatencyHistogram* histogram, uint64_t ns);
+
+/**
+* @param fraction e.g. 0.99 for the 99th percentile.
+* @return Upper edge of the bucket holding it, in ns; 0 if empty.
+*/
+uint64_t latencyPercentile(const LatencyHistogram* histogram, double fraction);
+
+#endif
@@ -0,0 +1,103 @@
+#include "machine.h"
+#include "emulator.h"
+#include "pagetable.h"
+#include "debugger.h"
+#include "trace.h"
+#include <algorithm>
+
+void generateInterrupt(State8080* state, int num) {
+    if (!state->interrupt_enabled) {
+        return;
+    }
+    state->interrupt_enabled = false;
+    state->halted = false;
+    writeByte(state, state->sp - 1, (state->pc >> 8) & 0xff);
+    writeByte(state, state->sp - 2, state->pc & 0xff);
+    state->sp -= 2;
+    state->pc = 8 * num;
+    state->cycles += 11;
+}
+
+bool runFrame(State8080* state) {
+    if (state->frame_half == 0) {
+        state->frame_half = 1;
+        state->half_start = state->cycles;
+    }
+    while (state->frame_half <= 2) {
+        uint32_t start = state->half_start;
+        if (state->debugger || state->trace) {
+            while ((uint32_t)(state->cycles - start) < CYCLES_PER_HALF_FRAME) {
+                if (state->debugger && debugBreak(state)) {
+                    return false;
+                }
+                if (state->trace) {
+                    traceInstruction(state);
+                }
+                Emulate8080Op(state);
+            }
+        }
+        else {
+            while ((uint32_t)(state->cycles - start) < CYCLES_PER_HALF_FRAME) {
+                Emulate8080Op(state);
+            }
+        }
+        generateInterrupt(state, state->frame_half);
+        state->frame_half++;
+        state->half_start = state->cycles;
+    }
+    state->frame_half = 0;
+    return true;
+}
+
+uint32_t readScore(const State8080* state) {
+    uint8_t lo = state->memory[SCORE_P1_ADDRESS];
+    uint8_t hi = state->memory[SCORE_P1_ADDRESS + 1];
+    return (hi >> 4) * 1000 + (hi & 0x0f) * 100 + (lo >> 4) * 10 + (lo & 0x0f);
+}
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t hashState(const State8080* state) {
+    uint8_t regs[] = {
+        state->a, state->b, state->c, state->d, state->e, state->h, state->l,
+        (uint8_t)(state->sp >> 8), (uint8_t)state->sp,
+        (uint8_t)(state->pc >> 8), (uint8_t)state->pc,
+        state->flags.z, state->flags.s, state->flags.p, state->flags.c, state->flags.ac,
+        state->interrupt_enabled,
+        state->shift_registers.shift0, state->shift_registers.shift1, state->shift_registers.shift_offset
+    };
+    uint32_t hash = fnv1a(2166136261u, regs, sizeof(regs));
+    return fnv1a(hash, state->memory, 0x4000);
+}
+
+void addAutostart(std::vector<InputChange>& inputs) {
+    const InputChange script[] = {
+        { 60, INPUT_COIN }, { 70, 0 }, { 120, INPUT_P1_START }, { 130, 0 }
+    };
+    inputs.insert(inputs.begin(), std::begin(script), std::end(script));
+    std::stable_sort(inputs.begin(), inputs.end(),
+        [](const InputChange& x, const InputChange& y) { return x.frame < y.frame; });
+}
+
+void playInputs(State8080* state, const std::vector<InputChange>& inputs, uint32_t from, uint32_t to,
+    FrameCallback on_frame, void* context) {
+    size_t next = 0;
+    while (next < inputs.size() && inputs[next].frame < from) {
+        *state->ports.port1 = inputs[next++].port1 | INPUT_ALWAYS_SET;
+    }
+    for (uint32_t frame = from; frame < to; ++frame) {
+        while (next < inputs.size() && inputs[next].frame == frame) {
+            *state->ports.port1 = inputs[next++].port1 | INPUT_ALWAYS_SET;
+        }
+        if (on_frame) {
+            on_frame(state, frame, context);
+        }
+        runFrame(state);
+    }
+}
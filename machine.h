@@ -0,0 +1,94 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include "initcpu.h"
+#include <cstdint>
+#include <vector>
+
+#define CPU_CLOCK_HZ 1996800
+#define CYCLES_PER_HALF_FRAME 16666 // Mid-screen and vblank interrupts each fire once per half frame
+#define SCORE_P1_ADDRESS 0x20F8 // Two BCD bytes, least significant first
+#define SHIPS_P1_ADDRESS 0x21FF
+#define AUTOSTART_FRAMES 200 // Player one is in control after this many frames of addAutostart()
+
+// Port 1 bits
+#define INPUT_COIN 0x01
+#define INPUT_P1_START 0x04
+#define INPUT_ALWAYS_SET 0x08
+#define INPUT_P1_FIRE 0x10
+#define INPUT_P1_LEFT 0x20
+#define INPUT_P1_RIGHT 0x40
+
+/**
+* Scripted input: port 1 holds {port1} from {frame} onwards.
+*/
+struct InputChange {
+    uint32_t frame;
+    uint8_t port1;
+};
+
+/**
+* Pushes the program counter and jumps to the RST vector for {num},
+* if interrupts are enabled. Mirrors the RST instruction.
+*
+* @param state Pointer to a State8080 struct.
+* @param num Restart number (1 = mid-screen, 2 = vblank on Space Invaders).
+*/
+void generateInterrupt(State8080* state, int num);
+
+/**
+* Emulates one 60 Hz video frame: two half frames of CPU time, each
+* followed by the interrupt the Space Invaders board raises at that
+* point of the beam (RST 1 mid-screen, RST 2 at vblank).
+*
+* Stops early, in front of the instruction, when an attached debugger
+* breaks; the next call resumes the same frame from there.
+*
+* @param state Pointer to a State8080 struct with the ROM loaded.
+* @return false if a debugger stopped the frame before it finished.
+*/
+bool runFrame(State8080* state);
+
+/**
+* Decodes the player one BCD score bytes from RAM.
+*
+* @param state Pointer to a State8080 struct.
+* @return Score as a plain integer (0 - 9999).
+*/
+uint32_t readScore(const State8080* state);
+
+/**
+* FNV-1a hash of the registers, flags and 0x0000 - 0x3FFF. Two runs
+* that hash equal are in the same machine state.
+*
+* @param state Pointer to a State8080 struct.
+* @return 32 bit state hash.
+*/
+uint32_t hashState(const State8080* state);
+
+/**
+* Adds the coin and player one start presses that take the game from
+* attract mode into play by frame AUTOSTART_FRAMES.
+*
+* @param inputs Script to extend; stays sorted by frame.
+*/
+void addAutostart(std::vector<InputChange>& inputs);
+
+/**
+* Called by playInputs before each frame, once port 1 holds that frame's input.
+*/
+typedef void (*FrameCallback)(State8080* state, uint32_t frame, void* context);
+
+/**
+* Runs frames [from, to) applying the port 1 changes in {inputs}.
+* Changes scheduled before {from} are applied first.
+*
+* @param state Pointer to a State8080 struct.
+* @param inputs Script sorted by frame.
+* @param on_frame Optional per-frame hook, e.g. for recorders.
+* @param context Passed through to {on_frame}.
+*/
+void playInputs(State8080* state, const std::vector<InputChange>& inputs, uint32_t from, uint32_t to,
+    FrameCallback on_frame = nullptr, void* context = nullptr);
+
+#endif
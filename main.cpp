@@ -1,12 +1,20 @@
 #include <iostream>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 
 #include "loadrom.h"
 #include "emulator.h"
+#include "machine.h"
+#include "pagetable.h"
+#include "debugger.h"
+#include "gdbstub.h"
+#include "trace.h"
+#include "disassembler.h"
 #include "access_mmap.h"
 #include "sound.h"
+#include "input.h"
 
 #if defined(_WIN32) || defined(_WIN64)
     #include <SDL.h>
@@ -19,7 +27,7 @@
 #define VIDEO_MEMORY_END 0x3FFF
 #define SCREEN_WIDTH 224
 #define SCREEN_HEIGHT 256
-#define CYCLES_PER_INTERRUPT 16667
+#define FRAME_MS (1000.0 * CYCLES_PER_HALF_FRAME * 2 / CPU_CLOCK_HZ) // 16.69 ms
 
 // For Debugging purposes only, UI will auto-combine rom files into one file
 const char* rom_h_path = "../../rom/space-invaders/invaders.h";
@@ -29,28 +37,31 @@ const char* rom_e_path = "../../rom/space-invaders/invaders.e";
 
 
 /**
-   Render video memory to SDL window
+   Render video memory to SDL window. Only the scanlines (VRAM columns)
+   written since the last call are re-decoded into the frame texture.
 
    @param state - 8080 CPU state
    @param renderer - SDL renderer
+   @param texture - SCREEN_WIDTH x SCREEN_HEIGHT ARGB8888 streaming texture
 */
-void DrawScreen(State8080* state, SDL_Renderer* renderer) {
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-
-    for (int addr = VIDEO_MEMORY_START; addr <= VIDEO_MEMORY_END; addr++) {
-        uint8_t byte = state->memory[addr];
-        int offset = addr - VIDEO_MEMORY_START;
-        int col = offset / 32;
-        int row = (offset % 32) * 8;
-
-        for (int bit = 0; bit < 8; bit++) {
-            if ((byte >> bit) & 1) {
-                SDL_RenderDrawPoint(renderer, col, SCREEN_HEIGHT - 1 - (row + bit));
+void DrawScreen(State8080* state, SDL_Renderer* renderer, SDL_Texture* texture) {
+    static uint32_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+    uint8_t dirty[VRAM_DIRTY_BYTES];
+    if (consumeDirtyScanlines(state, dirty) > 0) {
+        for (int col = 0; col < SCREEN_WIDTH; col++) {
+            if (!((dirty[col >> 3] >> (col & 7)) & 1)) {
+                continue;
+            }
+            const uint8_t* line = state->memory + VIDEO_MEMORY_START + col * 32;
+            for (int row = 0; row < SCREEN_HEIGHT; row++) {
+                bool lit = (line[row >> 3] >> (row & 7)) & 1;
+                pixels[(SCREEN_HEIGHT - 1 - row) * SCREEN_WIDTH + col] = lit ? 0xFFFFFFFF : 0xFF000000;
             }
         }
+        SDL_UpdateTexture(texture, nullptr, pixels, SCREEN_WIDTH * sizeof(uint32_t));
     }
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
     SDL_RenderPresent(renderer);
 }
 
@@ -66,23 +77,77 @@ int main(int argc, char** argv) {
         std::cerr << "Usage: " << argv[0] << " <filename>\n";
         return 1;
     }
-    if (!initSoundSystem()) {
-        std::cerr << "Sound system failed to initialize.\n";
-    }
+    auto startup = std::chrono::steady_clock::now();
 
     State8080 state;
-    if (init_mmap(&state)) {
+    SharedBlock shared; // The UI's block, see shm_layout.h
+    if (init_mmap(&state, &shared)) {
         initCPU(&state);
     }
 
     loadROM(argv[1], &state, 0); // Load ROM into beginning of memory
+    mapSpaceInvadersMemory(&state);
 
     SDL_Init(SDL_INIT_VIDEO);
 
     bool debug_mode = false;
+    SoundConfig sound_config;
 
-    if (argv[2] == "--debug") {
-        debug_mode = true;
+    // --break ADDR[:REG<op>VALUE] and --watch START[-END][:r|w|rw], see debugger.h
+    // --gdb PORT or --gdb unix:PATH, see gdbstub.h
+    // --trace FILE keeps the last instructions in a binary ring, see trace.h
+    // --synth models the sound board instead of playing the sampled effects, see synth.h
+    // --audio-period FRAMES and --audio-periods N size the device buffers, see sound.h
+    Debugger debugger;
+    GdbStub gdb;
+    TraceBuffer trace;
+    attachDebugger(&state, &debugger);
+    for (int i = 2; i < argc; ++i) {
+        if (!strcmp(argv[i], "--debug")) {
+            debug_mode = true;
+        }
+        else if (!strcmp(argv[i], "--break") && i + 1 < argc) {
+            if (!addBreakpointSpec(&state, argv[++i])) {
+                std::cerr << "Bad breakpoint " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--watch") && i + 1 < argc) {
+            if (!addWatchpointSpec(&state, argv[++i])) {
+                std::cerr << "Bad watchpoint " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            if (!openTrace(&trace, argv[++i])) {
+                std::cerr << "Failed to create trace file " << argv[i] << "\n";
+                return 1;
+            }
+            attachTrace(&state, &trace);
+        }
+        else if (!strcmp(argv[i], "--gdb") && i + 1 < argc) {
+            if (!startGdbStub(&gdb, argv[++i])) {
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--synth")) {
+            sound_config.synthesize = true;
+        }
+        else if (!strcmp(argv[i], "--audio-period") && i + 1 < argc) {
+            sound_config.period_frames = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        }
+        else if (!strcmp(argv[i], "--audio-periods") && i + 1 < argc) {
+            sound_config.periods = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        }
+    }
+    if (!initSoundSystem(sound_config)) {
+        std::cerr << "Sound system failed to initialize.\n";
+    }
+    attachSound(&state);
+    InputQueue input;
+    attachInput(&state, &input);
+    if (debugger.breakpoints.empty() && debugger.watchpoints.empty()) {
+        detachDebugger(&state); // Nothing armed: run without the per-instruction check
     }
 
 #ifdef DEBUG
@@ -90,22 +155,23 @@ int main(int argc, char** argv) {
         SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
         SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
     SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, 0);
+    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
 #endif // DEBUG
 
 
     bool running = true;
     SDL_Event event;
-    int interrupt_num = 1;
-    int interrupts_per_frame = 0;
 
     bool paused = false;
     
     bool log_cycles = true;
     bool single_step = false;
-    bool insert_coin = false;
 
     uint32_t interrupt_timer = SDL_GetTicks();
     uint32_t frame_timer = SDL_GetTicks();
+    double frame_deadline = SDL_GetTicks();
+    bool first_frame = true;
 
     while (running) {
         uint32_t frame_start = SDL_GetTicks();
@@ -119,39 +185,46 @@ int main(int argc, char** argv) {
                     case SDLK_d: debug_mode = !debug_mode; std::cout << (debug_mode ? "Debug mode ON\n" : "Debug mode OFF\n"); break;
                     case SDLK_l: log_cycles = !log_cycles; std::cout << (log_cycles ? "Logging ON\n" : "Logging OFF\n"); break;
                     case SDLK_n: if (paused) { single_step = true; std::cout << "Single step requested\n"; } break;
-                    case SDLK_c: *state.ports.port1 |= 0x01;; break;
-                    case SDLK_1: *state.ports.port1 |= 0x04; break;
-                    case SDLK_SPACE: *state.ports.port1 |= 0x10; break;
-                    case SDLK_LEFT: *state.ports.port1 |= 0x20; break;
-                    case SDLK_RIGHT: *state.ports.port1 |= 0x40; break;
+                    case SDLK_b:
+                        if (!state.debugger) attachDebugger(&state, &debugger);
+                        requestDebugStop(&state);
+                        break;
+                    case SDLK_c: postInput(&input, 1, INPUT_COIN, INPUT_COIN); break;
+                    case SDLK_1: postInput(&input, 1, INPUT_P1_START, INPUT_P1_START); break;
+                    case SDLK_SPACE: postInput(&input, 1, INPUT_P1_FIRE, INPUT_P1_FIRE); break;
+                    case SDLK_LEFT: postInput(&input, 1, INPUT_P1_LEFT, INPUT_P1_LEFT); break;
+                    case SDLK_RIGHT: postInput(&input, 1, INPUT_P1_RIGHT, INPUT_P1_RIGHT); break;
                     default: break;
                 }
             } else if (event.type == SDL_KEYUP) {
+                // Queued with their time, so taps between frames still register, see input.h
                 switch (event.key.keysym.sym) {
-                    case SDLK_c: *state.ports.port1 &= 0x01; break;
-                    case SDLK_1: *state.ports.port1 &= ~0x04; break;
-                    case SDLK_SPACE: *state.ports.port1 &= ~0x10; break;
-                    case SDLK_LEFT: *state.ports.port1 &= ~0x20; break;
-                    case SDLK_RIGHT: *state.ports.port1 &= ~0x40; break;
+                    case SDLK_c: postInput(&input, 1, INPUT_COIN, 0); break;
+                    case SDLK_1: postInput(&input, 1, INPUT_P1_START, 0); break;
+                    case SDLK_SPACE: postInput(&input, 1, INPUT_P1_FIRE, 0); break;
+                    case SDLK_LEFT: postInput(&input, 1, INPUT_P1_LEFT, 0); break;
+                    case SDLK_RIGHT: postInput(&input, 1, INPUT_P1_RIGHT, 0); break;
                     default: break;
                 }
             }
         }
 
-        // Redid the coin validating system to work with remote launching
-        if (*state.ports.port1 & 0x01 && insert_coin == false)
-            insert_coin = true;
-        else {
-            insert_coin = false;
-            *state.ports.port1 &= ~0x01;
+        if (serviceGdbStub(&state, &gdb) == GDB_HALTED) {
+            SDL_Delay(1);
+            continue;
         }
-
         if (paused && !single_step) {
             SDL_Delay(1);
             continue;
         }
         if (paused && single_step) {
             single_step = false;
+            if (state.debugger) {
+                // Stopped in the debugger: step one instruction instead of a frame
+                stepInstruction(&state);
+                Disassemble8080Op(state.memory, state.pc);
+                continue;
+            }
         }
         if (debug_mode) {
             std::cout << std::hex;
@@ -167,40 +240,57 @@ int main(int argc, char** argv) {
                 << std::dec << "\n";
         }
 
-        for (int interrupt = 0; interrupt < 2; ++interrupt) {
-            uint64_t cycles_this_interrupt = state.cycles;
-            while ((state.cycles - cycles_this_interrupt) < 16666) {
-                Emulate8080Op(&state);
-            }
-
-            if (state.interrupt_enabled) {
-                state.interrupt_enabled = false;
-                state.memory[state.sp - 1] = (state.pc >> 8) & 0xff;
-                state.memory[state.sp - 2] = state.pc & 0xff;
-                state.sp -= 2;
-                state.pc = (interrupt_num == 1) ? 0x0008 : 0x0010;
-                state.cycles += 11;
-                interrupt_num ^= 1;
-            }
+        forwardSharedInput(&shared, &input);
+        scheduleInput(&state, &input, inputHostTime());
+        if (!runFrame(&state) && !reportGdbStop(&state, &gdb)) {
+            paused = true;
+            printDebugStop(&state, stdout);
+            Disassemble8080Op(state.memory, state.pc);
         }
+        publishSoundClock(&state);
+        publishSharedFrame(&shared, &state);
 #ifdef DEBUG
-        DrawScreen(&state, renderer);
+        DrawScreen(&state, renderer, texture);
 #endif // DEBUG
+        if (first_frame) {
+            // The effects decode in the background, so they may still be warming up
+            first_frame = false;
+            std::cout << "Startup: first frame after "
+                << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup).count()
+                << " ms, sound effects " << (soundEffectsReady() ? "ready" : "still decoding") << "\n";
+        }
 
 
+        // Pace to the emulated frame rate (59.9 Hz) rather than whole
+        // milliseconds, so the sound's rate control only has to absorb
+        // crystal drift
+        frame_deadline += FRAME_MS;
         uint32_t frame_end = SDL_GetTicks();
-        uint32_t elapsed = frame_end - frame_start;
-        if (elapsed < 16) SDL_Delay(16 - elapsed);
+        if (frame_deadline > frame_end) {
+            SDL_Delay((uint32_t)(frame_deadline - frame_end));
+        }
+        else if (frame_end - frame_deadline > 100) {
+            frame_deadline = frame_end; // Fell behind: don't try to catch up
+        }
 
         if (log_cycles && debug_mode) {
             std::cout << "Time for one full frame: " << (SDL_GetTicks() - frame_start) << " ms\n";
         }
     }
 #ifdef DEBUG
+    SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
 #endif // DEBUG
     SDL_Quit();
+    detachGdbClient(&state, &gdb);
+    stopGdbStub(&gdb);
+    detachTrace(&state);
+    closeTrace(&trace);
+    detachInput(&state, &input);
+    detachSound(&state);
     shutdownSoundSystem();
+    printSoundStats(std::cout);
+    printInputStats(&input, std::cout);
     return 0;
 }
\ No newline at end of file
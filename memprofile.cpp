@@ -0,0 +1,131 @@
+#include "memprofile.h"
+#include "pagetable.h"
+#include "disassembler.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#define PROFILE_LINES (0x10000 >> PROFILE_LINE_SHIFT)
+
+struct ProfileRegion {
+    const char* name;
+    uint32_t start;
+    uint32_t end; // exclusive
+};
+
+static const ProfileRegion REGIONS[] = {
+    { "ROM", 0x0000, 0x2000 },
+    { "work RAM", 0x2000, 0x2400 },
+    { "VRAM", 0x2400, 0x4000 },
+    { "mirrors", 0x4000, 0x10000 },
+};
+
+bool attachMemoryProfile(State8080* cpu, MemoryProfile* profile) {
+#ifdef PROFILE_MEMORY
+    memset(profile, 0, sizeof(MemoryProfile));
+    cpu->pages.profile = profile;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void detachMemoryProfile(State8080* cpu) {
+#ifdef PROFILE_MEMORY
+    cpu->pages.profile = nullptr;
+#endif
+}
+
+static uint8_t logScale(uint32_t count, double log_max) {
+    if (count == 0 || log_max <= 0) {
+        return 0;
+    }
+    return (uint8_t)(255.0 * std::log1p((double)count) / log_max + 0.5);
+}
+
+bool writeHeatmap(const MemoryProfile* profile, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    uint32_t max_read = 0, max_write = 0, max_exec = 0;
+    for (int addr = 0; addr < 0x10000; addr++) {
+        max_read = std::max(max_read, profile->reads[addr]);
+        max_write = std::max(max_write, profile->writes[addr]);
+        max_exec = std::max(max_exec, profile->executes[addr]);
+    }
+    double log_read = std::log1p((double)max_read);
+    double log_write = std::log1p((double)max_write);
+    double log_exec = std::log1p((double)max_exec);
+
+    std::vector<uint8_t> pixels(0x10000 * 3);
+    for (int addr = 0; addr < 0x10000; addr++) {
+        pixels[addr * 3 + 0] = logScale(profile->writes[addr], log_write);
+        pixels[addr * 3 + 1] = logScale(profile->reads[addr], log_read);
+        pixels[addr * 3 + 2] = logScale(profile->executes[addr], log_exec);
+    }
+    fprintf(file, "P6\n256 256\n255\n");
+    bool ok = fwrite(pixels.data(), 1, pixels.size(), file) == pixels.size();
+    return fclose(file) == 0 && ok;
+}
+
+/**
+* Prints the {top} busiest 16-byte lines of {counts}.
+*/
+static void printTopLines(FILE* out, const char* title, const uint32_t* counts, int top) {
+    std::vector<uint64_t> lines(PROFILE_LINES, 0);
+    for (int addr = 0; addr < 0x10000; addr++) {
+        lines[addr >> PROFILE_LINE_SHIFT] += counts[addr];
+    }
+    std::vector<int> order(PROFILE_LINES);
+    for (int i = 0; i < PROFILE_LINES; i++) {
+        order[i] = i;
+    }
+    int shown = std::min(top, PROFILE_LINES);
+    std::partial_sort(order.begin(), order.begin() + shown, order.end(),
+        [&](int x, int y) { return lines[x] != lines[y] ? lines[x] > lines[y] : x < y; });
+
+    fprintf(out, "\nTop %d lines by %s:\n", shown, title);
+    for (int i = 0; i < shown && lines[order[i]] > 0; i++) {
+        int start = order[i] << PROFILE_LINE_SHIFT;
+        fprintf(out, "  %04x-%04x  %12llu\n", start, start + (1 << PROFILE_LINE_SHIFT) - 1,
+            (unsigned long long)lines[order[i]]);
+    }
+}
+
+void writeProfileReport(const MemoryProfile* profile, State8080* cpu, FILE* out, int top) {
+    fprintf(out, "%-10s %14s %14s %14s\n", "region", "reads", "writes", "executes");
+    for (const ProfileRegion& region : REGIONS) {
+        uint64_t reads = 0, writes = 0, executes = 0;
+        for (uint32_t addr = region.start; addr < region.end; addr++) {
+            reads += profile->reads[addr];
+            writes += profile->writes[addr];
+            executes += profile->executes[addr];
+        }
+        fprintf(out, "%-10s %14llu %14llu %14llu\n", region.name,
+            (unsigned long long)reads, (unsigned long long)writes, (unsigned long long)executes);
+    }
+
+    printTopLines(out, "reads", profile->reads, top);
+    printTopLines(out, "writes", profile->writes, top);
+
+    // Disassemble from a copy of the CPU's view so mirrors and the 0xFFFF wrap read correctly
+    std::vector<unsigned char> image(0x10000 + 2);
+    for (uint32_t addr = 0; addr < image.size(); addr++) {
+        image[addr] = peekByte(cpu, (uint16_t)addr);
+    }
+    std::vector<int> order(0x10000);
+    for (int i = 0; i < 0x10000; i++) {
+        order[i] = i;
+    }
+    int shown = std::min(top, 0x10000);
+    std::partial_sort(order.begin(), order.begin() + shown, order.end(), [&](int x, int y) {
+        return profile->executes[x] != profile->executes[y] ? profile->executes[x] > profile->executes[y] : x < y;
+    });
+    fprintf(out, "\nTop %d executed addresses:\n", shown);
+    for (int i = 0; i < shown && profile->executes[order[i]] > 0; i++) {
+        fprintf(out, "  %12u  ", profile->executes[order[i]]);
+        Disassemble8080Op(out, image.data(), order[i]);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef MEMORY_PROFILE_H
+#define MEMORY_PROFILE_H
+
+#include "initcpu.h"
+#include <cstdint>
+#include <cstdio>
+
+#define PROFILE_LINE_SHIFT 4 // 16 byte lines in the report
+#define PROFILE_DEFAULT_TOP 20
+
+/*
+ * Memory access heatmap. Configure with -DPROFILE_MEMORY=ON to compile
+ * the counting hooks into readByte, writeByte and fetchOpcode; without
+ * it the hooks do not exist and the emulator runs at full speed.
+ *
+ * Counts are per CPU address (mirrors are counted where they are
+ * accessed). Reads are data reads, including stack pops; operand bytes
+ * are part of the instruction and only the opcode address counts as an
+ * execute.
+ */
+
+struct MemoryProfile {
+    uint32_t reads[0x10000];
+    uint32_t writes[0x10000];
+    uint32_t executes[0x10000];
+};
+
+/**
+* Zeroes {profile} and starts counting accesses made by {cpu} into it.
+* Has no effect unless built with PROFILE_MEMORY.
+*
+* @return false if profiling is compiled out.
+*/
+bool attachMemoryProfile(State8080* cpu, MemoryProfile* profile);
+
+void detachMemoryProfile(State8080* cpu);
+
+/**
+* Writes a 256x256 binary PPM, one pixel per address (row = high byte):
+* red = writes, green = reads, blue = executes, each log scaled.
+*
+* @return false if the file could not be written.
+*/
+bool writeHeatmap(const MemoryProfile* profile, const char* path);
+
+/**
+* Writes totals per region, the {top} hottest 16-byte lines for reads
+* and writes, and the {top} most executed addresses with disassembly.
+*
+* @param cpu Supplies the bytes to disassemble.
+*/
+void writeProfileReport(const MemoryProfile* profile, State8080* cpu, FILE* out, int top = PROFILE_DEFAULT_TOP);
+
+#endif
@@ -0,0 +1,155 @@
+#include "mixer.h"
+#include <cstring>
+
+void setMixerSamples(SoundMixer* mixer, const float* const* data, const uint32_t* lengths) {
+    size_t total = 0;
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        total += data[i] ? lengths[i] : 0;
+    }
+    mixer->arena.assign(total, 0.0f);
+    uint32_t offset = 0;
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        uint32_t length = data[i] ? lengths[i] : 0;
+        if (length) {
+            memcpy(mixer->arena.data() + offset, data[i], length * sizeof(float));
+        }
+        mixer->samples[i].offset = offset;
+        mixer->samples[i].length = length;
+        offset += length;
+    }
+}
+
+void adoptMixerSamples(SoundMixer* mixer, SoundMixer* loaded) {
+    mixer->arena.swap(loaded->arena);
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        MixerSample sample = mixer->samples[i];
+        mixer->samples[i] = loaded->samples[i];
+        loaded->samples[i] = sample;
+    }
+}
+
+/**
+* Returns a free voice, or takes over the one that started first.
+*/
+static MixerVoice* claimVoice(SoundMixer* mixer) {
+    MixerVoice* oldest = &mixer->voices[0];
+    for (MixerVoice& voice : mixer->voices) {
+        if (!voice.active) {
+            return &voice;
+        }
+        if (voice.start < oldest->start) {
+            oldest = &voice;
+        }
+    }
+    mixer->voices_stolen++;
+    return oldest;
+}
+
+void triggerVoice(SoundMixer* mixer, SoundEffect effect, bool on, uint64_t time) {
+    bool looping = effect == SOUND_UFO_HIGH;
+    if (looping) {
+        for (MixerVoice& voice : mixer->voices) {
+            if (voice.active && voice.looping && voice.effect == effect) {
+                // Restarted before it stopped: keep the loop going
+                voice.stop = on ? MIXER_NO_STOP : time;
+                return;
+            }
+        }
+    }
+    if (!on || mixer->samples[effect].length == 0) {
+        return;
+    }
+    MixerVoice* voice = claimVoice(mixer);
+    voice->active = true;
+    voice->looping = looping;
+    voice->effect = (uint8_t)effect;
+    voice->position = 0;
+    voice->start = time;
+    voice->stop = MIXER_NO_STOP;
+}
+
+/**
+* Adds {voice} into out[0, frames), where out[0] is output frame {time}.
+*/
+static void mixVoice(SoundMixer* mixer, MixerVoice* voice, float* out, uint32_t frames, uint64_t time) {
+    const MixerSample& sample = mixer->samples[voice->effect];
+    const float* data = mixer->arena.data() + sample.offset;
+    uint64_t end = time + frames;
+    if (voice->start >= end) {
+        return;
+    }
+    uint32_t i = voice->start > time ? (uint32_t)(voice->start - time) : 0;
+    uint32_t until = voice->stop < end ? (uint32_t)(voice->stop > time ? voice->stop - time : 0) : frames;
+    while (i < until) {
+        uint32_t run = until - i;
+        uint32_t left = sample.length - voice->position;
+        run = run < left ? run : left;
+        for (uint32_t n = 0; n < run; n++) {
+            out[i + n] += data[voice->position + n];
+        }
+        i += run;
+        voice->position += run;
+        if (voice->position == sample.length) {
+            if (!voice->looping) {
+                voice->active = false;
+                return;
+            }
+            voice->position = 0;
+        }
+    }
+    if (voice->stop <= end) {
+        voice->active = false;
+    }
+}
+
+/**
+* Records the latency of the onsets whose first sample is in this buffer.
+*/
+static void measureOnsets(SoundMixer* mixer, uint32_t frames) {
+    uint64_t end = mixer->time + frames;
+    for (uint32_t i = 0; i < mixer->pending_count;) {
+        PendingOnset& onset = mixer->pending[i];
+        if (onset.time >= end) {
+            i++;
+            continue;
+        }
+        uint64_t offset = onset.time > mixer->time ? onset.time - mixer->time : 0;
+        uint64_t played = mixer->host_ns + offset * 1000000000ull / mixer->clock.sample_rate;
+        addLatency(&mixer->latency, played > onset.posted_ns ? played - onset.posted_ns : 0);
+        onset = mixer->pending[--mixer->pending_count];
+    }
+}
+
+void mixSound(SoundMixer* mixer, SoundEventQueue* events, float* out, uint32_t frames) {
+    SoundEvent event;
+    while (events && events->events.pop(&event)) {
+        uint64_t time = soundEventTime(&mixer->clock, event.cycle, mixer->time, &mixer->timing);
+        if (mixer->host_ns && event.on && mixer->pending_count < MIXER_PENDING) {
+            mixer->pending[mixer->pending_count++] = PendingOnset{ time, event.posted_ns };
+        }
+        if (mixer->synth) {
+            triggerSynth(mixer->synth, static_cast<SoundEffect>(event.effect), event.on != 0, time);
+        }
+        else {
+            triggerVoice(mixer, static_cast<SoundEffect>(event.effect), event.on != 0, time);
+        }
+    }
+
+    if (mixer->host_ns) {
+        measureOnsets(mixer, frames);
+    }
+
+    memset(out, 0, frames * sizeof(float));
+    if (mixer->synth) {
+        renderSynth(mixer->synth, out, frames, mixer->time);
+    }
+    for (MixerVoice& voice : mixer->voices) {
+        if (voice.active) {
+            mixVoice(mixer, &voice, out, frames, mixer->time);
+        }
+    }
+    for (uint32_t i = 0; i < frames; i++) {
+        out[i] = out[i] > 1.0f ? 1.0f : (out[i] < -1.0f ? -1.0f : out[i]);
+    }
+    mixer->time += frames;
+}
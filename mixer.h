@@ -0,0 +1,108 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include "sound.h"
+#include "synth.h"
+#include "latency.h"
+#include <cstdint>
+#include <vector>
+
+#define MIXER_VOICES 16
+#define MIXER_NO_STOP UINT64_MAX
+#define MIXER_PENDING 64            // onsets awaiting their latency measurement
+
+/*
+ * Voice pool mixer.
+ *
+ * All ten effects are decoded once at startup, already converted to mono
+ * float at the device rate, and packed into one arena. The decoding runs
+ * on a background thread; until its arena is adopted, effects are
+ * silently dropped so the emulation need not wait. Playing an effect
+ * claims one of a fixed pool of voices, so a retriggered shot overlaps
+ * the one still sounding instead of restarting it. mixSound runs in the
+ * audio device callback: it drains the machine's SoundEventQueue, places
+ * each event with the SoundClock and adds the active voices into the
+ * output, with no allocation and no locks.
+ *
+ * Only the high pitched UFO loops; it plays until its stop event. When
+ * every voice is busy the one that started first is taken over.
+ *
+ * With a SoundSynth attached the events key its circuits instead and the
+ * output is synthesized; no samples are needed.
+ */
+
+struct MixerSample {
+    uint32_t offset = 0;    // first frame in the arena
+    uint32_t length = 0;    // frames
+};
+
+struct MixerVoice {
+    bool active = false;
+    bool looping = false;
+    uint8_t effect = 0;
+    uint32_t position = 0;          // next frame of the sample
+    uint64_t start = 0;             // output frame it starts at
+    uint64_t stop = MIXER_NO_STOP;  // output frame it stops at
+};
+
+/**
+* Onset that has not reached the output yet, see SoundMixer::host_ns.
+*/
+struct PendingOnset {
+    uint64_t time;          // output frame of its first sample
+    uint64_t posted_ns;     // host time of the OUT edge
+};
+
+struct SoundMixer {
+    std::vector<float> arena;
+    MixerSample samples[SOUND_COUNT];
+    MixerVoice voices[MIXER_VOICES];
+    uint64_t time = 0;              // output frames mixed so far
+    SoundClock clock;
+    SoundTimingStats timing;
+    RateControlStats rate;
+    uint32_t voices_stolen = 0;
+    SoundSynth* synth = nullptr;    // synthesize instead of playing samples, see synth.h
+
+    // OUT edge to output latency. The device callback sets {host_ns} to
+    // the host time of each buffer before mixing it; 0 (offline sinks)
+    // skips the measurement.
+    uint64_t host_ns = 0;
+    PendingOnset pending[MIXER_PENDING];
+    uint32_t pending_count = 0;
+    LatencyHistogram latency;
+
+    // Device callback cost, filled in by the callback (sound.cpp)
+    uint32_t callbacks = 0;
+    uint64_t callback_ns_sum = 0;
+    uint64_t callback_ns_max = 0;
+};
+
+/**
+* Copies the effects' PCM (mono float at the output rate) into one arena.
+*
+* @param data Frames of each effect, indexed by SoundEffect; may be null.
+* @param lengths Frame count of each effect.
+*/
+void setMixerSamples(SoundMixer* mixer, const float* const* data, const uint32_t* lengths);
+
+/**
+* Takes over the arena and sample table that setMixerSamples built in
+* {loaded}, e.g. on a loader thread, leaving {loaded} with the old ones.
+* Only swaps, so it is safe in the device callback.
+*/
+void adoptMixerSamples(SoundMixer* mixer, SoundMixer* loaded);
+
+/**
+* Starts a voice for {effect} at output frame {time}, or stops the
+* looping voice of {effect} there.
+*/
+void triggerVoice(SoundMixer* mixer, SoundEffect effect, bool on, uint64_t time);
+
+/**
+* Renders the next {frames} mono frames into {out}. Drains {events}
+* first; it may be null.
+*/
+void mixSound(SoundMixer* mixer, SoundEventQueue* events, float* out, uint32_t frames);
+
+#endif
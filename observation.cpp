@@ -0,0 +1,570 @@
+#include "observation.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define OBS_SSE2
+#endif
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+#define OBS_PLANE_STRIDE (OBS_VRAM_COLUMNS + 16) // Padding lets the resize loops read whole vectors
+#define OBS_AREA_STRIDE (OBS_SCREEN_HEIGHT + 8) // Area sums per output column, with room for a unit's rows past the last
+
+static inline int countTrailingZeros(uint32_t v) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, v);
+    return (int)i;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+#ifdef OBS_SSE2
+/**
+* Transposes a 16x16 byte block: byte j of x[i] moves to byte i of x[j].
+* Four rounds of interleaving row i with row i + 8.
+*/
+static inline void transpose16x16(__m128i* x) {
+    __m128i t[16];
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 8; i++) {
+            t[2 * i] = _mm_unpacklo_epi8(x[i], x[i + 8]);
+            t[2 * i + 1] = _mm_unpackhi_epi8(x[i], x[i + 8]);
+        }
+        memcpy(x, t, sizeof(t));
+    }
+}
+#endif
+
+/**
+* planes[r][x] = columns[x * 32 + r] for {count} columns, a multiple of 16:
+* byte r of every column side by side, so bit b of planes[r] is screen
+* row 255 - (8 * r + b), left to right.
+*/
+static void transposeColumns(const uint8_t* columns, int count, uint8_t (*planes)[OBS_PLANE_STRIDE]) {
+#ifdef OBS_SSE2
+    for (int c0 = 0; c0 < count; c0 += 16) {
+        for (int r0 = 0; r0 < OBS_VRAM_COLUMN_BYTES; r0 += 16) {
+            __m128i x[16];
+            for (int i = 0; i < 16; i++) {
+                x[i] = _mm_loadu_si128((const __m128i*)(columns + (c0 + i) * OBS_VRAM_COLUMN_BYTES + r0));
+            }
+            transpose16x16(x);
+            for (int j = 0; j < 16; j++) {
+                _mm_storeu_si128((__m128i*)(planes[r0 + j] + c0), x[j]);
+            }
+        }
+    }
+#else
+    for (int x = 0; x < count; x++) {
+        for (int r = 0; r < OBS_VRAM_COLUMN_BYTES; r++) {
+            planes[r][x] = columns[x * OBS_VRAM_COLUMN_BYTES + r];
+        }
+    }
+#endif
+    for (int r = 0; r < OBS_VRAM_COLUMN_BYTES; r++) {
+        memset(planes[r] + count, 0, OBS_PLANE_STRIDE - count);
+    }
+}
+
+static void transposeVram(const uint8_t* vram, uint8_t (*planes)[OBS_PLANE_STRIDE]) {
+    transposeColumns(vram, OBS_VRAM_COLUMNS, planes);
+}
+
+#ifdef OBS_SSE2
+static inline __m128i testBits(__m128i v, __m128i mask) {
+    return _mm_cmpeq_epi8(_mm_and_si128(v, mask), mask);
+}
+
+static inline void storeMask(uint8_t* dst, __m128i m) {
+    _mm_storeu_si128((__m128i*)dst, m);
+}
+
+static inline void storeMask(float* dst, __m128i m) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128i lo = _mm_unpacklo_epi8(m, m);
+    __m128i hi = _mm_unpackhi_epi8(m, m);
+    _mm_storeu_ps(dst, _mm_and_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(lo, lo)), one));
+    _mm_storeu_ps(dst + 4, _mm_and_ps(_mm_castsi128_ps(_mm_unpackhi_epi16(lo, lo)), one));
+    _mm_storeu_ps(dst + 8, _mm_and_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(hi, hi)), one));
+    _mm_storeu_ps(dst + 12, _mm_and_ps(_mm_castsi128_ps(_mm_unpackhi_epi16(hi, hi)), one));
+}
+#endif
+
+static inline void storePixel(uint8_t* dst, bool lit) { *dst = lit ? 255 : 0; }
+static inline void storePixel(float* dst, bool lit) { *dst = lit ? 1.0f : 0.0f; }
+
+void unpackScreen(const uint8_t* vram, uint8_t* out) {
+    alignas(16) uint8_t planes[OBS_VRAM_COLUMN_BYTES][OBS_PLANE_STRIDE];
+    transposeVram(vram, planes);
+
+    for (int y = 0; y < OBS_SCREEN_HEIGHT; y++) {
+        int t = OBS_SCREEN_HEIGHT - 1 - y;
+        const uint8_t* row = planes[t >> 3];
+        uint8_t* dst = out + y * OBS_SCREEN_WIDTH;
+#ifdef OBS_SSE2
+        __m128i mask = _mm_set1_epi8((char)(1 << (t & 7)));
+        for (int x = 0; x < OBS_SCREEN_WIDTH; x += 16) {
+            storeMask(dst + x, testBits(_mm_load_si128((const __m128i*)(row + x)), mask));
+        }
+#else
+        for (int x = 0; x < OBS_SCREEN_WIDTH; x++) {
+            storePixel(dst + x, (row[x] >> (t & 7)) & 1);
+        }
+#endif
+    }
+}
+
+template <typename T>
+static void maxPoolScreenImpl(const uint8_t* vram, T* out) {
+    alignas(16) uint8_t planes[OBS_VRAM_COLUMN_BYTES][OBS_PLANE_STRIDE];
+    transposeVram(vram, planes);
+
+    for (int r = 0; r < OBS_VRAM_COLUMN_BYTES; r++) {
+        const uint8_t* row = planes[r];
+#ifdef OBS_SSE2
+        const __m128i low_bytes = _mm_set1_epi16(0x00ff);
+        for (int k = 0; k < OBS_POOLED_WIDTH / 16; k++) {
+            // OR neighbouring columns, then narrow 32 columns to 16
+            __m128i a = _mm_load_si128((const __m128i*)(row + 32 * k));
+            __m128i b = _mm_load_si128((const __m128i*)(row + 32 * k + 16));
+            a = _mm_and_si128(_mm_or_si128(a, _mm_srli_epi16(a, 8)), low_bytes);
+            b = _mm_and_si128(_mm_or_si128(b, _mm_srli_epi16(b, 8)), low_bytes);
+            __m128i h = _mm_packus_epi16(a, b);
+            // OR neighbouring rows: bit 2q now covers bits 2q and 2q + 1
+            __m128i v = _mm_or_si128(h, _mm_srli_epi16(h, 1));
+            for (int q = 0; q < 4; q++) {
+                int oy = OBS_POOLED_HEIGHT - 1 - (4 * r + q);
+                storeMask(out + oy * OBS_POOLED_WIDTH + 16 * k, testBits(v, _mm_set1_epi8((char)(1 << (2 * q)))));
+            }
+        }
+#else
+        for (int ox = 0; ox < OBS_POOLED_WIDTH; ox++) {
+            uint8_t h = row[2 * ox] | row[2 * ox + 1];
+            uint8_t v = h | (h >> 1);
+            for (int q = 0; q < 4; q++) {
+                int oy = OBS_POOLED_HEIGHT - 1 - (4 * r + q);
+                storePixel(out + oy * OBS_POOLED_WIDTH + ox, (v >> (2 * q)) & 1);
+            }
+        }
+#endif
+    }
+}
+
+void maxPoolScreen(const uint8_t* vram, uint8_t* out) {
+    maxPoolScreenImpl(vram, out);
+}
+
+void maxPoolScreen(const uint8_t* vram, float* out) {
+    maxPoolScreenImpl(vram, out);
+}
+
+/**
+* Exact area weights for resizing {source} pixels to {count}, in
+* 1/{total} units that sum to {total} per output.
+*/
+static void buildAreaTaps(int source, int count, int total, std::vector<uint16_t>& offset, std::vector<uint16_t>& index, std::vector<uint16_t>& weight) {
+    offset.assign(1, 0);
+    index.clear();
+    weight.clear();
+    for (int i = 0; i < count; i++) {
+        // Output i covers [i * source, (i + 1) * source) in units of 1 / count
+        int lo = i * source, hi = (i + 1) * source;
+        size_t first = index.size(), heaviest = first;
+        int sum = 0;
+        for (int j = lo / count; j * count < hi; j++) {
+            int overlap = (hi < (j + 1) * count ? hi : (j + 1) * count) - (lo > j * count ? lo : j * count);
+            uint16_t w = (uint16_t)((overlap * total + source / 2) / source);
+            index.push_back((uint16_t)j);
+            weight.push_back(w);
+            sum += w;
+            if (w > weight[heaviest]) heaviest = weight.size() - 1;
+        }
+        weight[heaviest] = (uint16_t)(weight[heaviest] + total - sum);
+        offset.push_back((uint16_t)index.size());
+    }
+}
+
+bool initObservationResizer(ObservationResizer* resizer, int width, int height) {
+    if (width < 32 || width > OBS_SCREEN_WIDTH || height < 32 || height > OBS_SCREEN_HEIGHT) {
+        return false;
+    }
+    resizer->width = width;
+    resizer->height = height;
+
+    resizer->col_start.resize(width);
+    resizer->col_end.resize(width);
+    for (int ox = 0; ox < width; ox++) {
+        resizer->col_start[ox] = (uint16_t)(ox * OBS_SCREEN_WIDTH / width);
+        resizer->col_end[ox] = (uint16_t)(((ox + 1) * OBS_SCREEN_WIDTH + width - 1) / width);
+    }
+
+    // At most 9 source rows per output row, so the bits span one or two plane bytes
+    resizer->row_byte0.resize(height);
+    resizer->row_mask0.resize(height);
+    resizer->row_byte1.resize(height);
+    resizer->row_mask1.resize(height);
+    for (int oy = 0; oy < height; oy++) {
+        int y0 = oy * OBS_SCREEN_HEIGHT / height;
+        int y1 = ((oy + 1) * OBS_SCREEN_HEIGHT + height - 1) / height;
+        int t_lo = OBS_SCREEN_HEIGHT - y1, t_hi = OBS_SCREEN_HEIGHT - 1 - y0;
+        int b0 = t_lo >> 3, b1 = t_hi >> 3;
+        resizer->row_byte0[oy] = (uint8_t)b0;
+        resizer->row_byte1[oy] = (uint8_t)b1;
+        if (b0 == b1) {
+            resizer->row_mask0[oy] = (uint8_t)((0xff << (t_lo & 7)) & (0xff >> (7 - (t_hi & 7))));
+            resizer->row_mask1[oy] = 0;
+        } else {
+            resizer->row_mask0[oy] = (uint8_t)(0xff << (t_lo & 7));
+            resizer->row_mask1[oy] = (uint8_t)(0xff >> (7 - (t_hi & 7)));
+        }
+    }
+
+    // A row weight times a column weight is at most 255 * 256, so sums fit 16 bits
+    std::vector<uint16_t> offset, index, weight;
+    buildAreaTaps(OBS_SCREEN_WIDTH, width, 256, offset, index, weight);
+    resizer->area_column.assign(OBS_SCREEN_WIDTH, 0);
+    resizer->area_weight0.assign(OBS_SCREEN_WIDTH, 0);
+    resizer->area_weight1.assign(OBS_SCREEN_WIDTH, 0);
+    for (int ox = width - 1; ox >= 0; ox--) {
+        // Walking backwards, a column's first output ends up in area_column
+        for (int tap = offset[ox]; tap < offset[ox + 1]; tap++) {
+            int x = index[tap];
+            resizer->area_weight1[x] = resizer->area_column[x] == ox + 1 ? resizer->area_weight0[x] : 0;
+            resizer->area_column[x] = (uint8_t)ox;
+            resizer->area_weight0[x] = weight[tap];
+        }
+    }
+
+    // Source row y feeds at most two output rows
+    buildAreaTaps(OBS_SCREEN_HEIGHT, height, 255, offset, index, weight);
+    int row_taps[OBS_SCREEN_HEIGHT] = {}, row_out[OBS_SCREEN_HEIGHT][2], row_weight[OBS_SCREEN_HEIGHT][2];
+    for (int oy = 0; oy < height; oy++) {
+        for (int tap = offset[oy]; tap < offset[oy + 1]; tap++) {
+            int y = index[tap];
+            row_out[y][row_taps[y]] = oy;
+            row_weight[y][row_taps[y]++] = weight[tap];
+        }
+    }
+    int bits = 8;
+    while (bits * height > 3 * OBS_SCREEN_HEIGHT) {
+        bits /= 2;   // Up to 3 output rows tall, a unit touches at most four
+    }
+    int units = OBS_SCREEN_HEIGHT / bits;
+    resizer->area_unit_bits = bits;
+    resizer->area_row.resize(units);
+    resizer->area_blocks.assign(units, 0);
+    resizer->area_table.assign((size_t)units << bits, 0);
+    for (int unit = 0; unit < units; unit++) {
+        // VRAM bit t is screen row 255 - t, so the unit's top row is its last bit
+        int first = row_out[OBS_SCREEN_HEIGHT - 1 - (unit * bits + bits - 1)][0];
+        resizer->area_row[unit] = (uint8_t)first;
+        for (int value = 0; value < (1 << bits); value++) {
+            uint16_t lanes[4] = { 0, 0, 0, 0 };
+            for (int b = 0; b < bits; b++) {
+                int y = OBS_SCREEN_HEIGHT - 1 - (unit * bits + b);
+                for (int slot = 0; slot < row_taps[y] && ((value >> b) & 1); slot++) {
+                    lanes[row_out[y][slot] - first] = (uint16_t)(lanes[row_out[y][slot] - first] + row_weight[y][slot]);
+                }
+            }
+            for (int i = 0; i < 4; i++) {
+                if (lanes[i]) {
+                    resizer->area_blocks[unit] |= 1u << ((first + i) >> 3);
+                }
+            }
+            uint64_t entry;
+            memcpy(&entry, lanes, sizeof(entry));
+            resizer->area_table[(size_t)unit << bits | value] = entry;
+        }
+    }
+    return true;
+}
+
+void resizeScreenMax(const ObservationResizer* resizer, const uint8_t* vram, uint8_t* out) {
+    // OR the source columns of each output column straight from VRAM, where
+    // a column is 32 contiguous bytes, then transpose only the result
+    alignas(16) uint8_t merged[OBS_VRAM_COLUMNS][OBS_VRAM_COLUMN_BYTES];
+    alignas(16) uint8_t columns[OBS_VRAM_COLUMN_BYTES][OBS_PLANE_STRIDE];
+    int width = resizer->width;
+    int padded = (width + 15) & ~15;
+    for (int ox = 0; ox < width; ox++) {
+        const uint8_t* src = vram + resizer->col_start[ox] * OBS_VRAM_COLUMN_BYTES;
+        int count = resizer->col_end[ox] - resizer->col_start[ox];
+#ifdef OBS_SSE2
+        __m128i lo = _mm_loadu_si128((const __m128i*)src);
+        __m128i hi = _mm_loadu_si128((const __m128i*)(src + 16));
+        for (int i = 1; i < count; i++) {
+            lo = _mm_or_si128(lo, _mm_loadu_si128((const __m128i*)(src + i * OBS_VRAM_COLUMN_BYTES)));
+            hi = _mm_or_si128(hi, _mm_loadu_si128((const __m128i*)(src + i * OBS_VRAM_COLUMN_BYTES + 16)));
+        }
+        _mm_store_si128((__m128i*)merged[ox], lo);
+        _mm_store_si128((__m128i*)(merged[ox] + 16), hi);
+#else
+        for (int r = 0; r < OBS_VRAM_COLUMN_BYTES; r++) {
+            uint8_t bits = 0;
+            for (int i = 0; i < count; i++) {
+                bits |= src[i * OBS_VRAM_COLUMN_BYTES + r];
+            }
+            merged[ox][r] = bits;
+        }
+#endif
+    }
+    memset(merged[width], 0, (size_t)(padded - width) * OBS_VRAM_COLUMN_BYTES);
+    transposeColumns(&merged[0][0], padded, columns);
+
+    for (int oy = 0; oy < resizer->height; oy++) {
+        const uint8_t* c0 = columns[resizer->row_byte0[oy]];
+        const uint8_t* c1 = columns[resizer->row_byte1[oy]];
+        uint8_t m0 = resizer->row_mask0[oy], m1 = resizer->row_mask1[oy];
+        uint8_t* dst = out + oy * width;
+        int ox = 0;
+#ifdef OBS_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi8(-1);
+        for (; ox + 16 <= width; ox += 16) {
+            __m128i bits = _mm_or_si128(
+                _mm_and_si128(_mm_load_si128((const __m128i*)(c0 + ox)), _mm_set1_epi8((char)m0)),
+                _mm_and_si128(_mm_load_si128((const __m128i*)(c1 + ox)), _mm_set1_epi8((char)m1)));
+            _mm_storeu_si128((__m128i*)(dst + ox), _mm_xor_si128(_mm_cmpeq_epi8(bits, zero), ones));
+        }
+#endif
+        for (; ox < width; ox++) {
+            dst[ox] = ((c0[ox] & m0) | (c1[ox] & m1)) ? 255 : 0;
+        }
+    }
+}
+
+// A sum is lit area in units of 1 / (255 * 256)
+static inline void storeArea(uint8_t* dst, uint32_t sum) { *dst = (uint8_t)((sum + 128) >> 8); }
+static inline void storeArea(float* dst, uint32_t sum) { *dst = sum * (1.0f / 65280.0f); }
+
+#ifdef OBS_SSE2
+static inline void transpose8x8Words(__m128i* x) {
+    __m128i a[8], b[8];
+    for (int i = 0; i < 4; i++) {
+        a[2 * i] = _mm_unpacklo_epi16(x[i], x[i + 4]);
+        a[2 * i + 1] = _mm_unpackhi_epi16(x[i], x[i + 4]);
+    }
+    for (int i = 0; i < 4; i++) {
+        b[2 * i] = _mm_unpacklo_epi16(a[i], a[i + 4]);
+        b[2 * i + 1] = _mm_unpackhi_epi16(a[i], a[i + 4]);
+    }
+    for (int i = 0; i < 4; i++) {
+        x[2 * i] = _mm_unpacklo_epi16(b[i], b[i + 4]);
+        x[2 * i + 1] = _mm_unpackhi_epi16(b[i], b[i + 4]);
+    }
+}
+
+/**
+* Stores an 8 row x 16 column block of sums, column-major at {stride}, to
+* {dst}. The byte results of two columns share a word, so one 8 x 8 word
+* transpose yields whole rows. Null {sums} is an all dark block.
+*/
+static inline void storeAreaBlock(const uint16_t* sums, int stride, uint8_t* dst, int width) {
+    const __m128i half = _mm_set1_epi16(128);
+    __m128i v[8];
+    for (int i = 0; i < 8 && !sums; i++) {
+        v[i] = _mm_setzero_si128();
+    }
+    for (int i = 0; i < 8 && sums; i++) {
+        __m128i even = _mm_loadu_si128((const __m128i*)(sums + 2 * i * stride));
+        __m128i odd = _mm_loadu_si128((const __m128i*)(sums + (2 * i + 1) * stride));
+        even = _mm_srli_epi16(_mm_add_epi16(even, half), 8);
+        odd = _mm_srli_epi16(_mm_add_epi16(odd, half), 8);
+        v[i] = _mm_or_si128(even, _mm_slli_epi16(odd, 8));
+    }
+    if (sums) {
+        transpose8x8Words(v);
+    }
+    for (int i = 0; i < 8; i++) {
+        _mm_storeu_si128((__m128i*)(dst + i * width), v[i]);
+    }
+}
+
+/**
+* As above for 8 columns of floats. Taking the columns in the order
+* 0, 4, 1, 5, 2, 6, 3, 7 leaves each transposed row split into the
+* 32-bit lanes of columns 0 - 3 and 4 - 7, with no unpacking.
+*/
+static inline void storeAreaBlock(const uint16_t* sums, int stride, float* dst, int width) {
+    const __m128 scale = _mm_set1_ps(1.0f / 65280.0f);
+    const __m128i low_words = _mm_set1_epi32(0xffff);
+    __m128i v[8];
+    for (int i = 0; i < 4; i++) {
+        v[2 * i] = sums ? _mm_loadu_si128((const __m128i*)(sums + i * stride)) : _mm_setzero_si128();
+        v[2 * i + 1] = sums ? _mm_loadu_si128((const __m128i*)(sums + (i + 4) * stride)) : _mm_setzero_si128();
+    }
+    if (sums) {
+        transpose8x8Words(v);
+    }
+    for (int i = 0; i < 8; i++) {
+        _mm_storeu_ps(dst + i * width, _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(v[i], low_words)), scale));
+        _mm_storeu_ps(dst + i * width + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(v[i], 16)), scale));
+    }
+}
+#endif
+
+/**
+* Adds table {entry}, the weighted lit rows of one unit, to the four
+* output rows at {dst} scaled by column weight {weight}.
+*/
+static inline void addAreaRows(uint16_t* dst, uint64_t entry, uint16_t weight) {
+#ifdef OBS_SSE2
+    __m128i rows = _mm_loadl_epi64((const __m128i*)&entry);
+    rows = _mm_mullo_epi16(rows, _mm_set1_epi16((short)weight));
+    _mm_storel_epi64((__m128i*)dst, _mm_add_epi16(_mm_loadl_epi64((const __m128i*)dst), rows));
+#else
+    for (int i = 0; i < 4; i++) {
+        dst[i] = (uint16_t)(dst[i] + (uint16_t)(entry >> (16 * i)) * weight);
+    }
+#endif
+}
+
+/**
+* Adds whole-byte units {bytes} of VRAM {column} to the output column at
+* {dst} scaled by {w0}, and when {split}, to the next one, {stride}
+* further on, scaled by {w1}. Returns the 8 row output blocks touched.
+*/
+template <bool split>
+static inline uint32_t addAreaBytes(const ObservationResizer* resizer, const uint8_t* column, uint32_t bytes, uint16_t* dst, int stride, uint16_t w0, uint16_t w1) {
+    const uint64_t* table = resizer->area_table.data();
+    const uint8_t* unit_row = resizer->area_row.data();
+    const uint32_t* unit_blocks = resizer->area_blocks.data();
+    uint32_t blocks = 0;
+    for (; bytes; bytes &= bytes - 1) {
+        int r = countTrailingZeros(bytes);
+        uint64_t entry = table[r << 8 | column[r]];
+        addAreaRows(dst + unit_row[r], entry, w0);
+        if (split) {
+            addAreaRows(dst + stride + unit_row[r], entry, w1);
+        }
+        blocks |= unit_blocks[r];
+    }
+    return blocks;
+}
+
+/**
+* As above for all the bytes flagged in {lit}, in units of any size.
+*/
+template <bool split>
+static inline uint32_t addAreaColumn(const ObservationResizer* resizer, const uint8_t* column, uint32_t lit, uint16_t* dst, int stride, uint16_t w0, uint16_t w1) {
+    const uint64_t* table = resizer->area_table.data();
+    const uint8_t* unit_row = resizer->area_row.data();
+    const uint32_t* unit_blocks = resizer->area_blocks.data();
+    int unit_bits = resizer->area_unit_bits;
+    if (unit_bits == 8 && (lit & (lit >> 1) & (lit >> 2))) {
+        // Neighbouring bytes share an output row. In a run of lit bytes,
+        // taking even ones, then odd, keeps each update clear of the last
+        return addAreaBytes<split>(resizer, column, lit & 0x55555555u, dst, stride, w0, w1)
+            | addAreaBytes<split>(resizer, column, lit & 0xaaaaaaaau, dst, stride, w0, w1);
+    }
+    if (unit_bits == 8) {
+        return addAreaBytes<split>(resizer, column, lit, dst, stride, w0, w1);
+    }
+    uint32_t blocks = 0;
+    for (; lit; lit &= lit - 1) {
+        int r = countTrailingZeros(lit);
+        for (int shift = 0; shift < 8; shift += unit_bits) {
+            int bits = (column[r] >> shift) & ((1 << unit_bits) - 1);
+            int unit = (8 * r + shift) / unit_bits;
+            if (bits) {
+                uint64_t entry = table[unit << unit_bits | bits];
+                addAreaRows(dst + unit_row[unit], entry, w0);
+                if (split) {
+                    addAreaRows(dst + stride + unit_row[unit], entry, w1);
+                }
+                blocks |= unit_blocks[unit];
+            }
+        }
+    }
+    return blocks;
+}
+
+/**
+* Area resize core. Game frames are mostly dark, so rather than weighing
+* every source pixel it visits only the nonzero VRAM bytes: a table gives
+* each byte's weighted lit rows in up to four output rows, which are then
+* scaled by the byte's column weights and added to the one or two output
+* columns it feeds. The sums build up column by column and are transposed
+* back to rows 8 x 8 at a time, skipping blocks no byte reached.
+*/
+template <typename T>
+static void resizeScreenAreaImpl(const ObservationResizer* resizer, const uint8_t* vram, T* out) {
+    alignas(16) uint16_t acc[OBS_SCREEN_WIDTH * OBS_AREA_STRIDE];
+    uint32_t touched[OBS_SCREEN_WIDTH / 8 + 1] = {};   // 8 row blocks per group of 8 output columns
+    int width = resizer->width, height = resizer->height;
+    int stride = ((height + 7) & ~7) + 8;
+    memset(acc, 0, (size_t)width * stride * sizeof(uint16_t));
+
+    for (int x = 0; x < OBS_SCREEN_WIDTH; x++) {
+        const uint8_t* column = vram + x * OBS_VRAM_COLUMN_BYTES;
+#ifdef OBS_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        uint32_t dark = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)column), zero))
+            | (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(column + 16)), zero)) << 16;
+        uint32_t lit = ~dark;
+#else
+        uint32_t lit = 0;
+        for (int r = 0; r < OBS_VRAM_COLUMN_BYTES; r++) {
+            lit |= (uint32_t)(column[r] != 0) << r;
+        }
+#endif
+        if (!lit) {
+            continue;
+        }
+        int ox = resizer->area_column[x];
+        uint16_t w0 = resizer->area_weight0[x], w1 = resizer->area_weight1[x];
+        if (w1) {
+            uint32_t blocks = addAreaColumn<true>(resizer, column, lit, acc + ox * stride, stride, w0, w1);
+            touched[ox >> 3] |= blocks;
+            touched[(ox + 1) >> 3] |= blocks;
+        } else {
+            touched[ox >> 3] |= addAreaColumn<false>(resizer, column, lit, acc + ox * stride, stride, w0, 0);
+        }
+    }
+
+#ifdef OBS_SSE2
+    // Blocks of 8 rows by 16 bytes or 8 floats. The last row and column of
+    // blocks step back to end at the edge, redoing a few pixels.
+    const int block = sizeof(T) == 1 ? 16 : 8;
+    for (int y = 0; y < height; y += 8) {
+        int oy = y + 8 <= height ? y : height - 8;
+        uint32_t rows = 1u << (oy >> 3) | 1u << ((oy + 7) >> 3);
+        for (int x = 0; x < width; x += block) {
+            int ox = x + block <= width ? x : width - block;
+            uint32_t lit = 0;
+            for (int group = ox >> 3; group <= (ox + block - 1) >> 3; group++) {
+                lit |= touched[group];
+            }
+            const uint16_t* sums = lit & rows ? acc + ox * stride + oy : nullptr;
+            storeAreaBlock(sums, stride, out + oy * width + ox, width);
+        }
+    }
+#else
+    (void)touched;
+    for (int oy = 0; oy < height; oy++) {
+        for (int ox = 0; ox < width; ox++) {
+            storeArea(out + oy * width + ox, acc[ox * stride + oy]);
+        }
+    }
+#endif
+}
+
+void resizeScreenArea(const ObservationResizer* resizer, const uint8_t* vram, uint8_t* out) {
+    resizeScreenAreaImpl(resizer, vram, out);
+}
+
+void resizeScreenArea(const ObservationResizer* resizer, const uint8_t* vram, float* out) {
+    resizeScreenAreaImpl(resizer, vram, out);
+}
+
+void pushFrameStack(void* stack, size_t frame_bytes, int depth, const void* frame) {
+    uint8_t* base = (uint8_t*)stack;
+    if (depth > 1) {
+        memmove(base, base + frame_bytes, (size_t)(depth - 1) * frame_bytes);
+    }
+    memcpy(base + (size_t)(depth - 1) * frame_bytes, frame, frame_bytes);
+}
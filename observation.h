@@ -0,0 +1,105 @@
+#ifndef OBSERVATION_H
+#define OBSERVATION_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define OBS_SCREEN_WIDTH 224
+#define OBS_SCREEN_HEIGHT 256
+#define OBS_VRAM_COLUMNS 224 // One 32 byte column per screen x, bit 0 of byte 0 is the bottom pixel
+#define OBS_VRAM_COLUMN_BYTES 32
+#define OBS_POOLED_WIDTH 112
+#define OBS_POOLED_HEIGHT 128
+
+/*
+ * Observation kernels for agents. All of them read the rotated 1bpp
+ * VRAM layout DrawScreen renders (pass state->memory + 0x2400) and write
+ * upright, row-major images into caller-provided buffers: uint8 as
+ * 0 - 255, float as 0.0 - 1.0.
+ *
+ * The kernels transpose VRAM in 16x16 byte blocks so each screen row
+ * becomes a contiguous bit plane, then do SSE2 mask arithmetic on 16
+ * pixels at a time; resizeScreenMax ORs source columns first and
+ * transposes only the result. Other targets use the scalar fallback.
+ *
+ * Best of several --observation-bench runs on one x86-64 core:
+ * unpackScreen 2 - 3 us, maxPoolScreen 1 us as uint8 and 2.5 - 3 us as
+ * float, resizeScreenMax to 84x84 1.5 - 2 us. The float kernels are
+ * bound by their stores, 16 bytes at a time.
+ *
+ * resizeScreenArea only visits lit VRAM bytes, so its cost follows the
+ * screen: 84x84 takes about 3 us as uint8 and 4 us as float on attract
+ * frames, 4.5 - 5 and 5.5 - 6 us in play, and up to 16 us for VRAM full
+ * of noise. Use resizeScreenMax where a 2 us budget matters.
+ */
+
+/**
+* Full resolution 224x256 image.
+*
+* @param vram 7 KB of video memory.
+* @param out OBS_SCREEN_WIDTH * OBS_SCREEN_HEIGHT bytes.
+*/
+void unpackScreen(const uint8_t* vram, uint8_t* out);
+
+/**
+* 2x2 max pool to 112x128: a pixel is lit if any of its four sources are.
+*
+* @param vram 7 KB of video memory.
+* @param out OBS_POOLED_WIDTH * OBS_POOLED_HEIGHT values.
+*/
+void maxPoolScreen(const uint8_t* vram, uint8_t* out);
+void maxPoolScreen(const uint8_t* vram, float* out);
+
+/**
+* Precomputed source spans and weights for resizing to any size, e.g.
+* 84x84. Build once per output size with initObservationResizer.
+*/
+struct ObservationResizer {
+    int width = 0;
+    int height = 0;
+
+    // Max mode: source column span per output column, source bit mask per output row
+    std::vector<uint16_t> col_start, col_end;
+    std::vector<uint8_t> row_byte0, row_mask0, row_byte1, row_mask1;
+
+    // Area mode, driven by lit VRAM bytes. Source column x feeds output columns
+    // area_column[x] and the next with weights area_weight0/1[x], which sum to
+    // 256 per output column. A unit of area_unit_bits VRAM bits (8, 4 or 2, so a
+    // unit spans at most four output rows) looks up its lit rows in area_table:
+    // four weights, summing to 255 per output row, for the rows from area_row.
+    std::vector<uint8_t> area_column;
+    std::vector<uint16_t> area_weight0, area_weight1;
+    int area_unit_bits = 8;
+    std::vector<uint8_t> area_row;
+    std::vector<uint32_t> area_blocks;  // Bit i: the unit reaches output rows 8i - 8i + 7
+    std::vector<uint64_t> area_table;   // [unit << area_unit_bits | bits], 16 bits per output row
+};
+
+/**
+* @param width Output width, 32 - 224 (at most 8 source columns per output).
+* @param height Output height, 32 - 256.
+* @return false if the size is out of range.
+*/
+bool initObservationResizer(ObservationResizer* resizer, int width, int height);
+
+/**
+* Max-pool resize: a pixel is lit if any source pixel it covers is.
+*/
+void resizeScreenMax(const ObservationResizer* resizer, const uint8_t* vram, uint8_t* out);
+
+/**
+* Area-average resize: each pixel is the lit fraction of the source
+* area it covers, like OpenCV's INTER_AREA.
+*/
+void resizeScreenArea(const ObservationResizer* resizer, const uint8_t* vram, uint8_t* out);
+void resizeScreenArea(const ObservationResizer* resizer, const uint8_t* vram, float* out);
+
+/**
+* Shifts a stack of {depth} frames of {frame_bytes} one slot towards the
+* front and copies {frame} into the last slot, so stack[depth - 1] is
+* always the newest frame.
+*/
+void pushFrameStack(void* stack, size_t frame_bytes, int depth, const void* frame);
+
+#endif
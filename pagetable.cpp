@@ -0,0 +1,98 @@
+#include "pagetable.h"
+#include "debugger.h"
+#include <cstring>
+
+static uint8_t unmappedRead(State8080* cpu, uint16_t addr) {
+    cpu->pages.unmapped_reads++;
+    return 0xFF;
+}
+
+static void unmappedWrite(State8080* cpu, uint16_t addr, uint8_t value) {
+    cpu->pages.unmapped_writes++;
+}
+
+void fetchOpcodeSlow(State8080* cpu, uint8_t* code) {
+    // Not readByte: a fetch is not a data read, so it skips the profiler's
+    // read counts, and a read-watched page fetches through what the
+    // debugger saved instead of its watch handler
+    const Debugger* debugger = cpu->debugger;
+    for (int i = 0; i < 3; i++) {
+        uint16_t addr = (uint16_t)(cpu->pc + i);
+        int page = addr >> PAGE_SHIFT;
+        const uint8_t* direct = cpu->pages.read[page];
+        PageReadHandler handler = cpu->pages.read_handler[page];
+        if (debugger && debugger->watched[page]) {
+            direct = debugger->saved_read[page];
+            handler = debugger->saved_read_handler[page];
+        }
+        code[i] = direct ? direct[addr & (PAGE_SIZE - 1)] : handler(cpu, addr);
+    }
+    code[3] = 0;
+}
+
+/**
+* Refreshes the guard copy of the first bytes of memory. The map calls
+* run after loadROM, so the guard matches the ROM it mirrors.
+*/
+static void syncGuardBytes(State8080* cpu) {
+    memcpy(cpu->memory + ADDRESS_SPACE_SIZE, cpu->memory, MEMORY_GUARD_SIZE);
+}
+
+void mapPages(State8080* cpu, int first_page, int count, uint8_t* base, bool writable) {
+    for (int i = 0; i < count; i++) {
+        int page = first_page + i;
+        cpu->pages.read[page] = base + i * PAGE_SIZE;
+        cpu->pages.write[page] = writable ? base + i * PAGE_SIZE : nullptr;
+        cpu->pages.read_handler[page] = unmappedRead;
+        cpu->pages.write_handler[page] = unmappedWrite;
+    }
+}
+
+void unmapPages(State8080* cpu, int first_page, int count) {
+    for (int i = first_page; i < first_page + count; i++) {
+        cpu->pages.read[i] = nullptr;
+        cpu->pages.write[i] = nullptr;
+        cpu->pages.read_handler[i] = unmappedRead;
+        cpu->pages.write_handler[i] = unmappedWrite;
+    }
+}
+
+int consumeDirtyScanlines(State8080* cpu, uint8_t* lines) {
+    uint8_t* vram_lines = cpu->pages.dirty_lines + (VRAM_START >> DIRTY_LINE_SHIFT);
+    int count = 0;
+    for (int i = 0; i < VRAM_DIRTY_BYTES; i++) {
+        uint8_t bits = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t dirty = vram_lines[i * 8 + bit] != 0;
+            bits |= dirty << bit;
+            count += dirty;
+        }
+        lines[i] = bits;
+    }
+    memset(vram_lines, 0, VRAM_LINES);
+    return count;
+}
+
+void markAllScanlinesDirty(State8080* cpu) {
+    memset(cpu->pages.dirty_lines, 1, DIRTY_LINE_COUNT);
+}
+
+void mapFlatMemory(State8080* cpu) {
+    mapPages(cpu, 0, PAGE_COUNT, cpu->memory, true);
+    cpu->pages.unmapped_reads = 0;
+    cpu->pages.unmapped_writes = 0;
+    markAllScanlinesDirty(cpu);
+    syncGuardBytes(cpu);
+}
+
+void mapSpaceInvadersMemory(State8080* cpu) {
+    const int mirror_pages = (ADDRESS_DECODE_MASK + 1) >> PAGE_SHIFT;
+    for (int first = 0; first < PAGE_COUNT; first += mirror_pages) {
+        mapPages(cpu, first + (ROM_START >> PAGE_SHIFT), ROM_SIZE >> PAGE_SHIFT, cpu->memory + ROM_START, false);
+        mapPages(cpu, first + (RAM_START >> PAGE_SHIFT), RAM_SIZE >> PAGE_SHIFT, cpu->memory + RAM_START, true);
+    }
+    cpu->pages.unmapped_reads = 0;
+    cpu->pages.unmapped_writes = 0;
+    markAllScanlinesDirty(cpu);
+    syncGuardBytes(cpu);
+}
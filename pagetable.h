@@ -0,0 +1,170 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include "initcpu.h"
+#include <cstdint>
+#include <cstring>
+#ifdef PROFILE_MEMORY
+    #include "memprofile.h"
+    #define PROFILE_ACCESS(cpu, kind, addr) if ((cpu)->pages.profile) (cpu)->pages.profile->kind[addr]++
+#else
+    #define PROFILE_ACCESS(cpu, kind, addr)
+#endif
+
+#define ROM_START 0x0000
+#define ROM_SIZE 0x2000
+#define RAM_START 0x2000
+#define RAM_SIZE 0x2000
+#define ADDRESS_DECODE_MASK 0x3FFF // The board ignores A14 and A15
+#define VRAM_START 0x2400
+#define VRAM_LINES 224 // 32 byte columns, each one rotated scanline
+#define VRAM_DIRTY_BYTES (VRAM_LINES / 8)
+
+/*
+ * Every CPU memory access goes through a 256 entry page table. A page
+ * with a read (or write) pointer is plain memory and costs one extra
+ * load; a null pointer calls the page's handler instead, which is how
+ * ROM write protection, unmapped space and any future memory-mapped
+ * device are handled without a branch chain on every access.
+ *
+ * Direct stores also flag the 32 byte line of cpu->memory they land in
+ * (a plain byte store, no read-modify-write), so frontends can redraw
+ * only the VRAM scanlines that changed.
+ */
+
+/**
+* Reads the byte at {addr} through the page table.
+*
+* @param cpu Pointer to a State8080 struct.
+* @param addr 16-bit CPU address.
+* @return the byte at {addr}.
+*/
+inline uint8_t readByte(State8080* cpu, uint16_t addr) {
+    PROFILE_ACCESS(cpu, reads, addr);
+    const uint8_t* page = cpu->pages.read[addr >> PAGE_SHIFT];
+    if (page) {
+        return page[addr & (PAGE_SIZE - 1)];
+    }
+    return cpu->pages.read_handler[addr >> PAGE_SHIFT](cpu, addr);
+}
+
+/**
+* Stores {value} at {target} inside cpu->memory and marks its line
+* dirty. The direct store path of writeByte, shared with page handlers
+* that end up writing to memory after all.
+*/
+inline void storeDirect(State8080* cpu, uint8_t* target, uint8_t value) {
+    *target = value;
+    uintptr_t line = ((uintptr_t)target - (uintptr_t)cpu->memory) >> DIRTY_LINE_SHIFT;
+    cpu->pages.dirty_lines[line & (DIRTY_LINE_COUNT - 1)] = 1;
+}
+
+/**
+* Writes {value} to {addr} through the page table and marks the
+* 32 byte line it lands in as dirty.
+*
+* @param cpu Pointer to a State8080 struct.
+* @param addr 16-bit CPU address.
+* @param value Byte to store.
+*/
+inline void writeByte(State8080* cpu, uint16_t addr, uint8_t value) {
+    PROFILE_ACCESS(cpu, writes, addr);
+    uint8_t* page = cpu->pages.write[addr >> PAGE_SHIFT];
+    if (page) {
+        storeDirect(cpu, page + (addr & (PAGE_SIZE - 1)), value);
+        return;
+    }
+    cpu->pages.write_handler[addr >> PAGE_SHIFT](cpu, addr, value);
+}
+
+/**
+* Reads {addr} for a debugger or report: no handler side effects (handler
+* pages read as 0xFF) and never counted by the profiler.
+*/
+inline uint8_t peekByte(const State8080* cpu, uint16_t addr) {
+    const uint8_t* page = cpu->pages.read[addr >> PAGE_SHIFT];
+    return page ? page[addr & (PAGE_SIZE - 1)] : 0xFF;
+}
+
+// Out of line so the rare page-straddling fetch does not bloat Emulate8080Op
+void fetchOpcodeSlow(State8080* cpu, uint8_t* code);
+
+/**
+* Copies the opcode and the bytes after it into {code} with one
+* unaligned 32-bit load. The fourth byte is never used by an 8080
+* instruction and may run one byte past the page, which the guard bytes
+* after 0xFFFF keep inside the buffer. An instruction that straddles a
+* page boundary or sits in a handler page is read byte by byte, so it
+* wraps from 0xFFFF to 0x0000. Pages the debugger watches fetch through
+* their saved mapping, so executing there never trips a read watchpoint.
+*
+* @param cpu Pointer to a State8080 struct.
+* @param code 4 bytes.
+*/
+inline void fetchOpcode(State8080* cpu, uint8_t* code) {
+    PROFILE_ACCESS(cpu, executes, cpu->pc);
+    if (cpu->pages.coverage) {
+        cpu->pages.coverage[cpu->pc >> 3] |= 1 << (cpu->pc & 7);
+    }
+    const uint8_t* page = cpu->pages.read[cpu->pc >> PAGE_SHIFT];
+    uint8_t offset = cpu->pc & (PAGE_SIZE - 1);
+    if (page && offset <= PAGE_SIZE - 3) {
+        memcpy(code, page + offset, 4);
+        return;
+    }
+    fetchOpcodeSlow(cpu, code);
+}
+
+/**
+* Maps {count} pages starting at {first_page} onto {base}, which must hold
+* count * PAGE_SIZE bytes plus one readable byte after them. Read-only pages get the counting write handler.
+*
+* @param cpu Pointer to a State8080 struct.
+* @param first_page Address >> PAGE_SHIFT of the first page.
+* @param count Number of pages.
+* @param base Host memory backing the first page.
+* @param writable false to discard (and count) stores.
+*/
+void mapPages(State8080* cpu, int first_page, int count, uint8_t* base, bool writable);
+
+/**
+* Unmaps {count} pages: reads return 0xFF and stores are discarded, both
+* counted in cpu->pages.
+*/
+void unmapPages(State8080* cpu, int first_page, int count);
+
+/**
+* Copies the VRAM dirty-scanline bitmap into {lines} and clears it.
+* Scanline i (VRAM bytes 0x2400 + 32 * i ..) is dirty if bit i & 7 of
+* lines[i >> 3] is set.
+*
+* @param cpu Pointer to a State8080 struct.
+* @param lines VRAM_DIRTY_BYTES bytes.
+* @return number of dirty scanlines.
+*/
+int consumeDirtyScanlines(State8080* cpu, uint8_t* lines);
+
+/**
+* Marks every scanline dirty, e.g. after memory was replaced without
+* going through writeByte (snapshot restore, ROM load, a new frontend).
+*/
+void markAllScanlinesDirty(State8080* cpu);
+
+/**
+* Flat 64 KB read/write map over cpu->memory. Set by initCPU, which is
+* what a bare 8080 (and the unit tests) expect.
+*
+* @param cpu Pointer to a State8080 struct.
+*/
+void mapFlatMemory(State8080* cpu);
+
+/**
+* Space Invaders board map: 8 KB of write-protected ROM at 0x0000 and
+* 8 KB of RAM at 0x2000, both repeated every 16 KB up to 0xFFFF because
+* only A0 - A13 are decoded. Call after loadROM.
+*
+* @param cpu Pointer to a State8080 struct.
+*/
+void mapSpaceInvadersMemory(State8080* cpu);
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * Beam search over port 1 input sequences that maximizes the player one
+ * score. Every candidate is expanded from an in-memory snapshot of its
+ * parent instead of being replayed from reset, and expansions run on
+ * all cores, so this doubles as a snapshot/restore + frame stepping
+ * throughput benchmark.
+ *
+ * ./SpaceInvadersSearch ./path/to/invaders [--depth D] [--beam W] [--step-frames S] [--threads T] [--out file]
+ *
+ * The best sequence is written in the headless runner's input format:
+ *
+ * ./SpaceInvadersHeadless ./path/to/invaders --inputs file --frames N
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+
+#include "loadrom.h"
+#include "machine.h"
+#include "snapshot.h"
+#include "pagetable.h"
+
+static const uint8_t MOVES[] = {
+    0, INPUT_P1_FIRE, INPUT_P1_LEFT, INPUT_P1_RIGHT,
+    INPUT_P1_LEFT | INPUT_P1_FIRE, INPUT_P1_RIGHT | INPUT_P1_FIRE
+};
+#define MOVE_COUNT (sizeof(MOVES) / sizeof(MOVES[0]))
+
+struct SearchOptions {
+    const char* rom_path = nullptr;
+    const char* out_path = "best_inputs.txt";
+    int depth = 100;
+    int beam = 32;
+    int step_frames = 8;
+    int threads = 0;
+};
+
+/**
+* One beam entry. {parent} and {move} index the previous depth so the
+* winning input sequence can be rebuilt at the end.
+*/
+struct SearchNode {
+    Snapshot8080 snap;
+    uint32_t score;
+    uint8_t ships;
+    uint32_t hash;
+    uint32_t parent;
+    uint8_t move;
+};
+
+static bool betterNode(const SearchNode* x, const SearchNode* y) {
+    if (x->score != y->score) return x->score > y->score;
+    if (x->ships != y->ships) return x->ships > y->ships;
+    return x->hash < y->hash;
+}
+
+static void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " <rom> [--depth D] [--beam W] [--step-frames S] [--threads T] [--out file]\n";
+}
+
+/**
+   Entry point for the input-sequence search tool.
+
+   @param argc - argument count
+   @param argv - argument vector (expects the ROM file path as argv[1])
+   @return 0 on success, 1 on failure
+*/
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    SearchOptions opt;
+    opt.rom_path = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--depth") && has_value) opt.depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--beam") && has_value) opt.beam = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--step-frames") && has_value) opt.step_frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && has_value) opt.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--out") && has_value) opt.out_path = argv[++i];
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.threads <= 0) {
+        opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (opt.depth <= 0 || opt.beam <= 0 || opt.step_frames <= 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // One machine per thread; snapshots move between them freely
+    std::vector<State8080> machines(opt.threads);
+    for (State8080& machine : machines) {
+        initCPU(&machine);
+        loadROM(opt.rom_path, &machine, 0);
+        mapSpaceInvadersMemory(&machine);
+        *machine.ports.port1 = INPUT_ALWAYS_SET;
+    }
+
+    std::vector<InputChange> startup;
+    addAutostart(startup);
+    playInputs(&machines[0], startup, 0, AUTOSTART_FRAMES);
+
+    std::vector<SearchNode> beam(1);
+    saveSnapshot(&machines[0], &beam[0].snap);
+    beam[0].score = readScore(&machines[0]);
+    beam[0].ships = machines[0].memory[SHIPS_P1_ADDRESS];
+    beam[0].hash = hashState(&machines[0]);
+
+    // history[d][i] = (parent, move) of entry i of the beam after depth d
+    std::vector<std::vector<std::pair<uint32_t, uint8_t>>> history;
+    std::vector<SearchNode> candidates;
+    uint64_t restores = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int depth = 0; depth < opt.depth; ++depth) {
+        size_t total = beam.size() * MOVE_COUNT;
+        candidates.resize(total);
+        std::atomic<size_t> next(0);
+
+        auto expand = [&](State8080* machine) {
+            size_t i;
+            while ((i = next.fetch_add(1)) < total) {
+                const SearchNode& parent = beam[i / MOVE_COUNT];
+                SearchNode& node = candidates[i];
+                restoreSnapshot(machine, &parent.snap);
+                node.move = (uint8_t)(i % MOVE_COUNT);
+                node.parent = (uint32_t)(i / MOVE_COUNT);
+                *machine->ports.port1 = MOVES[node.move] | INPUT_ALWAYS_SET;
+                for (int f = 0; f < opt.step_frames; ++f) {
+                    runFrame(machine);
+                }
+                saveSnapshot(machine, &node.snap);
+                node.score = readScore(machine);
+                node.ships = machine->memory[SHIPS_P1_ADDRESS];
+                node.hash = hashState(machine);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int t = 1; t < opt.threads; ++t) {
+            workers.emplace_back(expand, &machines[t]);
+        }
+        expand(&machines[0]);
+        for (std::thread& w : workers) {
+            w.join();
+        }
+        restores += total;
+
+        // Rank, drop candidates that converged to the same state, keep the top W
+        std::vector<SearchNode*> order(total);
+        for (size_t i = 0; i < total; i++) {
+            order[i] = &candidates[i];
+        }
+        std::sort(order.begin(), order.end(), betterNode);
+
+        std::vector<SearchNode> next_beam;
+        std::unordered_set<uint32_t> seen;
+        for (SearchNode* node : order) {
+            if ((int)next_beam.size() == opt.beam) break;
+            if (seen.insert(node->hash).second) {
+                next_beam.push_back(*node);
+            }
+        }
+
+        history.emplace_back();
+        for (const SearchNode& node : next_beam) {
+            history.back().emplace_back(node.parent, node.move);
+        }
+        beam.swap(next_beam);
+
+        printf("depth %3d  best score %4u  ships %u  beam %zu\n", depth + 1, beam[0].score, beam[0].ships, beam.size());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Walk back from the best entry to recover its moves
+    std::vector<uint8_t> moves(opt.depth);
+    uint32_t index = 0;
+    for (int depth = opt.depth - 1; depth >= 0; --depth) {
+        moves[depth] = history[depth][index].second;
+        index = history[depth][index].first;
+    }
+
+    std::ofstream out(opt.out_path);
+    if (!out) {
+        std::cerr << "Failed to open output file " << opt.out_path << std::endl;
+        return 1;
+    }
+    char line[32];
+    for (const InputChange& change : startup) {
+        snprintf(line, sizeof(line), "%u %02x\n", change.frame, change.port1);
+        out << line;
+    }
+    for (int depth = 0; depth < opt.depth; ++depth) {
+        snprintf(line, sizeof(line), "%u %02x\n", AUTOSTART_FRAMES + depth * opt.step_frames, MOVES[moves[depth]]);
+        out << line;
+    }
+
+    uint64_t frames = restores * opt.step_frames;
+    printf("best score %u after %d frames, inputs written to %s\n",
+        beam[0].score, AUTOSTART_FRAMES + opt.depth * opt.step_frames, opt.out_path);
+    printf("%d threads: %llu restores (%.0f/s), %llu frames (%.0f/s), %.2f s\n",
+        opt.threads, (unsigned long long)restores, restores / seconds,
+        (unsigned long long)frames, frames / seconds, seconds);
+    return 0;
+}
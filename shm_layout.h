@@ -0,0 +1,234 @@
+#ifndef SHM_LAYOUT_H
+#define SHM_LAYOUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Layout of the /SpaceInvaders shared memory block between the emulator
+ * and the Qt UI.
+ *
+ * The block starts with a ShmHeader: a magic, a version and a table of
+ * regions (offset and size by ShmRegionId). Neither side hardcodes an
+ * offset; both look regions up in the table and check them against the
+ * mapped size (validateShmHeader, shmRegion). The UI creates the block
+ * and writes the header (initShmHeader); the emulator validates it in
+ * init_mmap and refuses a block it does not understand instead of
+ * corrupting it.
+ *
+ * Adding a channel means adding a region id and bumping
+ * SHM_VERSION_MINOR. A side that does not know the new id ignores it,
+ * and a side that needs a region the other did not create gets a null
+ * region and goes without. Only changes that break existing regions
+ * bump SHM_VERSION_MAJOR, which both sides must match.
+ *
+ * Header only, with no emulator dependencies, so the UI includes it too.
+ */
+
+#define SHM_MAGIC "SISHMEM1"
+#define SHM_VERSION_MAJOR 1
+#define SHM_VERSION_MINOR 0
+#define SHM_MAX_REGIONS 16
+#define SHM_HEADER_SIZE 0x1000      // regions start on their own page
+
+// The emulator's memory block (initcpu.h): address space, 16 guard bytes, ports
+#define SHM_MEMORY_SIZE 0x10018
+#define SHM_VRAM_OFFSET 0x2400      // in the memory block
+#define SHM_VRAM_SIZE 0x1C00
+#define SHM_PORTS_OFFSET 0x10010    // in the memory block
+#define SHM_PORTS_SIZE 8
+
+#define SHM_INPUT_RING_SIZE 64
+
+enum ShmRegionId : uint32_t {
+    SHM_REGION_MEMORY,          // the 8080's memory block, see initcpu.h
+    SHM_REGION_VRAM,            // inside MEMORY: 1 bit per pixel, rotated
+    SHM_REGION_PORTS,           // inside MEMORY: port latches 0 - 6
+    SHM_REGION_FRAMEBUFFER,     // reserved for a decoded frame; not created yet
+    SHM_REGION_STATS,           // ShmStats
+    SHM_REGION_INPUT_RING,      // ShmInputRing, UI -> emulator
+    SHM_REGION_COUNT
+};
+
+struct ShmRegion {
+    uint32_t offset;    // from the start of the block; 0 with size 0 if absent
+    uint32_t size;
+};
+
+struct ShmHeader {
+    char magic[8];
+    uint16_t version_major;
+    uint16_t version_minor;
+    uint32_t header_size;
+    uint32_t total_size;        // bytes the creator mapped
+    uint32_t region_count;      // entries of {regions} in use
+    ShmRegion regions[SHM_MAX_REGIONS];
+};
+static_assert(sizeof(ShmHeader) <= SHM_HEADER_SIZE, "ShmHeader must fit its page");
+
+/**
+* Written by the emulator after each frame.
+*/
+struct ShmStats {
+    std::atomic<uint32_t> frames;       // emulated frames so far
+    std::atomic<uint32_t> cycles;       // cpu->cycles after the last one
+};
+
+/**
+* One input change, as the emulator's InputEvent (input.h). {host_ns} is
+* std::chrono::steady_clock, which both processes share.
+*/
+struct ShmInputRecord {
+    uint64_t host_ns;
+    uint8_t port;
+    uint8_t mask;
+    uint8_t value;
+    uint8_t reserved[5];
+};
+
+/**
+* Single producer (UI), single consumer (emulator) ring. The indices
+* count records and wrap at 2^32.
+*/
+struct ShmInputRing {
+    alignas(64) std::atomic<uint32_t> head;     // next record to pop, written by the emulator
+    alignas(64) std::atomic<uint32_t> tail;     // next record to push, written by the UI
+    uint32_t dropped;                           // written by the UI: ring was full
+    ShmInputRecord records[SHM_INPUT_RING_SIZE];
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared atomics must be lock free");
+static_assert(sizeof(ShmInputRecord) == 16, "ShmInputRecord is shared between processes");
+
+/**
+* Creator side: writes the header for a zeroed block of shmBlockSize()
+* bytes. Regions start on 64 byte boundaries.
+*/
+inline void initShmHeader(void* block) {
+    ShmHeader* header = (ShmHeader*)block;
+    memset(header, 0, sizeof(ShmHeader));
+    memcpy(header->magic, SHM_MAGIC, sizeof(header->magic));
+    header->version_major = SHM_VERSION_MAJOR;
+    header->version_minor = SHM_VERSION_MINOR;
+    header->header_size = SHM_HEADER_SIZE;
+    header->region_count = SHM_REGION_COUNT;
+
+    uint32_t at = SHM_HEADER_SIZE;
+    auto place = [&](ShmRegionId id, uint32_t size) {
+        header->regions[id] = ShmRegion{ at, size };
+        at += (size + 63) & ~63u;
+    };
+    place(SHM_REGION_MEMORY, SHM_MEMORY_SIZE);
+    header->regions[SHM_REGION_VRAM] = ShmRegion{ SHM_HEADER_SIZE + SHM_VRAM_OFFSET, SHM_VRAM_SIZE };
+    header->regions[SHM_REGION_PORTS] = ShmRegion{ SHM_HEADER_SIZE + SHM_PORTS_OFFSET, SHM_PORTS_SIZE };
+    place(SHM_REGION_STATS, sizeof(ShmStats));
+    place(SHM_REGION_INPUT_RING, sizeof(ShmInputRing));
+    header->total_size = at;
+}
+
+/**
+* Size of the block initShmHeader lays out.
+*/
+inline uint32_t shmBlockSize() {
+    ShmHeader header;
+    initShmHeader(&header);
+    return header.total_size;
+}
+
+enum ShmStatus {
+    SHM_OK,
+    SHM_TOO_SMALL,      // smaller than a header, or than the header says
+    SHM_BAD_MAGIC,      // not written by initShmHeader, e.g. an old unversioned block
+    SHM_BAD_VERSION,    // different SHM_VERSION_MAJOR
+    SHM_BAD_REGION      // a region lies outside the block or over the header
+};
+
+inline const char* shmStatusText(ShmStatus status) {
+    switch (status) {
+        case SHM_OK:            return "ok";
+        case SHM_TOO_SMALL:     return "block is smaller than its header says";
+        case SHM_BAD_MAGIC:     return "no layout header (built before versioning?)";
+        case SHM_BAD_VERSION:   return "incompatible layout version";
+        case SHM_BAD_REGION:    return "region out of bounds";
+        default:                return "unknown";
+    }
+}
+
+/**
+* Checks {header} against the {mapped} bytes behind it. Both sides call
+* this before using any region.
+*/
+inline ShmStatus validateShmHeader(const ShmHeader* header, size_t mapped) {
+    if (mapped < sizeof(ShmHeader)) {
+        return SHM_TOO_SMALL;
+    }
+    if (memcmp(header->magic, SHM_MAGIC, sizeof(header->magic)) != 0) {
+        return SHM_BAD_MAGIC;
+    }
+    if (header->version_major != SHM_VERSION_MAJOR) {
+        return SHM_BAD_VERSION;
+    }
+    if (header->total_size > mapped || header->header_size < sizeof(ShmHeader)
+        || header->header_size > header->total_size || header->region_count > SHM_MAX_REGIONS) {
+        return SHM_TOO_SMALL;
+    }
+    for (uint32_t i = 0; i < header->region_count; i++) {
+        const ShmRegion& region = header->regions[i];
+        if (region.size && (region.offset < header->header_size
+            || (uint64_t)region.offset + region.size > header->total_size)) {
+            return SHM_BAD_REGION;
+        }
+    }
+    return SHM_OK;
+}
+
+/**
+* Looks up region {id} of a validated block.
+*
+* @param min_size Smallest size the caller can use.
+* @return nullptr if the creator did not provide it, or made it smaller.
+*/
+inline void* shmRegion(ShmHeader* header, ShmRegionId id, uint32_t min_size) {
+    if (id >= header->region_count) {
+        return nullptr;
+    }
+    const ShmRegion& region = header->regions[id];
+    if (region.size == 0 || region.size < min_size) {
+        return nullptr;
+    }
+    return (uint8_t*)header + region.offset;
+}
+
+/**
+* UI side.
+*
+* @return false, counted in ring->dropped, if the ring is full.
+*/
+inline bool pushShmInput(ShmInputRing* ring, const ShmInputRecord& record) {
+    uint32_t at = ring->tail.load(std::memory_order_relaxed);
+    if (at - ring->head.load(std::memory_order_acquire) == SHM_INPUT_RING_SIZE) {
+        ring->dropped++;
+        return false;
+    }
+    ring->records[at % SHM_INPUT_RING_SIZE] = record;
+    ring->tail.store(at + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+* Emulator side.
+*
+* @return false if the ring is empty.
+*/
+inline bool popShmInput(ShmInputRing* ring, ShmInputRecord* record) {
+    uint32_t at = ring->head.load(std::memory_order_relaxed);
+    if (at == ring->tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    *record = ring->records[at % SHM_INPUT_RING_SIZE];
+    ring->head.store(at + 1, std::memory_order_release);
+    return true;
+}
+
+#endif
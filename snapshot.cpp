@@ -0,0 +1,59 @@
+#include "snapshot.h"
+#include "pagetable.h"
+#include <cstring>
+
+void saveSnapshot(const State8080* state, Snapshot8080* snap) {
+    snap->a = state->a;
+    snap->b = state->b;
+    snap->c = state->c;
+    snap->d = state->d;
+    snap->e = state->e;
+    snap->h = state->h;
+    snap->l = state->l;
+    snap->sp = state->sp;
+    snap->pc = state->pc;
+    snap->cycles = state->cycles;
+    snap->int_enable = state->int_enable;
+    snap->interrupt_enabled = state->interrupt_enabled;
+    snap->halted = state->halted;
+    snap->flags = state->flags;
+    snap->shift_registers = state->shift_registers;
+    snap->sound_latches = state->sound_latches;
+
+    uint8_t* const ports[SNAPSHOT_PORT_COUNT] = { state->ports.port0, state->ports.port1, state->ports.port2,
+        state->ports.port3, state->ports.port4, state->ports.port5, state->ports.port6 };
+    for (int i = 0; i < SNAPSHOT_PORT_COUNT; i++) {
+        snap->ports[i] = *ports[i];
+    }
+
+    memcpy(snap->ram, state->memory + SNAPSHOT_RAM_START, SNAPSHOT_RAM_SIZE);
+}
+
+void restoreSnapshot(State8080* state, const Snapshot8080* snap) {
+    state->a = snap->a;
+    state->b = snap->b;
+    state->c = snap->c;
+    state->d = snap->d;
+    state->e = snap->e;
+    state->h = snap->h;
+    state->l = snap->l;
+    state->sp = snap->sp;
+    state->pc = snap->pc;
+    state->cycles = snap->cycles;
+    state->int_enable = snap->int_enable;
+    state->interrupt_enabled = snap->interrupt_enabled;
+    state->halted = snap->halted;
+    state->frame_half = 0;
+    state->flags = snap->flags;
+    state->shift_registers = snap->shift_registers;
+    state->sound_latches = snap->sound_latches;
+
+    uint8_t* const ports[SNAPSHOT_PORT_COUNT] = { state->ports.port0, state->ports.port1, state->ports.port2,
+        state->ports.port3, state->ports.port4, state->ports.port5, state->ports.port6 };
+    for (int i = 0; i < SNAPSHOT_PORT_COUNT; i++) {
+        *ports[i] = snap->ports[i];
+    }
+
+    memcpy(state->memory + SNAPSHOT_RAM_START, snap->ram, SNAPSHOT_RAM_SIZE);
+    markAllScanlinesDirty(state);
+}
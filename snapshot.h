@@ -0,0 +1,50 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "initcpu.h"
+#include <cstdint>
+
+#define SNAPSHOT_RAM_START 0x2000 // Everything below is ROM on the Space Invaders board
+#define SNAPSHOT_RAM_SIZE 0x2000
+#define SNAPSHOT_PORT_COUNT 7
+
+/**
+* In-memory copy of everything needed to resume emulation: registers,
+* flags, shift registers, port latches, the fleet note sequence and the
+* 8 KB of RAM. Restoring one is a single 8 KB memcpy, far cheaper than
+* replaying from reset.
+*/
+struct Snapshot8080 {
+    uint8_t     a, b, c, d, e, h, l;
+    uint16_t    sp;
+    uint16_t    pc;
+    uint32_t    cycles;
+    uint8_t     int_enable;
+    uint8_t     interrupt_enabled;
+    uint8_t     halted;
+    decltype(State8080::flags) flags;
+    decltype(State8080::shift_registers) shift_registers;
+    decltype(State8080::sound_latches) sound_latches;
+    uint8_t     ports[SNAPSHOT_PORT_COUNT];
+    uint8_t     ram[SNAPSHOT_RAM_SIZE];
+};
+
+/**
+* Copies the machine state into {snap}.
+*
+* @param state Pointer to a State8080 struct.
+* @param snap Snapshot to fill.
+*/
+void saveSnapshot(const State8080* state, Snapshot8080* snap);
+
+/**
+* Overwrites the machine state with {snap}. The target keeps its own
+* memory and port buffers, so a snapshot taken on one State8080 can be
+* restored into any other with the same ROM loaded.
+*
+* @param state Pointer to a State8080 struct.
+* @param snap Snapshot to restore.
+*/
+void restoreSnapshot(State8080* state, const Snapshot8080* snap);
+
+#endif
@@ -1,85 +1,369 @@
 #define MINIAUDIO_IMPLEMENTATION
 #include <iostream>
+#include <chrono>
+#include <thread>
+#include "miniaudio.h"
 #include "sound.h"
-ma_engine engine;
-ma_sound sounds[SOUND_COUNT];
+#include "sound_assets.h"
+#include "mixer.h"
+#include "machine.h"
+static ma_device device;
+static bool sound_ready = false; // Headless runs never initialize the device
 
+static SoundEventQueue sound_queue;
+static SoundMixer mixer;
+static SoundSynth synth;
+
+static SoundSink sink = SOUND_SINK_DEVICE;
+static ma_encoder encoder;
+static uint32_t render_cycle = 0;       // cpu->cycles last rendered up to, offline sinks
+static uint64_t render_cycles = 0;      // cycles rendered since attachSound
+static uint64_t render_start = 0;       // mixer.time at attachSound
+static uint32_t audio_hash = 2166136261u;
+
+// Effects decoded on the loader thread, handed to the mixer once done
+static std::thread loader;
+static SoundMixer loaded;
+static std::atomic<bool> samples_decoded{ false };
+static bool samples_adopted = false;    // mixer side: device callback or offline renderer
+static double decode_ms = 0;            // written by the loader before samples_decoded
 
 /**
- * Maps a sound effect to its file path in the sounds directory
- * 
- * @param effect - the sound enum
- * @return const char* - file path string
+ * Swaps the decoded effects into the mixer once the loader has finished
  */
-const char* getFilePath(SoundEffect effect) {
-    switch (effect) {
-        case SOUND_SHOOT:           return "sounds/shoot.wav";
-        case SOUND_INVADER_KILLED:  return "sounds/invaderkilled.wav";
-        case SOUND_FAST_INVADER_1:  return "sounds/fastinvader1.wav";
-        case SOUND_FAST_INVADER_2:  return "sounds/fastinvader2.wav";
-        case SOUND_FAST_INVADER_3:  return "sounds/fastinvader3.wav";
-        case SOUND_FAST_INVADER_4:  return "sounds/fastinvader4.wav";
-        case SOUND_UFO_HIGH:        return "sounds/ufo_highpitch.wav";
-        case SOUND_UFO_LOW:         return "sounds/ufo_lowpitch.wav";
-        case SOUND_EXPLOSION:       return "sounds/explosion.wav";
-        case SOUND_EXTENDED_PLAY:   return "sounds/extendedplay.wav";
-        default:                    return nullptr;
+static void adoptDecodedSamples() {
+    if (!samples_adopted && samples_decoded.load(std::memory_order_acquire)) {
+        adoptMixerSamples(&mixer, &loaded);
+        samples_adopted = true;
     }
 }
 
 /**
- * Initializes the MiniAudio engine and loads all sound effects
- * 
- * @return true if successful, false if initialization or loading fails
+ * Device callback: mixes the next {frames} frames and times itself.
  */
-bool initSoundSystem() {
-    if (ma_engine_init(nullptr, &engine) != MA_SUCCESS) {
-        std::cerr << "Failed to initialize MiniAudio engine.\n";
-        return false;
+static void playbackCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frames) {
+    auto begin = std::chrono::steady_clock::now();
+    mixer.host_ns = soundHostTime();
+    updateSoundRate(&mixer.clock, sound_queue.cycle.load(std::memory_order_relaxed), mixer.time, frames, &mixer.rate);
+    adoptDecodedSamples();
+    mixSound(&mixer, &sound_queue, (float*)pOutput, frames);
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    mixer.callbacks++;
+    mixer.callback_ns_sum += ns;
+    mixer.callback_ns_max = ns > mixer.callback_ns_max ? ns : mixer.callback_ns_max;
+}
+
+void initSoundClock(SoundClock* clock, uint32_t sample_rate, uint32_t period) {
+    clock->sample_rate = sample_rate;
+    clock->latency = (uint64_t)sample_rate * CYCLES_PER_HALF_FRAME * 2 / CPU_CLOCK_HZ + period;
+    clock->anchored = false;
+    clock->offline = false;
+    clock->ratio = 1.0;
+}
+
+/**
+ * Output position of {cycle}, fractional
+ */
+static double clockPosition(const SoundClock* clock, uint32_t cycle) {
+    // Signed distance: the 32 bit counter may wrap, and events may predate the anchor
+    int32_t elapsed = (int32_t)(cycle - clock->anchor_cycle);
+    return clock->anchor_time + (double)elapsed * clock->sample_rate * clock->ratio / CPU_CLOCK_HZ;
+}
+
+/**
+ * Anchors {cycle} to output position {time}
+ */
+static void anchorClock(SoundClock* clock, uint32_t cycle, double time) {
+    clock->anchored = true;
+    clock->anchor_cycle = cycle;
+    clock->anchor_time = time;
+    clock->fill = (double)clock->latency - (double)clock->sample_rate * CYCLES_PER_HALF_FRAME / CPU_CLOCK_HZ;
+}
+
+void updateSoundRate(SoundClock* clock, uint32_t cycle, uint64_t now, uint32_t frames, RateControlStats* stats) {
+    if (clock->offline) {
+        return;
+    }
+    if (!clock->anchored) {
+        anchorClock(clock, cycle, (double)(now + clock->latency));
+        return;
     }
+    double position = clockPosition(clock, cycle);
+    double fill = position - (double)now;
+    if (fill < 0 || fill > 2.0 * clock->latency) {
+        stats->skipped++;
+        return;
+    }
+    double frame = (double)clock->sample_rate * CYCLES_PER_HALF_FRAME * 2 / CPU_CLOCK_HZ;
+    double target = (double)clock->latency - frame / 2;
+    double alpha = frames / (clock->sample_rate * RATE_CONTROL_SMOOTHING_MS / 1000.0);
+    clock->fill += (alpha < 1.0 ? alpha : 1.0) * (fill - clock->fill);
 
+    double correction = -RATE_CONTROL_GAIN * (clock->fill - target) / target;
+    if (correction > RATE_CONTROL_LIMIT || correction < -RATE_CONTROL_LIMIT) {
+        correction = correction > 0 ? RATE_CONTROL_LIMIT : -RATE_CONTROL_LIMIT;
+        stats->limited++;
+    }
+    // Re-base on this cycle so the new ratio only applies from here on
+    clock->anchor_cycle = cycle;
+    clock->anchor_time = position;
+    clock->ratio = 1.0 + correction;
+
+    if (stats->updates == 0) {
+        stats->fill_min = stats->fill_max = clock->fill;
+    }
+    stats->updates++;
+    stats->fill_sum += clock->fill;
+    stats->fill_min = clock->fill < stats->fill_min ? clock->fill : stats->fill_min;
+    stats->fill_max = clock->fill > stats->fill_max ? clock->fill : stats->fill_max;
+    stats->ratio_min = clock->ratio < stats->ratio_min ? clock->ratio : stats->ratio_min;
+    stats->ratio_max = clock->ratio > stats->ratio_max ? clock->ratio : stats->ratio_max;
+}
+
+static uint64_t difference(uint64_t a, uint64_t b) {
+    return a > b ? a - b : b - a;
+}
+
+uint64_t soundEventTime(SoundClock* clock, uint32_t cycle, uint64_t now, SoundTimingStats* stats) {
+    uint64_t time = now + clock->latency;
+    uint64_t ideal = time;
+    if (clock->anchored) {
+        double exact = clockPosition(clock, cycle);
+        ideal = exact > 0 ? (uint64_t)exact : 0;
+        time = ideal;
+        if (!clock->offline && (ideal < now || ideal > now + 2 * clock->latency)) {
+            time = now + clock->latency;
+            clock->anchored = false;
+        }
+        else if ((uint32_t)(cycle - clock->anchor_cycle) >= (1u << 30) && (int32_t)(cycle - clock->anchor_cycle) > 0) {
+            // Move the anchor up before the counter wraps past it
+            clock->anchor_cycle = cycle;
+            clock->anchor_time = exact;
+        }
+    }
+    if (!clock->anchored) {
+        anchorClock(clock, cycle, (double)time);
+        if (stats && stats->events) {
+            stats->reanchors++;
+        }
+    }
+    if (stats) {
+        uint64_t immediate = difference(now + clock->latency, ideal);
+        uint64_t scheduled = difference(time, ideal);
+        stats->events++;
+        stats->immediate_error_sum += immediate;
+        stats->immediate_error_max = immediate > stats->immediate_error_max ? immediate : stats->immediate_error_max;
+        stats->scheduled_error_sum += scheduled;
+        stats->scheduled_error_max = scheduled > stats->scheduled_error_max ? scheduled : stats->scheduled_error_max;
+    }
+    return time;
+}
+
+/**
+ * Loader thread: decodes the embedded sound effects at {rate} and
+ * publishes them for the mixer. On failure the game stays silent.
+ * 
+ * @param rate - output sample rate
+ * @param start - when initSoundSystem was called, for decode_ms
+ */
+static void decodeSamples(uint32_t rate, std::chrono::steady_clock::time_point start) {
+    float* data[SOUND_COUNT] = {};
+    uint32_t lengths[SOUND_COUNT] = {};
+    bool decoded = true;
     for (int i = 0; i < SOUND_COUNT; ++i) {
-        const char* path = getFilePath(static_cast<SoundEffect>(i));
-        if (ma_sound_init_from_file(&engine, path, 0, nullptr, nullptr, &sounds[i]) != MA_SUCCESS) {
-            std::cerr << "Failed to load sound: " << path << "\n";
-            return false;
+        const SoundAsset& asset = SOUND_ASSETS[i];
+        ma_decoder_config decoder = ma_decoder_config_init(ma_format_f32, 1, rate);
+        ma_uint64 frames = 0;
+        void* pcm = nullptr;
+        if (ma_decode_memory(asset.data, asset.size, &decoder, &frames, &pcm) != MA_SUCCESS) {
+            std::cerr << "Failed to decode sound: " << asset.name << "\n";
+            decoded = false;
+            break;
         }
+        data[i] = (float*)pcm;
+        lengths[i] = (uint32_t)frames;
+    }
+    if (decoded) {
+        setMixerSamples(&loaded, data, lengths);
+        decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        samples_decoded.store(true, std::memory_order_release);
     }
+    for (int i = 0; i < SOUND_COUNT; ++i) {
+        ma_free(data[i], nullptr);
+    }
+}
 
-    return true;
+/**
+ * Waits for the loader thread, if one is running
+ */
+static void joinLoader() {
+    if (loader.joinable()) {
+        loader.join();
+    }
 }
 
 /**
- * Plays a sound effect using the MiniAudio engine
+ * Opens the configured sink and sets up the mixer at its rate, with the
+ * synthesizer or the embedded sound effects. The effects are decoded on
+ * a background thread, so this returns without waiting for them.
  * 
- * @param effect - the sound effect to play
+ * @param config - sink, sound source and offline rate
+ * @return true if successful, false if the sink fails to open
  */
-void playSound(SoundEffect effect) {
-    if (effect == SOUND_UFO_HIGH) {
-        ma_sound_start(&sounds[effect]);
-        ma_sound_set_looping(&sounds[effect], MA_TRUE);
-    } else {
-        ma_sound_start(&sounds[effect]);
+bool initSoundSystem(const SoundConfig& config) {
+    auto start = std::chrono::steady_clock::now();
+    sink = config.sink;
+    uint32_t rate = config.sample_rate;
+    uint32_t period = 0;
+    if (sink == SOUND_SINK_DEVICE) {
+        ma_device_config device_config = ma_device_config_init(ma_device_type_playback);
+        device_config.playback.format = ma_format_f32;
+        device_config.playback.channels = 1; // miniaudio spreads mono over the device's channels
+        device_config.dataCallback = playbackCallback;
+        device_config.periodSizeInFrames = config.period_frames;
+        device_config.periods = config.periods;
+        device_config.performanceProfile = ma_performance_profile_low_latency;
+        if (ma_device_init(nullptr, &device_config, &device) != MA_SUCCESS) {
+            std::cerr << "Failed to open audio device.\n";
+            return false;
+        }
+        rate = device.sampleRate;
+        period = device.playback.internalPeriodSizeInFrames;
+        std::cout << "Audio: " << rate << " Hz, " << period << " frame periods x "
+            << device.playback.internalPeriods << " (" << period * 1000.0 / rate << " ms each)\n";
     }
-}
 
+    if (config.synthesize) {
+        initSynth(&synth, rate);
+        mixer.synth = &synth;
+    }
+    initSoundClock(&mixer.clock, rate, period);
+    mixer.clock.offline = sink != SOUND_SINK_DEVICE;
 
+    if (sink == SOUND_SINK_WAV) {
+        ma_encoder_config encoder_config = ma_encoder_config_init(ma_encoding_format_wav, ma_format_s16, 1, rate);
+        if (ma_encoder_init_file(config.wav_path, &encoder_config, &encoder) != MA_SUCCESS) {
+            std::cerr << "Failed to create " << config.wav_path << "\n";
+            return false;
+        }
+    }
+    // Before the device starts: from then on the callback owns samples_adopted
+    samples_decoded.store(config.synthesize, std::memory_order_relaxed);
+    samples_adopted = config.synthesize;
+    decode_ms = 0;
+    if (!config.synthesize) {
+        loader = std::thread(decodeSamples, rate, start);
+    }
+    if (sink == SOUND_SINK_DEVICE && ma_device_start(&device) != MA_SUCCESS) {
+        std::cerr << "Failed to start audio device.\n";
+        joinLoader();
+        ma_device_uninit(&device);
+        return false;
+    }
+    sound_ready = true;
+    return true;
+}
 
-void stopSound(SoundEffect effect) {
-    if (effect == SOUND_UFO_HIGH) {
-        ma_sound_stop(&sounds[effect]);
-        ma_sound_seek_to_pcm_frame(&sounds[effect], 0);
+void attachSound(State8080* cpu) {
+    cpu->sound = sound_ready ? &sound_queue : nullptr;
+    if (sound_ready && sink != SOUND_SINK_DEVICE) {
+        // Offline output must not depend on the loader's progress
+        joinLoader();
+        adoptDecodedSamples();
+        // Offline output starts at this cycle
+        anchorClock(&mixer.clock, cpu->cycles, (double)mixer.time);
+        render_start = mixer.time;
+        render_cycle = cpu->cycles;
+        render_cycles = 0;
     }
 }
 
+void detachSound(State8080* cpu) {
+    cpu->sound = nullptr;
+}
 
+void renderSound(const State8080* cpu) {
+    if (!sound_ready || sink == SOUND_SINK_DEVICE) {
+        return;
+    }
+    static float mixed[1024];
+    static int16_t pcm[1024];
+    render_cycles += (uint32_t)(cpu->cycles - render_cycle);
+    render_cycle = cpu->cycles;
+    uint64_t target = render_start + render_cycles * mixer.clock.sample_rate / CPU_CLOCK_HZ;
+    while (mixer.time < target) {
+        uint32_t frames = target - mixer.time < 1024 ? (uint32_t)(target - mixer.time) : 1024;
+        mixSound(&mixer, &sound_queue, mixed, frames);
+        for (uint32_t i = 0; i < frames; i++) {
+            pcm[i] = (int16_t)(mixed[i] * 32767.0f);
+            // FNV-1a over the little endian samples
+            audio_hash = (audio_hash ^ (uint8_t)pcm[i]) * 16777619u;
+            audio_hash = (audio_hash ^ (uint8_t)((uint16_t)pcm[i] >> 8)) * 16777619u;
+        }
+        if (sink == SOUND_SINK_WAV) {
+            ma_encoder_write_pcm_frames(&encoder, pcm, frames, nullptr);
+        }
+    }
+}
+
+uint32_t soundHash(uint64_t* frames) {
+    if (frames) {
+        *frames = mixer.time;
+    }
+    return audio_hash;
+}
 
 /**
- * Shuts down the MiniAudio engine and releases resources
+ * Stops and closes the sink
  */
 void shutdownSoundSystem() {
-    for (int i = 0; i < SOUND_COUNT; ++i) {
-        ma_sound_uninit(&sounds[i]);
+    if (!sound_ready) {
+        return;
+    }
+    sound_ready = false;
+    if (sink == SOUND_SINK_DEVICE) {
+        ma_device_uninit(&device);
+    }
+    else if (sink == SOUND_SINK_WAV) {
+        ma_encoder_uninit(&encoder);
+    }
+    joinLoader();
+}
+
+bool soundEffectsReady() {
+    return samples_decoded.load(std::memory_order_acquire);
+}
+
+void printSoundStats(std::ostream& out) {
+    if (mixer.synth == nullptr && samples_decoded.load(std::memory_order_acquire)) {
+        out << "Sound effects: decoded in " << decode_ms << " ms in the background\n";
+    }
+    const SoundTimingStats& stats = mixer.timing;
+    if (stats.events == 0) {
+        out << "Sound timing: no events\n";
+        return;
+    }
+    double ms = 1000.0 / mixer.clock.sample_rate;
+    out << "Sound timing: " << stats.events << " events, " << stats.reanchors << " re-anchors, "
+        << mixer.voices_stolen << " voices stolen\n"
+        << "  onset error if started on drain: mean " << ms * stats.immediate_error_sum / stats.events
+        << " ms, max " << ms * stats.immediate_error_max << " ms\n"
+        << "  onset error as scheduled:        mean " << ms * stats.scheduled_error_sum / stats.events
+        << " ms, max " << ms * stats.scheduled_error_max << " ms\n"
+        << "  mixer callback: " << mixer.callbacks << " calls, mean "
+        << (mixer.callbacks ? mixer.callback_ns_sum / mixer.callbacks : 0) << " ns, max " << mixer.callback_ns_max << " ns\n";
+    const RateControlStats& rate = mixer.rate;
+    if (rate.updates) {
+        out << "  rate control: " << rate.updates << " updates, ratio " << mixer.clock.ratio
+            << " (" << rate.ratio_min << " to " << rate.ratio_max << "), " << rate.limited << " at the limit, "
+            << rate.skipped << " skipped\n"
+            << "  buffer fill: mean " << ms * rate.fill_sum / rate.updates << " ms ("
+            << ms * rate.fill_min << " to " << ms * rate.fill_max << ")\n";
+    }
+    const LatencyHistogram* latency = &mixer.latency;
+    if (latency->total) {
+        out << "  OUT to callback latency over " << latency->total << " onsets: p50 "
+            << latencyPercentile(latency, 0.5) / 1e6 << " ms, p90 " << latencyPercentile(latency, 0.9) / 1e6
+            << " ms, p99 " << latencyPercentile(latency, 0.99) / 1e6 << " ms, max " << latency->max_ns / 1e6 << " ms\n";
     }
-    ma_engine_uninit(&engine);
 }
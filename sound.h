@@ -2,7 +2,16 @@
 #define SOUND_H
 
 #include <cstdint>
-#include "miniaudio.h"
+#include <ostream>
+#include <chrono>
+#include <atomic>
+#include "initcpu.h"
+#include "spscqueue.h"
+
+#define SOUND_QUEUE_SIZE 256
+#define RATE_CONTROL_LIMIT 0.005        // largest correction to the cycle to sample ratio
+#define RATE_CONTROL_GAIN 0.01          // correction per unit of relative fill error
+#define RATE_CONTROL_SMOOTHING_MS 2000  // averaging time of the measured fill
 
 enum SoundEffect {
     SOUND_SHOOT,
@@ -18,12 +27,221 @@ enum SoundEffect {
     SOUND_COUNT
 };
 
-extern ma_engine engine;
-extern ma_sound sounds[SOUND_COUNT];
+/*
+ * Sound events.
+ *
+ * The sound latch devices (io_ports.cpp) never call miniaudio. Each edge
+ * on OUT 3 / OUT 5 becomes a SoundEvent stamped with the CPU cycle count
+ * and is pushed into the machine's SoundEventQueue, a bounded lock-free
+ * SPSC ring. The audio device callback pops the events and mixes the
+ * effects (mixer.h), so the emulation thread never waits on the audio
+ * side. Without an attached queue (headless runs, search workers) the
+ * latches post nothing.
+ *
+ * A whole frame is emulated in a burst, so the time an event is drained
+ * says little about when it happened. The mixer instead converts each
+ * event's cycle stamp to an output sample (SoundClock) and starts or
+ * stops the voice there, a fixed latency of about one frame behind the
+ * emulation. Onsets keep their emulated spacing to the sample.
+ * SoundTimingStats compares that against starting sounds on drain.
+ */
+
+struct SoundEvent {
+    uint32_t cycle;     // cpu->cycles when the OUT ran
+    uint8_t effect;     // SoundEffect
+    uint8_t on;         // 1 start, 0 stop
+    uint64_t posted_ns; // host time of the OUT, for latency measurement
+};
+
+struct SoundEventQueue {
+    SpscQueue<SoundEvent, SOUND_QUEUE_SIZE> events;
+    uint32_t dropped = 0;   // events lost to a full ring, written by the CPU thread
+    std::atomic<uint32_t> cycle{ 0 };   // cpu->cycles at the end of the last frame, see publishSoundClock
+};
+
+/*
+ * Maps emulated cycles to output samples. The first event anchors cycle
+ * {anchor_cycle} to sample {anchor_time}; later events are placed by
+ * their cycle distance from it. When the emulation stalls (paused,
+ * debugger) or runs ahead (no frame limiter), the scheduled time leaves
+ * [now, now + 2 * latency] and the clock re-anchors on the current event.
+ *
+ * The emulated 1.9968 MHz clock and the audio device's crystal drift
+ * apart slowly, which would otherwise end in a re-anchor (an audible
+ * jump) every few minutes. Rate control watches the fill: how far the
+ * emulation's published cycle maps ahead of the output. It nudges
+ * {ratio} by at most RATE_CONTROL_LIMIT to hold the fill at its set
+ * point. The emulation publishes once per frame, so the fill is a
+ * sawtooth one frame deep, and the set point is its mean: the latency
+ * less half a frame.
+ */
+struct SoundClock {
+    uint32_t sample_rate = 48000;
+    uint64_t latency = 0;       // samples from drain to onset, set by initSoundClock
+    bool offline = false;       // output is rendered in step with the emulation: never re-anchor
+    bool anchored = false;
+    uint32_t anchor_cycle = 0;
+    double anchor_time = 0;     // fractional, so rate changes do not accumulate rounding
+    double ratio = 1.0;         // rate control correction to sample_rate / CPU_CLOCK_HZ
+    double fill = 0;            // smoothed fill in samples
+};
+
+/*
+ * Rate control telemetry. {limited} counts updates that wanted more than
+ * RATE_CONTROL_LIMIT, i.e. drift the control cannot absorb.
+ */
+struct RateControlStats {
+    uint32_t updates = 0;
+    uint32_t limited = 0;
+    uint32_t skipped = 0;       // emulation stalled or ran ahead; left to re-anchoring
+    double ratio_min = 1.0;
+    double ratio_max = 1.0;
+    double fill_sum = 0;        // samples
+    double fill_min = 0;
+    double fill_max = 0;
+};
+
+/*
+ * Onset error in samples, measured against the emulated timeline: the
+ * ideal onset of an event is its cycle distance from the anchor. "immediate"
+ * is what starting the sound on drain would give (the old behaviour),
+ * "scheduled" is what the clock gives; it is nonzero only on re-anchors.
+ */
+struct SoundTimingStats {
+    uint32_t events = 0;
+    uint32_t reanchors = 0;
+    uint64_t immediate_error_sum = 0;
+    uint64_t immediate_error_max = 0;
+    uint64_t scheduled_error_sum = 0;
+    uint64_t scheduled_error_max = 0;
+};
+
+/**
+* Sets the output rate and a latency of one emulated frame plus one
+* device period, the longest an event can wait to be drained.
+*/
+void initSoundClock(SoundClock* clock, uint32_t sample_rate, uint32_t period);
+
+/**
+* Converts an event's cycle stamp to the output sample it should sound at.
+*
+* @param now Current output position in samples.
+* @param stats Updated with the onset errors; may be null.
+* @return Absolute output sample, never before {now}.
+*/
+uint64_t soundEventTime(SoundClock* clock, uint32_t cycle, uint64_t now, SoundTimingStats* stats);
+
+/**
+* Rate control step, once per output buffer.
+*
+* @param cycle The emulation's last published cycle.
+* @param now Output position of the buffer.
+* @param frames Buffer length, for the smoothing.
+*/
+void updateSoundRate(SoundClock* clock, uint32_t cycle, uint64_t now, uint32_t frames, RateControlStats* stats);
+
+/**
+* Host clock used to stamp events, in nanoseconds.
+*/
+inline uint64_t soundHostTime() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-bool initSoundSystem();
-void playSound(SoundEffect effect);
-void stopSound(SoundEffect effect);
+/**
+* Queues a start or stop of {effect} for the audio callback. Called by the
+* sound latch devices on the CPU thread.
+*/
+inline void postSoundEvent(State8080* cpu, SoundEffect effect, bool on) {
+    SoundEventQueue* queue = cpu->sound;
+    if (queue == nullptr) {
+        return;
+    }
+    if (!queue->events.push(SoundEvent{ cpu->cycles, (uint8_t)effect, (uint8_t)on, soundHostTime() })) {
+        queue->dropped++;
+    }
+}
+
+/*
+ * Where the mixed output goes. The device sink pulls audio in real time
+ * from its callback. The offline sinks need no sound card: renderSound
+ * mixes up to the emulated cycle count after every frame, as fast as the
+ * emulation runs, and hashes the 16 bit samples (soundHash), so headless
+ * runs can check their audio.
+ */
+enum SoundSink : uint8_t {
+    SOUND_SINK_DEVICE,      // live playback through the default device
+    SOUND_SINK_NULL,        // mixed and hashed, then discarded
+    SOUND_SINK_WAV          // mixed, hashed and written to a 16 bit mono WAV
+};
+
+struct SoundConfig {
+    SoundSink sink = SOUND_SINK_DEVICE;
+    bool synthesize = false;        // model the sound board (synth.h); the effects are not decoded
+    const char* wav_path = nullptr; // SOUND_SINK_WAV
+    uint32_t sample_rate = 48000;   // offline sinks; the device picks its own
+
+    // Device sink buffering, 0 for miniaudio's defaults. Latency from an
+    // OUT to the callback is at most about a frame plus one period, and
+    // the device adds up to {periods} more; printSoundStats reports it.
+    uint32_t period_frames = 0;
+    uint32_t periods = 0;
+};
+
+/**
+* Opens the sink and sets up the synthesizer, or starts decoding the
+* embedded effects (sound_assets.h) on a background thread. Returns
+* without waiting for them: the device plays effects once they are
+* ready, offline sinks wait for them in attachSound.
+*/
+bool initSoundSystem(const SoundConfig& config = SoundConfig());
+
+/**
+* @return true once the effects are decoded, or with the synthesizer.
+*/
+bool soundEffectsReady();
+
+/**
+* Sends {cpu}'s sound latch events to the sound system. Does nothing if
+* it failed to initialize.
+*/
+void attachSound(State8080* cpu);
+
+void detachSound(State8080* cpu);
+
+/**
+* Tells the device sink's rate control how far the emulation has got.
+* Call after every frame.
+*/
+inline void publishSoundClock(State8080* cpu) {
+    if (cpu->sound) {
+        cpu->sound->cycle.store(cpu->cycles, std::memory_order_relaxed);
+    }
+}
+
+/**
+* Offline sinks: mixes the output up to {cpu}'s current cycle. Call after
+* every frame. Does nothing for the device sink.
+*/
+void renderSound(const State8080* cpu);
+
+/**
+* FNV-1a of the 16 bit samples an offline sink has rendered.
+*
+* @param frames Set to the number of samples rendered; may be null.
+*/
+uint32_t soundHash(uint64_t* frames = nullptr);
+
+/**
+* Stops the playback device or finishes the WAV. Detach first.
+*/
 void shutdownSoundSystem();
 
+/**
+* Prints onset timing, callback cost and the latency from each OUT edge to
+* the callback that plays its first sample (percentiles). Call after
+* shutdownSoundSystem.
+*/
+void printSoundStats(std::ostream& out);
+
 #endif // SOUND_H
@@ -0,0 +1,25 @@
+#ifndef SOUND_ASSETS_H
+#define SOUND_ASSETS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sound.h"
+
+/*
+ * The sound effect WAVs, compiled in. CMake generates the table from
+ * sounds/ at build time (cmake/EmbedSounds.cmake), so the emulator runs
+ * from any working directory and startup does no file I/O for sound.
+ */
+
+struct SoundAsset {
+    const char* name;       // file name in sounds/
+    const uint8_t* data;    // the whole WAV file
+    size_t size;
+};
+
+/**
+* Indexed by SoundEffect.
+*/
+extern const SoundAsset SOUND_ASSETS[SOUND_COUNT];
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/*
+ * Bounded single producer, single consumer queue. One thread pushes and
+ * one thread pops; neither ever blocks or takes a lock. Each index is
+ * written by one side only and sits on its own cache line, so the two
+ * threads do not invalidate each other's line on every operation.
+ *
+ * {N} must be a power of two. The queue holds up to N items.
+ */
+template <typename T, size_t N>
+struct SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+    T items[N];
+    alignas(64) std::atomic<size_t> head{ 0 };  // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail{ 0 };  // next slot to push, written by the producer
+
+    /**
+    * Producer side.
+    *
+    * @return false if the queue is full; {item} is left untouched.
+    */
+    bool push(T item) {
+        size_t at = tail.load(std::memory_order_relaxed);
+        if (at - head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        items[at & (N - 1)] = std::move(item);
+        tail.store(at + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * Consumer side.
+    *
+    * @return false if the queue is empty.
+    */
+    bool pop(T* item) {
+        size_t at = head.load(std::memory_order_relaxed);
+        if (at == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *item = std::move(items[at & (N - 1)]);
+        head.store(at + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * Either side; exact only on the consumer thread.
+    */
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif
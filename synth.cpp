@@ -0,0 +1,221 @@
+#include "synth.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SYNTH_SSE2
+#endif
+
+#define SYNTH_SILENT 0.0001f // -80 dB: the circuit has decayed away
+
+enum SynthWave : uint8_t {
+    WAVE_SQUARE,
+    WAVE_TRIANGLE,
+    WAVE_NOISE,
+    WAVE_GATED_SQUARE   // square keyed on and off by the modulation
+};
+
+struct CircuitModel {
+    SynthWave wave;
+    float frequency;    // Hz; for noise, the sample-and-hold period in samples (power of two)
+    float depth;        // Hz of frequency swing from the modulation
+    float rate;         // modulation Hz
+    float decay;        // envelope time constant in seconds, 0 to sustain while keyed
+    float gain;
+};
+
+// Indexed by SoundEffect
+static const CircuitModel MODELS[SOUND_COUNT] = {
+    { WAVE_NOISE,        1,    0,   0,  0.15f, 0.35f },   // SOUND_SHOOT
+    { WAVE_NOISE,        2,    0,   0,  0.12f, 0.40f },   // SOUND_INVADER_KILLED
+    { WAVE_TRIANGLE,     62,   0,   0,  0.06f, 0.60f },   // SOUND_FAST_INVADER_1
+    { WAVE_TRIANGLE,     56,   0,   0,  0.06f, 0.60f },   // SOUND_FAST_INVADER_2
+    { WAVE_TRIANGLE,     52,   0,   0,  0.06f, 0.60f },   // SOUND_FAST_INVADER_3
+    { WAVE_TRIANGLE,     46,   0,   0,  0.06f, 0.60f },   // SOUND_FAST_INVADER_4
+    { WAVE_SQUARE,       700,  250, 6,  0.0f,  0.15f },   // SOUND_UFO_HIGH, loops while keyed
+    { WAVE_SQUARE,       600,  400, 9,  0.9f,  0.20f },   // SOUND_UFO_LOW
+    { WAVE_NOISE,        8,    0,   0,  0.6f,  0.50f },   // SOUND_EXPLOSION
+    { WAVE_GATED_SQUARE, 1200, 0,   8,  1.0f,  0.15f }    // SOUND_EXTENDED_PLAY
+};
+
+/**
+* out[i] = square or triangle at {phase} + i * {increment} cycles, for
+* i in [0, count). Advances {phase}.
+*/
+static void oscillatorBlock(float* out, uint32_t count, float* phase, float increment, bool square) {
+    uint32_t i = 0;
+#ifdef SYNTH_SSE2
+    __m128 p = _mm_add_ps(_mm_set1_ps(*phase), _mm_mul_ps(_mm_set1_ps(increment), _mm_set_ps(3, 2, 1, 0)));
+    const __m128 step = _mm_set1_ps(4 * increment);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= count; i += 4) {
+        __m128 frac = _mm_sub_ps(p, _mm_cvtepi32_ps(_mm_cvttps_epi32(p)));  // p >= 0, so truncation is floor
+        __m128 value;
+        if (square) {
+            value = _mm_sub_ps(_mm_and_ps(_mm_cmplt_ps(frac, half), _mm_set1_ps(2.0f)), one);
+        }
+        else {
+            value = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(4.0f), _mm_andnot_ps(sign, _mm_sub_ps(frac, half))), one);
+        }
+        _mm_storeu_ps(out + i, value);
+        p = _mm_add_ps(p, step);
+    }
+#endif
+    for (; i < count; i++) {
+        float p = *phase + i * increment;
+        float frac = p - (float)(int32_t)p;
+        out[i] = square ? (frac < 0.5f ? 1.0f : -1.0f) : 4.0f * std::fabs(frac - 0.5f) - 1.0f;
+    }
+    float end = *phase + count * increment;
+    *phase = end - (float)(int32_t)end;
+}
+
+/**
+* White noise from four interleaved xorshift32 generators, held for
+* {hold} samples (a power of two) to darken it.
+*/
+static void noiseBlock(float* out, uint32_t count, uint32_t* state, uint32_t hold) {
+    const float scale = 1.0f / 2147483648.0f;
+    uint32_t i = 0;
+#ifdef SYNTH_SSE2
+    __m128i x = _mm_loadu_si128((const __m128i*)state);
+    for (; i + 4 <= count; i += 4) {
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(scale)));
+    }
+    _mm_storeu_si128((__m128i*)state, x);
+#endif
+    for (; i < count; i++) {
+        uint32_t& x = state[i & 3];
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        out[i] = (float)(int32_t)x * scale;
+    }
+    for (i = 0; hold > 1 && i < count; i++) {
+        out[i] = out[i & ~(hold - 1)];
+    }
+}
+
+/**
+* out[i] += in[i] * {gain} * {level} * decay^i. Advances {level}.
+*/
+static void envelopeBlock(float* out, const float* in, uint32_t count, float* level, float decay, float gain) {
+    float envelope = *level * gain;
+    uint32_t i = 0;
+#ifdef SYNTH_SSE2
+    __m128 e = _mm_mul_ps(_mm_set1_ps(envelope), _mm_set_ps(decay * decay * decay, decay * decay, decay, 1.0f));
+    const __m128 step = _mm_set1_ps(decay * decay * decay * decay);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), e)));
+        e = _mm_mul_ps(e, step);
+    }
+    envelope = _mm_cvtss_f32(e);
+#endif
+    for (; i < count; i++) {
+        out[i] += in[i] * envelope;
+        envelope *= decay;
+    }
+    *level = envelope / gain;
+}
+
+void initSynth(SoundSynth* synth, uint32_t sample_rate) {
+    synth->sample_rate = sample_rate;
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        synth->circuits[i] = SynthCircuit();
+        synth->decay[i] = MODELS[i].decay > 0 ? std::exp(-1.0f / (MODELS[i].decay * sample_rate)) : 1.0f;
+    }
+}
+
+void triggerSynth(SoundSynth* synth, SoundEffect effect, bool on, uint64_t time) {
+    SynthCircuit& circuit = synth->circuits[effect];
+    if (!on) {
+        // Only the UFO sustains; the rest decay on their own like one-shots
+        if (circuit.active && MODELS[effect].decay == 0) {
+            circuit.stop = time;
+        }
+        return;
+    }
+    if (circuit.active && MODELS[effect].decay == 0 && circuit.start <= time) {
+        circuit.stop = SYNTH_NO_STOP;   // still sounding: keep going
+        return;
+    }
+    if (circuit.active && circuit.start < time) {
+        circuit.restart = time;         // decaying: renderCircuit swaps the onset in when it gets there
+        return;
+    }
+    circuit.active = true;
+    circuit.start = time;
+    circuit.stop = SYNTH_NO_STOP;
+    circuit.restart = SYNTH_NO_STOP;
+    circuit.level = 1.0f;
+}
+
+/**
+* Renders one control block: frames [time, time + count) of {effect}
+* into out[0, count).
+*/
+static void renderCircuit(SoundSynth* synth, SoundEffect effect, float* out, uint32_t count, uint64_t time) {
+    SynthCircuit& circuit = synth->circuits[effect];
+    const CircuitModel& model = MODELS[effect];
+    if (circuit.restart < time + count) {
+        // Re-keyed in this block: the old tail up to the onset, then the new one
+        uint64_t onset = circuit.restart;
+        uint32_t split = onset > time ? (uint32_t)(onset - time) : 0;
+        circuit.restart = SYNTH_NO_STOP;
+        if (split > 0) {
+            renderCircuit(synth, effect, out, split, time);
+        }
+        circuit.active = true;
+        circuit.start = onset;
+        circuit.level = 1.0f;
+        out += split;
+        count -= split;
+        time += split;
+    }
+    uint64_t end = time + count;
+    if (circuit.start >= end) {
+        return;
+    }
+    uint32_t first = circuit.start > time ? (uint32_t)(circuit.start - time) : 0;
+    uint32_t last = circuit.stop < end ? (uint32_t)(circuit.stop > time ? circuit.stop - time : 0) : count;
+    float lfo = circuit.lfo;
+    circuit.lfo += model.rate * count / synth->sample_rate;
+    circuit.lfo -= (float)(int32_t)circuit.lfo;
+    if (first < last) {
+        uint32_t n = last - first;
+        float* wave = synth->scratch;
+        if (model.wave == WAVE_NOISE) {
+            noiseBlock(wave, n, synth->noise, (uint32_t)model.frequency);
+        }
+        else {
+            float triangle = 4.0f * std::fabs(lfo - 0.5f) - 1.0f;
+            float frequency = model.frequency + model.depth * triangle;
+            oscillatorBlock(wave, n, &circuit.phase, frequency / synth->sample_rate, model.wave != WAVE_TRIANGLE);
+            if (model.wave == WAVE_GATED_SQUARE && lfo >= 0.5f) {
+                for (uint32_t i = 0; i < n; i++) {
+                    wave[i] = 0.0f;
+                }
+            }
+        }
+        envelopeBlock(out + first, wave, n, &circuit.level, synth->decay[effect], model.gain);
+    }
+    if ((last < count || circuit.level < SYNTH_SILENT) && circuit.restart == SYNTH_NO_STOP) {
+        circuit.active = false;
+    }
+}
+
+void renderSynth(SoundSynth* synth, float* out, uint32_t frames, uint64_t time) {
+    for (uint32_t done = 0; done < frames; done += SYNTH_CONTROL_FRAMES) {
+        uint32_t count = frames - done < SYNTH_CONTROL_FRAMES ? frames - done : SYNTH_CONTROL_FRAMES;
+        for (int effect = 0; effect < SOUND_COUNT; effect++) {
+            if (synth->circuits[effect].active) {
+                renderCircuit(synth, static_cast<SoundEffect>(effect), out + done, count, time + done);
+            }
+        }
+    }
+}
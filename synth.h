@@ -0,0 +1,62 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include "sound.h"
+#include <cstdint>
+
+#define SYNTH_CONTROL_FRAMES 64 // Modulation is updated once per this many samples
+#define SYNTH_NO_STOP UINT64_MAX
+
+/*
+ * Discrete sound board model.
+ *
+ * The cabinet made its sounds with analog circuits keyed by the port 3
+ * and port 5 latch bits, not with samples. This synthesizes them instead
+ * of playing the WAVs: each SoundEffect is a circuit built from a few
+ * DSP blocks, an oscillator (square or triangle) or a noise source,
+ * slow modulation and an exponential decay. The blocks work on 4 samples
+ * at a time with SSE2, with a scalar fallback, and the state is a few
+ * floats per circuit, so many instances can run at 48 kHz and nothing is
+ * loaded at startup.
+ *
+ * A SoundSynth is driven by the same events as the voice mixer: trigger
+ * it with the output frame of each latch edge, then render. Modulation
+ * runs at control rate, but starts and stops are exact to the sample.
+ * Re-keying a circuit that is still decaying lets the old tail play up
+ * to the new onset.
+ */
+
+struct SynthCircuit {
+    bool active = false;
+    uint64_t start = 0;             // output frame it is keyed on at
+    uint64_t restart = SYNTH_NO_STOP;   // output frame a re-key cuts the current tail off at
+    uint64_t stop = SYNTH_NO_STOP;  // output frame it is keyed off at
+    float level = 0.0f;             // envelope
+    float phase = 0.0f;             // oscillator, in cycles
+    float lfo = 0.0f;               // modulation, in cycles
+};
+
+struct SoundSynth {
+    uint32_t sample_rate = 48000;
+    SynthCircuit circuits[SOUND_COUNT];
+    uint32_t noise[4] = { 0x12345678, 0x9abcdef1, 0x2468ace1, 0x13579bdf };   // xorshift32 per lane
+    float decay[SOUND_COUNT] = {};  // envelope factor per sample
+    float scratch[SYNTH_CONTROL_FRAMES];
+};
+
+/**
+* Precomputes the envelopes for {sample_rate} and silences every circuit.
+*/
+void initSynth(SoundSynth* synth, uint32_t sample_rate);
+
+/**
+* Keys the circuit for {effect} on or off at output frame {time}.
+*/
+void triggerSynth(SoundSynth* synth, SoundEffect effect, bool on, uint64_t time);
+
+/**
+* Adds output frames [time, time + frames) of every active circuit into {out}.
+*/
+void renderSynth(SoundSynth* synth, float* out, uint32_t frames, uint64_t time);
+
+#endif
@@ -1,11 +1,35 @@
 #include "../emulator.h" 
+#include "../pagetable.h"
+#include "../codetracker.h"
+#include "../memprofile.h"
+#include "../coverage.h"
+#include "../debugger.h"
+#include "../gdbstub.h"
+#include "../trace.h"
+#include "../io_ports.h"
+#include "../input.h"
+#include "../access_mmap.h"
+#include "../sound.h"
+#include "../mixer.h"
+#include "../sound_assets.h"
+#include "../machine.h"
+#include "../snapshot.h"
+#include "../trajectory.h"
+#include "../observation.h"
 #include <stdio.h>      
 #include <stdlib.h>     
+#include <stddef.h>
+#include <string.h>
 #include <cassert>      
+#include <cmath>
+
+// Failed checks so far; main's exit code
+static int failed_count = 0;
 
 // Helper function to report errors
 void test_failed(const char* test_name, const char* message) {
     printf("[-] TEST FAILED: %s (%s)\n", test_name, message);
+    failed_count++;
 }
 
 void test_passed(const char* test_name) {
@@ -1477,9 +1501,1352 @@ void test_op_cpi_d8() {
 
 // --- Main Test Runner ---
 
+void test_page_table_map() {
+    const char* test_name = "Page table ROM protection and mirroring";
+    State8080 state;
+    initCPU(&state);
+
+    const uint8_t program[] = {
+        0x3E, 0x42,         // MVI A, 0x42
+        0x32, 0x10, 0x00,   // STA 0x0010 (ROM)
+        0x32, 0x05, 0x60,   // STA 0x6005 (mirror of 0x2005)
+        0xC3, 0xFE, 0x00    // JMP 0x00FE
+    };
+    memcpy(state.memory, program, sizeof(program));
+    const uint8_t straddle[] = { 0x3A, 0x05, 0xA0 }; // LDA 0xA005, crosses into page 0x01
+    memcpy(state.memory + 0x00FE, straddle, sizeof(straddle));
+    mapSpaceInvadersMemory(&state);
+
+    for (int i = 0; i < 4; i++) {
+        Emulate8080Op(&state);
+    }
+    if (state.memory[0x0010] != 0x00 || state.pages.unmapped_writes != 1) {
+        test_failed(test_name, "Store to ROM was not discarded and counted");
+        return;
+    }
+    if (state.memory[0x2005] != 0x42) {
+        test_failed(test_name, "Store to 0x6005 did not reach RAM at 0x2005");
+        return;
+    }
+
+    state.a = 0;
+    Emulate8080Op(&state);
+    if (state.a != 0x42 || state.pc != 0x0101) {
+        test_failed(test_name, "Page-straddling LDA from mirror failed");
+        return;
+    }
+    if (readByte(&state, 0x4000) != 0x3E) {
+        test_failed(test_name, "ROM is not mirrored at 0x4000");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_address_wraparound() {
+    const char* test_name = "16-bit address wraparound";
+    State8080 state;
+    initCPU(&state);
+
+    // LXI B straddling 0xFFFF -> 0x0000, then PUSH B with SP = 0
+    state.memory[0xFFFF] = 0x01;
+    state.memory[0x0000] = 0x34;
+    state.memory[0x0001] = 0x12;
+    state.memory[0x0002] = 0xC5;
+    state.pc = 0xFFFF;
+    state.sp = 0x0000;
+    *state.ports.port1 = 0x5A;
+
+    Emulate8080Op(&state);
+    if (state.b != 0x12 || state.c != 0x34 || state.pc != 0x0002) {
+        test_failed(test_name, "Operand fetch did not wrap to 0x0000");
+        return;
+    }
+    Emulate8080Op(&state);
+    if (state.sp != 0xFFFE || state.memory[0xFFFF] != 0x12 || state.memory[0xFFFE] != 0x34) {
+        test_failed(test_name, "Stack push did not wrap below 0x0000");
+        return;
+    }
+    if (*state.ports.port1 != 0x5A) {
+        test_failed(test_name, "Port byte was overwritten");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_dirty_scanlines() {
+    const char* test_name = "VRAM dirty scanlines";
+    State8080 state;
+    initCPU(&state);
+    mapSpaceInvadersMemory(&state);
+
+    uint8_t lines[VRAM_DIRTY_BYTES];
+    if (consumeDirtyScanlines(&state, lines) != VRAM_LINES || consumeDirtyScanlines(&state, lines) != 0) {
+        test_failed(test_name, "Fresh map should be fully dirty once");
+        return;
+    }
+
+    writeByte(&state, 0x2400 + 5 * 32 + 7, 0xFF);  // scanline 5
+    writeByte(&state, 0x6400 + 200 * 32, 0x01);    // scanline 200 through the mirror
+    writeByte(&state, 0x2000, 0x01);               // work RAM, not VRAM
+    writeByte(&state, 0x0400, 0x01);               // ROM, discarded
+    int count = consumeDirtyScanlines(&state, lines);
+    if (count != 2 || lines[0] != 0x20 || lines[25] != 0x01) {
+        test_failed(test_name, "Wrong scanlines marked dirty");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_snapshot_restore() {
+    const char* test_name = "Snapshot save/restore";
+    // Interrupt handlers count in C and D; the main loop increments VRAM bytes and B
+    const uint8_t program[] = {
+        0x31, 0x00, 0x24,       // 0000 LXI SP,2400
+        0xC3, 0x00, 0x01,       // 0003 JMP 0100
+        0x00, 0x00,
+        0x0C, 0xFB, 0xC9,       // 0008 INR C; EI; RET
+        0x00, 0x00, 0x00, 0x00, 0x00,
+        0x14, 0xFB, 0xC9,       // 0010 INR D; EI; RET
+    };
+    const uint8_t loop[] = {
+        0xFB,                   // 0100 EI
+        0x21, 0x00, 0x24,       // 0101 LXI H,2400
+        0x34,                   // 0104 INR M
+        0x23,                   // 0105 INX H
+        0x7C,                   // 0106 MOV A,H
+        0xFE, 0x40,             // 0107 CPI 40
+        0xC2, 0x04, 0x01,       // 0109 JNZ 0104
+        0x26, 0x24,             // 010C MVI H,24
+        0x04,                   // 010E INR B
+        0xC3, 0x04, 0x01,       // 010F JMP 0104
+    };
+    State8080 state;
+    initCPU(&state);
+    mapSpaceInvadersMemory(&state);
+    memcpy(state.memory, program, sizeof(program));
+    memcpy(state.memory + 0x0100, loop, sizeof(loop));
+    for (int i = 0; i < 5; i++) {
+        runFrame(&state);
+    }
+
+    Snapshot8080 snap;
+    saveSnapshot(&state, &snap);
+    uint32_t saved_hash = hashState(&state);
+    for (int i = 0; i < 10; i++) {
+        runFrame(&state);
+    }
+    uint32_t expected = hashState(&state);
+    if (expected == saved_hash) {
+        test_failed(test_name, "Test program did not change the machine state");
+        return;
+    }
+
+    // Restore halfway through a frame, with the dirty scanlines already consumed
+    uint8_t lines[VRAM_DIRTY_BYTES];
+    consumeDirtyScanlines(&state, lines);
+    state.frame_half = 2;
+    restoreSnapshot(&state, &snap);
+    if (hashState(&state) != saved_hash || state.frame_half != 0) {
+        test_failed(test_name, "Restore did not return to the saved state");
+        return;
+    }
+    if (consumeDirtyScanlines(&state, lines) != VRAM_LINES) {
+        test_failed(test_name, "Restore should mark every scanline dirty");
+        return;
+    }
+    for (int i = 0; i < 10; i++) {
+        runFrame(&state);
+    }
+    if (hashState(&state) != expected) {
+        test_failed(test_name, "Frames after a restore differ from the first run");
+        printf("    Expected hash: 0x%08X, Got: 0x%08X\n", expected, hashState(&state));
+        return;
+    }
+
+    // Into a second machine with the same program loaded
+    State8080 other;
+    initCPU(&other);
+    mapSpaceInvadersMemory(&other);
+    memcpy(other.memory, program, sizeof(program));
+    memcpy(other.memory + 0x0100, loop, sizeof(loop));
+    restoreSnapshot(&other, &snap);
+    for (int i = 0; i < 10; i++) {
+        runFrame(&other);
+    }
+    if (hashState(&other) != expected) {
+        test_failed(test_name, "Snapshot restored into another machine diverged");
+        return;
+    }
+    test_passed(test_name);
+}
+
+static void recordInvalidation(void* context, uint32_t block, uint16_t start, uint16_t length) {
+    ((std::vector<uint32_t>*)context)->push_back(block);
+}
+
+void test_code_tracker() {
+    const char* test_name = "Self-modifying code tracker";
+    State8080 state;
+    initCPU(&state);
+    mapSpaceInvadersMemory(&state);
+
+    CodeTracker tracker;
+    std::vector<uint32_t> invalidated;
+    attachCodeTracker(&state, &tracker, recordInvalidation, &invalidated);
+    uint32_t low = registerCodeBlock(&state, 0x2000, 16);
+    uint32_t straddle = registerCodeBlock(&state, 0x20FE, 4);   // pages 0x20 and 0x21
+    registerCodeBlock(&state, 0x0100, 8);                       // ROM, never written
+
+    writeByte(&state, 0x6005, 0xAA);    // through the mirror of 0x2005
+    if (invalidated.size() != 1 || invalidated[0] != low || state.memory[0x2005] != 0xAA) {
+        test_failed(test_name, "Store through mirror did not invalidate the block");
+        return;
+    }
+    writeByte(&state, 0x2080, 0xBB);    // page still holds code, no block covers it
+    if (invalidated.size() != 1 || tracker.trapped_writes != 2 || state.memory[0x2080] != 0xBB) {
+        test_failed(test_name, "Store next to code invalidated a block");
+        return;
+    }
+    writeByte(&state, 0x2101, 0xCC);
+    if (invalidated.size() != 2 || invalidated[1] != straddle) {
+        test_failed(test_name, "Store to second page of a block was missed");
+        return;
+    }
+    if (state.pages.write[0x20] == nullptr || state.pages.write[0x21] == nullptr || state.pages.write[0x60] == nullptr) {
+        test_failed(test_name, "Pages without code were not released");
+        return;
+    }
+    writeByte(&state, 0x2001, 0xDD);
+    if (tracker.trapped_writes != 3 || tracker.invalidated_blocks != 2) {
+        test_failed(test_name, "Released page still trapped");
+        return;
+    }
+    detachCodeTracker(&state);
+    test_passed(test_name);
+}
+
+void test_memory_profile() {
+    const char* test_name = "Memory access profiler";
+    State8080 state;
+    initCPU(&state);
+    MemoryProfile* profile = new MemoryProfile;
+    bool attached = attachMemoryProfile(&state, profile);
+#ifdef PROFILE_MEMORY
+    const uint8_t program[] = {
+        0x3A, 0x00, 0x20,   // LDA 0x2000
+        0x32, 0x01, 0x20,   // STA 0x2001
+        0xC5                // PUSH B
+    };
+    memcpy(state.memory, program, sizeof(program));
+    state.sp = 0x2400;
+    for (int i = 0; i < 3; i++) {
+        Emulate8080Op(&state);
+    }
+    if (!attached || profile->executes[0x0000] != 1 || profile->executes[0x0003] != 1 || profile->executes[0x0001] != 0 ||
+        profile->reads[0x2000] != 1 || profile->writes[0x2001] != 1 || profile->writes[0x23FF] != 1 || profile->reads[0x0001] != 0) {
+        test_failed(test_name, "Wrong access counts");
+        delete profile;
+        return;
+    }
+#else
+    if (attached) {
+        test_failed(test_name, "Profiler attached while compiled out");
+        delete profile;
+        return;
+    }
+#endif
+    detachMemoryProfile(&state);
+    delete profile;
+    test_passed(test_name);
+}
+
+void test_coverage_map() {
+    const char* test_name = "Coverage bitmap and merge";
+    const char* path = "coverage_test.cov";
+    State8080 state;
+    initCPU(&state);
+
+    const uint8_t program[] = {
+        0x3E, 0x01,         // 0000 MVI A, 1
+        0xC3, 0x08, 0x00,   // 0002 JMP 0008
+        0x00, 0x00, 0x00,   // 0005 skipped
+        0x00                // 0008 NOP
+    };
+    memcpy(state.memory, program, sizeof(program));
+    CoverageMap map = {};
+    attachCoverage(&state, &map);
+    for (int i = 0; i < 3; i++) {
+        Emulate8080Op(&state);
+    }
+    detachCoverage(&state);
+    Emulate8080Op(&state);  // 0009, not recorded
+
+    if (countCovered(&map, 0, 0x10000) != 3 || !isCovered(&map, 0x0000) || !isCovered(&map, 0x0002)
+        || !isCovered(&map, 0x0008) || isCovered(&map, 0x0005) || isCovered(&map, 0x0009)) {
+        test_failed(test_name, "Wrong addresses recorded");
+        return;
+    }
+
+    CoverageMap other = {}, loaded;
+    other.bits[0x0005 >> 3] |= 1 << (0x0005 & 7);
+    if (!writeCoverage(&map, path) || !readCoverage(&loaded, path)) {
+        test_failed(test_name, "Coverage file round trip failed");
+        remove(path);
+        return;
+    }
+    remove(path);
+    mergeCoverage(&loaded, &other);
+    if (countCovered(&loaded, 0, 0x10000) != 4 || !isCovered(&loaded, 0x0005)) {
+        test_failed(test_name, "Merge did not OR the maps");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_debugger_stops() {
+    const char* test_name = "Breakpoints and watchpoints";
+    State8080 state;
+    initCPU(&state);
+
+    const uint8_t program[] = {
+        0x06, 0x05,         // 0000 MVI B, 5
+        0x05,               // 0002 DCR B
+        0x32, 0x00, 0x20,   // 0003 STA 0x2000
+        0xC2, 0x02, 0x00,   // 0006 JNZ 0002
+        0xC3, 0x09, 0x00    // 0009 JMP 0009
+    };
+    memcpy(state.memory, program, sizeof(program));
+    Debugger debugger;
+    attachDebugger(&state, &debugger);
+    if (!addBreakpointSpec(&state, "0002:b==3") || addBreakpointSpec(&state, "0002:q==3") || addWatchpointSpec(&state, "2000:x")) {
+        test_failed(test_name, "Breakpoint spec parsing failed");
+        return;
+    }
+
+    if (runFrame(&state) || debugger.stop.reason != DEBUG_STOP_BREAKPOINT || state.pc != 0x0002 || state.b != 3) {
+        test_failed(test_name, "Conditional breakpoint did not stop at B == 3");
+        return;
+    }
+
+    state.a = 0x77;
+    addWatchpointSpec(&state, "2000:w");
+    if (runFrame(&state) || debugger.stop.reason != DEBUG_STOP_WATCH_WRITE || state.pc != 0x0006
+        || debugger.stop.addr != 0x2000 || state.memory[0x2000] != 0x77 || state.b != 2) {
+        test_failed(test_name, "Write watchpoint did not stop after the store");
+        return;
+    }
+
+    removeWatchpoints(&state);
+    addBreakpoint(&state, 0x0009);
+    if (runFrame(&state) || debugger.stop.pc != 0x0009 || state.b != 0) {
+        test_failed(test_name, "Breakpoint at loop end missed");
+        return;
+    }
+    uint32_t cycles = state.cycles;
+    if (runFrame(&state) || state.pc != 0x0009 || state.cycles == cycles) {
+        test_failed(test_name, "Resume did not step past the breakpoint once");
+        return;
+    }
+
+    removeBreakpoint(&state, 0x0009);
+    if (!runFrame(&state)) {
+        test_failed(test_name, "Frame did not finish without breakpoints");
+        return;
+    }
+    detachDebugger(&state);
+    test_passed(test_name);
+}
+
+void test_watched_page_execution() {
+    const char* test_name = "Executing inside a read-watched page";
+    State8080 state;
+    initCPU(&state);
+
+    const uint8_t program[] = {
+        0x0C,               // 2100 INR C
+        0xC2, 0x00, 0x21,   // 2101 JNZ 2100
+        0x3A, 0x80, 0x21,   // 2104 LDA 2180
+        0xC3, 0x07, 0x21    // 2107 JMP 2107
+    };
+    memcpy(state.memory + 0x2100, program, sizeof(program));
+    state.memory[0x2180] = 0x5A;
+    state.pc = 0x2100;
+    Debugger debugger;
+    attachDebugger(&state, &debugger);
+    addWatchpoint(&state, 0x2100, 0x21FF, WATCH_READ);
+
+    // 256 laps of fetches from the page, then one data read
+    if (runFrame(&state) || debugger.stop.reason != DEBUG_STOP_WATCH_READ || debugger.stop.addr != 0x2180
+        || debugger.stop.value != 0x5A || state.pc != 0x2107 || state.a != 0x5A || state.c != 0) {
+        test_failed(test_name, "Instruction fetch tripped the read watchpoint");
+        return;
+    }
+    if (debugger.watchpoints[0].hits != 1) {
+        test_failed(test_name, "Fetches were counted as watched reads");
+        return;
+    }
+    detachDebugger(&state);
+    test_passed(test_name);
+}
+
+/**
+* Feeds packets through the stub's command queue the way its network
+* thread would and checks the replies, without opening a socket.
+*/
+static std::string gdbExchange(State8080* state, GdbStub* stub, const char* packet) {
+    stub->commands.push({ GDB_PACKET, packet });
+    serviceGdbStub(state, stub);
+    std::string reply;
+    return stub->replies.pop(&reply) ? reply : std::string("<none>");
+}
+
+void test_gdb_stub_packets() {
+    const char* test_name = "GDB stub packets";
+    State8080 state;
+    initCPU(&state);
+
+    const uint8_t program[] = {
+        0x3E, 0x42,         // 0000 MVI A, 0x42
+        0x32, 0x00, 0x20,   // 0002 STA 0x2000
+        0xC3, 0x00, 0x00    // 0005 JMP 0000
+    };
+    memcpy(state.memory, program, sizeof(program));
+    GdbStub stub;
+
+    stub.commands.push({ GDB_CONNECTED, std::string() });
+    if (serviceGdbStub(&state, &stub) != GDB_HALTED || state.debugger != &stub.debugger) {
+        test_failed(test_name, "Connecting did not halt the CPU");
+        return;
+    }
+    state.flags.z = state.flags.s = state.flags.p = state.flags.ac = 0;
+    state.flags.c = 1;
+    state.b = 0x12;
+    state.c = 0x34;
+    state.sp = 0x2400;
+    std::string regs = gdbExchange(&state, &stub, "g");
+    if (regs != "030034120000000000240000" || gdbExchange(&state, &stub, "p4") != "0024") {
+        test_failed(test_name, "Register dump has the wrong layout");
+        printf("    Got: %s\n", regs.c_str());
+        return;
+    }
+    if (gdbExchange(&state, &stub, "P3=cdab") != "OK" || state.h != 0xAB || state.l != 0xCD) {
+        test_failed(test_name, "Register write failed");
+        return;
+    }
+    if (gdbExchange(&state, &stub, "m0,3") != "3e4232" || gdbExchange(&state, &stub, "M2100,2:beef") != "OK"
+        || state.memory[0x2100] != 0xBE || state.memory[0x2101] != 0xEF) {
+        test_failed(test_name, "Memory read/write failed");
+        return;
+    }
+
+    if (gdbExchange(&state, &stub, "s") != "S05" || state.pc != 0x0002 || state.a != 0x42) {
+        test_failed(test_name, "Step did not run one instruction");
+        return;
+    }
+    if (gdbExchange(&state, &stub, "Z2,2000,1") != "OK") {
+        test_failed(test_name, "Watchpoint insert failed");
+        return;
+    }
+    if (gdbExchange(&state, &stub, "c") != "<none>" || stub.run_state != GDB_RUNNING
+        || runFrame(&state) || !reportGdbStop(&state, &stub)) {
+        test_failed(test_name, "Continue did not stop on the watchpoint");
+        return;
+    }
+    std::string reply;
+    stub.replies.pop(&reply);
+    if (reply != "T05watch:2000;" || state.pc != 0x0005) {
+        test_failed(test_name, "Wrong watchpoint stop reply");
+        printf("    Got: %s at %04x\n", reply.c_str(), state.pc);
+        return;
+    }
+
+    gdbExchange(&state, &stub, "z2,2000,1");
+    gdbExchange(&state, &stub, "Z0,0,1");
+    gdbExchange(&state, &stub, "c");
+    if (runFrame(&state) || !reportGdbStop(&state, &stub) || !stub.replies.pop(&reply) || reply != "S05" || state.pc != 0) {
+        test_failed(test_name, "Breakpoint stop not reported");
+        return;
+    }
+
+    gdbExchange(&state, &stub, "c");
+    stub.commands.push({ GDB_INTERRUPT, std::string() });
+    serviceGdbStub(&state, &stub);
+    if (runFrame(&state) || !reportGdbStop(&state, &stub) || !stub.replies.pop(&reply) || reply != "S02") {
+        test_failed(test_name, "Interrupt not reported as SIGINT");
+        return;
+    }
+
+    stub.commands.push({ GDB_DISCONNECTED, std::string() });
+    if (serviceGdbStub(&state, &stub) != GDB_NO_CLIENT || state.debugger != nullptr || !runFrame(&state)) {
+        test_failed(test_name, "Disconnect did not release the CPU");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_trace_ring() {
+    const char* test_name = "Instruction trace ring";
+    const char* path = "trace_test.trace";
+    State8080 state;
+    initCPU(&state);
+
+    const uint8_t program[] = {
+        0x06, 0x0A,         // 0000 MVI B, 10
+        0x05,               // 0002 DCR B
+        0xC2, 0x02, 0x00,   // 0003 JNZ 0002
+        0x3E, 0x99,         // 0006 MVI A, 0x99
+        0x76                // 0008 HLT
+    };
+    memcpy(state.memory, program, sizeof(program));
+    TraceBuffer trace;
+    if (!openTrace(&trace, path, 12) || trace.header->capacity != 16) {
+        test_failed(test_name, "Could not create a 16 record trace");
+        return;
+    }
+    attachTrace(&state, &trace);
+    for (int i = 0; i < 1 + 10 * 2 + 2; i++) {
+        traceInstruction(&state);
+        Emulate8080Op(&state);
+    }
+    detachTrace(&state);
+    closeTrace(&trace);
+
+    std::vector<TraceRecord> records;
+    uint64_t written;
+    if (!readTrace(path, &records, &written) || written != 23 || records.size() != 16) {
+        test_failed(test_name, "Ring did not keep the last 16 of 23 records");
+        remove(path);
+        return;
+    }
+    const TraceRecord& last = records.back();
+    const TraceRecord& before = records[records.size() - 2];
+    if (last.pc != 0x0008 || last.code[0] != 0x76 || last.a != 0x99 || before.pc != 0x0006
+        || before.code[1] != 0x99 || before.b != 0 || (uint8_t)(last.cycles - before.cycles) != 7) {
+        test_failed(test_name, "Newest records hold the wrong state");
+        remove(path);
+        return;
+    }
+
+    // Only DCR B from the second pass on, stopping after three records
+    initCPU(&state);
+    memcpy(state.memory, program, sizeof(program));
+    openTrace(&trace, path, 16);
+    setTraceRange(&trace, 0x0002, 0x0002);
+    setTraceTrigger(&trace, 0x0002, 3);
+    attachTrace(&state, &trace);
+    for (int i = 0; i < 1 + 10 * 2 + 2 && state.trace; i++) {
+        traceInstruction(&state);
+        Emulate8080Op(&state);
+    }
+    bool detached = state.trace == nullptr;
+    closeTrace(&trace);
+    readTrace(path, &records, &written);
+    remove(path);
+    if (!detached || written != 3 || records[0].b != 10 || records[2].b != 8 || records[1].pc != 0x0002) {
+        test_failed(test_name, "Range and trigger filters failed");
+        return;
+    }
+
+    // runFrame records every instruction it runs
+    initCPU(&state);
+    memcpy(state.memory, program, sizeof(program));
+    state.memory[0x0008] = 0xC3; // JMP 0008
+    state.memory[0x0009] = 0x08;
+    state.memory[0x000A] = 0x00;
+    trace = TraceBuffer(); // Drop the filters
+    openTrace(&trace, path, 16);
+    attachTrace(&state, &trace);
+    runFrame(&state);
+    detachTrace(&state);
+    uint64_t frame_written = trace.header->written;
+    closeTrace(&trace);
+    remove(path);
+    if (frame_written < 1000) {
+        test_failed(test_name, "runFrame did not record its instructions");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_trace_divergence() {
+    const char* test_name = "Trace and hash divergence search";
+
+    std::vector<HashStreamRecord> a(1000), b(1000);
+    for (uint32_t i = 0; i < 1000; i++) {
+        a[i] = { i, i * 2654435761u, 0 };
+        b[i] = a[i];
+    }
+    if (findHashDivergence(a.data(), b.data(), 1000) != 1000) {
+        test_failed(test_name, "Equal hash streams reported a divergence");
+        return;
+    }
+    uint32_t expected[] = { 0, 1, 2, 3, 500, 777, 999 };
+    for (uint32_t at : expected) {
+        for (uint32_t i = 0; i < 1000; i++) {
+            b[i].hash = a[i].hash ^ (i >= at ? 1 : 0);
+        }
+        if (findHashDivergence(a.data(), b.data(), 1000) != at) {
+            test_failed(test_name, "Galloping search missed the first differing frame");
+            printf("    Expected %u\n", at);
+            return;
+        }
+    }
+
+    // Same 40 instructions into rings of different sizes, one register changed at record 29
+    const char* paths[] = { "diff_a.trace", "diff_b.trace" };
+    const uint32_t sizes[] = { 16, 64 };
+    State8080 state;
+    initCPU(&state);
+    memset(state.memory, 0x04, 0x100); // INR B
+    for (int side = 0; side < 2; side++) {
+        TraceBuffer trace;
+        openTrace(&trace, paths[side], sizes[side]);
+        attachTrace(&state, &trace);
+        state.pc = 0;
+        state.b = 0;
+        state.cycles = 0;
+        for (int i = 0; i < 40; i++) {
+            if (side == 1 && i == 29) {
+                state.c = 0x55;
+            }
+            traceInstruction(&state);
+            Emulate8080Op(&state);
+        }
+        detachTrace(&state);
+        closeTrace(&trace);
+        state.c = 0;
+    }
+    TraceView view_a, view_b;
+    bool opened = openTraceView(&view_a, paths[0]) && openTraceView(&view_b, paths[1]);
+    uint64_t offset = opened ? findTraceDivergence(&view_a, view_a.first, &view_b, view_a.first, 40 - view_a.first) : 0;
+    uint64_t same = opened ? findTraceDivergence(&view_a, view_a.first, &view_b, view_a.first, 29 - view_a.first) : 0;
+    if (opened) {
+        closeTraceView(&view_a);
+        closeTraceView(&view_b);
+    }
+    remove(paths[0]);
+    remove(paths[1]);
+    if (!opened || view_a.first != 24 || offset != 29 - 24 || same != 29 - 24) {
+        test_failed(test_name, "Trace compare missed the first differing record");
+        return;
+    }
+    test_passed(test_name);
+}
+
+static uint8_t readCountingPort(State8080* cpu, uint8_t port, void* context) {
+    return (uint8_t)(++*(int*)context + port);
+}
+
+void test_io_port_table() {
+    const char* test_name = "I/O port device table";
+    State8080 state;
+    initCPU(&state);
+
+    const uint8_t program[] = {
+        0x3E, 0xA5,     // MVI A, 0xA5
+        0xD3, 0x04,     // OUT 4 (shift data)
+        0x3E, 0x3C,     // MVI A, 0x3C
+        0xD3, 0x04,     // OUT 4
+        0x3E, 0x03,     // MVI A, 3
+        0xD3, 0x02,     // OUT 2 (shift offset)
+        0xDB, 0x03,     // IN 3 (shift result)
+        0xDB, 0x07,     // IN 7 (unmapped)
+        0xD3, 0x09,     // OUT 9 (unmapped)
+        0xDB, 0x40      // IN 0x40 (counting device)
+    };
+    memcpy(state.memory, program, sizeof(program));
+    for (int i = 0; i < 7; i++) {
+        Emulate8080Op(&state);
+    }
+    if (state.a != 0xE5) {
+        test_failed(test_name, "Shift register result is wrong");
+        return;
+    }
+    Emulate8080Op(&state);
+    Emulate8080Op(&state);
+    if (state.a != 0 || state.io.unmapped_reads != 1 || state.io.unmapped_writes != 1) {
+        test_failed(test_name, "Unmapped ports were not read as 0 and counted");
+        return;
+    }
+
+    int reads = 0;
+    mapInputPort(&state, 0x40, readCountingPort, &reads);
+    Emulate8080Op(&state);
+    if (state.a != 0x41 || reads != 1) {
+        test_failed(test_name, "Registered device was not called with its context");
+        return;
+    }
+
+    *state.ports.port1 = 0x5A;
+    mapOutputLatch(&state, 0x06, state.ports.port2);
+    output_port(&state, 0x06, 0x77);
+    if (input_port(&state, 0x01) != 0x5A || *state.ports.port2 != 0x77 || *state.ports.port6 != 0) {
+        test_failed(test_name, "Latches are not wired to their ports");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_input_queue() {
+    const char* test_name = "Cycle-timestamped input queue";
+    State8080 state;
+    initCPU(&state);
+    InputQueue queue;
+    attachInput(&state, &queue);
+    const uint32_t frame = 2 * CYCLES_PER_HALF_FRAME;
+    scheduleInput(&state, &queue, 100000000);
+
+    // A 1 ms tap between two frames 16 ms apart
+    postInput(&queue, 1, INPUT_P1_FIRE, INPUT_P1_FIRE, 104000000);
+    postInput(&queue, 1, INPUT_P1_FIRE, 0, 105000000);
+    scheduleInput(&state, &queue, 116000000);
+    if (queue.pending_count != 2 || queue.pending[0].cycle != state.cycles + frame / 4
+        || queue.pending[1].cycle != state.cycles + frame * 5 / 16) {
+        test_failed(test_name, "Events not placed at their time in the frame");
+        return;
+    }
+    uint32_t start = state.cycles;
+    state.cycles = start + frame / 8;
+    if (input_port(&state, 1) & INPUT_P1_FIRE) {
+        test_failed(test_name, "Press applied before its cycle");
+        return;
+    }
+    // Both events are due by the next read: the release waits for it
+    state.cycles = start + frame / 2;
+    if (!(input_port(&state, 1) & INPUT_P1_FIRE) || queue.sticky != 1) {
+        test_failed(test_name, "Short press was lost");
+        return;
+    }
+    if ((input_port(&state, 1) & INPUT_P1_FIRE) || queue.latency.total != 1) {
+        test_failed(test_name, "Held release was not applied after the read");
+        return;
+    }
+
+    // A press the game reads before the release is released on time
+    postInput(&queue, 1, INPUT_P1_LEFT, INPUT_P1_LEFT, 120000000);
+    postInput(&queue, 1, INPUT_P1_LEFT, 0, 130000000);
+    scheduleInput(&state, &queue, 132000000);
+    start = state.cycles;
+    state.cycles = start + frame / 2;
+    bool pressed = input_port(&state, 1) & INPUT_P1_LEFT;
+    state.cycles = start + frame - 1;
+    if (!pressed || (input_port(&state, 1) & INPUT_P1_LEFT) || queue.sticky != 1) {
+        test_failed(test_name, "Held press not released at its cycle");
+        return;
+    }
+
+    detachInput(&state, &queue);
+    *state.ports.port1 = INPUT_COIN;
+    if (input_port(&state, 1) != INPUT_COIN) {
+        test_failed(test_name, "Port 1 is not a plain latch after detaching");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_shared_memory_layout() {
+    const char* test_name = "Shared memory layout header";
+    std::vector<uint8_t> storage(shmBlockSize() + 64);
+    uint8_t* block = storage.data() + (64 - (uintptr_t)storage.data() % 64) % 64;
+    initShmHeader(block);
+    ShmHeader* header = (ShmHeader*)block;
+    if (validateShmHeader(header, shmBlockSize()) != SHM_OK
+        || shmRegion(header, SHM_REGION_MEMORY, MEMORY_SIZE) != block + SHM_HEADER_SIZE
+        || shmRegion(header, SHM_REGION_PORTS, PORT_BLOCK_SIZE) != block + SHM_HEADER_SIZE + PORT_LOCATION
+        || shmRegion(header, SHM_REGION_FRAMEBUFFER, 1) != nullptr
+        || shmRegion(header, SHM_REGION_MEMORY, MEMORY_SIZE + 1) != nullptr) {
+        test_failed(test_name, "Regions not found where initShmHeader put them");
+        return;
+    }
+    if (validateShmHeader(header, shmBlockSize() - 1) != SHM_TOO_SMALL) {
+        test_failed(test_name, "Truncated mapping accepted");
+        return;
+    }
+    header->version_minor++; // Additions keep the block usable
+    header->regions[SHM_REGION_STATS].offset = shmBlockSize();
+    if (validateShmHeader(header, shmBlockSize()) != SHM_BAD_REGION) {
+        test_failed(test_name, "Region outside the block accepted");
+        return;
+    }
+    initShmHeader(block);
+    header->version_major++;
+    if (validateShmHeader(header, shmBlockSize()) != SHM_BAD_VERSION) {
+        test_failed(test_name, "Other major version accepted");
+        return;
+    }
+    memset(block, 0, SHM_HEADER_SIZE); // An unversioned block starts with 8080 memory
+    if (validateShmHeader(header, shmBlockSize()) != SHM_BAD_MAGIC) {
+        test_failed(test_name, "Block without a header accepted");
+        return;
+    }
+
+    // UI key events cross the ring into the emulator's input queue, through a wrap
+    initShmHeader(block);
+    SharedBlock shared;
+    shared.header = header;
+    shared.input = (ShmInputRing*)shmRegion(header, SHM_REGION_INPUT_RING, sizeof(ShmInputRing));
+    shared.input->head = shared.input->tail = UINT32_MAX - 1;
+    InputQueue queue;
+    for (int i = 0; i < SHM_INPUT_RING_SIZE; i++) {
+        ShmInputRecord record = {};
+        record.host_ns = 1000 + i;
+        record.port = 1;
+        record.mask = INPUT_P1_FIRE;
+        record.value = (i & 1) ? 0 : INPUT_P1_FIRE;
+        pushShmInput(shared.input, record);
+    }
+    ShmInputRecord extra = {};
+    if (pushShmInput(shared.input, extra) || shared.input->dropped != 1) {
+        test_failed(test_name, "Full ring accepted a record");
+        return;
+    }
+    forwardSharedInput(&shared, &queue);
+    InputEvent event;
+    bool ordered = true;
+    for (int i = 0; i < SHM_INPUT_RING_SIZE; i++) {
+        ordered = ordered && queue.events.pop(&event) && event.host_ns == (uint64_t)(1000 + i) && event.port == 1;
+    }
+    if (!ordered || !queue.events.empty() || shared.input->head != shared.input->tail) {
+        test_failed(test_name, "Ring records not forwarded in order");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_sound_event_queue() {
+    const char* test_name = "Sound latch event queue";
+    State8080 state;
+    initCPU(&state);
+
+    output_port(&state, 0x03, 0x01);   // no queue attached: nothing posted
+    SoundEventQueue queue;
+    state.sound = &queue;
+    state.cycles = 100;
+    output_port(&state, 0x03, 0x03);   // UFO held, shot starts
+    state.cycles = 200;
+    output_port(&state, 0x03, 0x02);   // UFO stops, shot still held
+    output_port(&state, 0x05, 0x20);   // extra life
+
+    const SoundEvent expected[] = {
+        { 100, SOUND_SHOOT, 1 },
+        { 200, SOUND_UFO_HIGH, 0 },
+        { 200, SOUND_EXTENDED_PLAY, 1 }
+    };
+    SoundEvent event;
+    for (const SoundEvent& want : expected) {
+        if (!queue.events.pop(&event) || event.cycle != want.cycle || event.effect != want.effect || event.on != want.on) {
+            test_failed(test_name, "Latch edges were not queued in order with their cycles");
+            return;
+        }
+    }
+    if (queue.events.pop(&event)) {
+        test_failed(test_name, "Unexpected extra sound event");
+        return;
+    }
+
+    // Fleet notes advance per machine, and a snapshot brings the next one back
+    State8080 other;
+    initCPU(&other);
+    SoundEventQueue other_queue;
+    other.sound = &other_queue;
+    output_port(&state, 0x05, 0x01);   // note 1
+    output_port(&state, 0x05, 0x00);
+    Snapshot8080 snap;
+    saveSnapshot(&state, &snap);
+    output_port(&state, 0x05, 0x01);   // note 2
+    output_port(&other, 0x05, 0x01);   // the other machine starts at note 1
+    restoreSnapshot(&state, &snap);
+    output_port(&state, 0x05, 0x01);   // note 2 again
+    const SoundEffect notes[] = { SOUND_FAST_INVADER_1, SOUND_FAST_INVADER_2, SOUND_FAST_INVADER_2 };
+    for (SoundEffect want : notes) {
+        if (!queue.events.pop(&event) || event.effect != want) {
+            test_failed(test_name, "Fleet notes did not follow the machine's own sequence");
+            return;
+        }
+    }
+    if (!other_queue.events.pop(&event) || event.effect != SOUND_FAST_INVADER_1) {
+        test_failed(test_name, "Fleet note sequence is shared between machines");
+        return;
+    }
+
+    for (int i = 0; i < SOUND_QUEUE_SIZE + 4; i++) {
+        output_port(&state, 0x03, (i & 1) ? 0x00 : 0x01);   // every write is a UFO edge
+    }
+    if (queue.dropped != 4) {
+        test_failed(test_name, "Full queue did not drop and count events");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_sound_clock() {
+    const char* test_name = "Cycle-stamped sound scheduling";
+    SoundClock clock;
+    initSoundClock(&clock, 48000, 480);
+    SoundTimingStats stats;
+
+    // A frame's events are drained together but keep their emulated spacing
+    uint64_t now = 1000;
+    uint64_t t0 = soundEventTime(&clock, 0xFFFFF000, now, &stats);
+    uint64_t t1 = soundEventTime(&clock, 0xFFFFF000 + CYCLES_PER_HALF_FRAME, now, &stats);
+    uint64_t t2 = soundEventTime(&clock, 0xFFFFF000 + 2 * CYCLES_PER_HALF_FRAME, now, &stats);  // wraps
+    uint64_t spacing = (uint64_t)CYCLES_PER_HALF_FRAME * 48000 / CPU_CLOCK_HZ;
+    if (t0 != now + clock.latency || t1 - t0 != spacing || t2 - t0 != 2 * spacing + 1) {
+        test_failed(test_name, "Events were not placed by their cycle stamps");
+        return;
+    }
+    if (stats.scheduled_error_max != 0 || stats.immediate_error_max != t2 - t0 || stats.reanchors != 0) {
+        test_failed(test_name, "Onset errors were not measured");
+        return;
+    }
+
+    // Emulation paused: the next event would land in the past
+    uint64_t later = soundEventTime(&clock, 0xFFFFF000 + 3 * CYCLES_PER_HALF_FRAME, now + 48000, &stats);
+    if (later != now + 48000 + clock.latency || stats.reanchors != 1 || stats.events != 4) {
+        test_failed(test_name, "Clock did not re-anchor after a stall");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_voice_mixer() {
+    const char* test_name = "Voice pool mixer";
+    SoundMixer mixer;
+    const float shot[] = { 0.25f, 0.25f, 0.25f, 0.25f };
+    const float ufo[] = { 0.5f, -0.5f };
+    const float* data[SOUND_COUNT] = {};
+    uint32_t lengths[SOUND_COUNT] = {};
+    data[SOUND_SHOOT] = shot;
+    lengths[SOUND_SHOOT] = 4;
+    data[SOUND_UFO_HIGH] = ufo;
+    lengths[SOUND_UFO_HIGH] = 2;
+    setMixerSamples(&mixer, data, lengths);
+
+    // Retriggered shot overlaps itself; the UFO loops until stopped
+    triggerVoice(&mixer, SOUND_SHOOT, true, 1);
+    triggerVoice(&mixer, SOUND_SHOOT, true, 3);
+    triggerVoice(&mixer, SOUND_UFO_HIGH, true, 2);
+    triggerVoice(&mixer, SOUND_UFO_HIGH, false, 7);
+    float out[10];
+    mixSound(&mixer, nullptr, out, 6);
+    mixSound(&mixer, nullptr, out + 6, 4);
+    const float expected[] = { 0, 0.25f, 0.75f, 0.0f, 1.0f, -0.25f, 0.75f, 0, 0, 0 };
+    for (int i = 0; i < 10; i++) {
+        if (out[i] != expected[i]) {
+            test_failed(test_name, "Voices were not mixed at their start and stop frames");
+            return;
+        }
+    }
+    for (const MixerVoice& voice : mixer.voices) {
+        if (voice.active) {
+            test_failed(test_name, "Finished voices were not released");
+            return;
+        }
+    }
+
+    for (int i = 0; i < MIXER_VOICES + 2; i++) {
+        triggerVoice(&mixer, SOUND_SHOOT, true, 20 + i);
+    }
+    if (mixer.voices_stolen != 2) {
+        test_failed(test_name, "Full pool did not reuse the oldest voices");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_sound_synth() {
+    const char* test_name = "Sound board synthesis";
+    SoundSynth synth;
+    initSynth(&synth, 48000);
+    static float out[48000 * 2];
+
+    triggerSynth(&synth, SOUND_UFO_HIGH, true, 10);
+    triggerSynth(&synth, SOUND_UFO_HIGH, false, 1000);
+    triggerSynth(&synth, SOUND_SHOOT, true, 2003);
+    renderSynth(&synth, out, 100, 0);
+    renderSynth(&synth, out + 100, 48000 * 2 - 100, 100);   // odd split: control blocks straddle calls
+
+    for (int i = 0; i < 10; i++) {
+        if (out[i] != 0.0f) {
+            test_failed(test_name, "Circuit sounded before it was keyed on");
+            return;
+        }
+    }
+    if (out[10] == 0.0f || out[999] == 0.0f || out[1000] != 0.0f || out[2002] != 0.0f || out[2003] == 0.0f) {
+        test_failed(test_name, "Circuits were not keyed on and off at their frames");
+        return;
+    }
+    for (int i = 0; i < 48000 * 2; i++) {
+        if (!(out[i] >= -1.0f && out[i] <= 1.0f)) {
+            test_failed(test_name, "Output left [-1, 1]");
+            return;
+        }
+    }
+    for (const SynthCircuit& circuit : synth.circuits) {
+        if (circuit.active) {
+            test_failed(test_name, "Decayed circuit was not released");
+            return;
+        }
+    }
+
+    // Re-keyed while decaying and after rendering began: the tail plays up to the new onset
+    initSynth(&synth, 48000);
+    memset(out, 0, sizeof(out));
+    triggerSynth(&synth, SOUND_FAST_INVADER_1, true, 0);
+    renderSynth(&synth, out, 100, 0);
+    triggerSynth(&synth, SOUND_FAST_INVADER_1, true, 3000);
+    renderSynth(&synth, out + 100, 6000 - 100, 100);
+    float tail = 0.0f, onset = 0.0f;
+    for (int i = 2200; i < 3000; i++) {
+        tail = std::fmax(tail, std::fabs(out[i]));
+    }
+    for (int i = 3000; i < 3800; i++) {
+        onset = std::fmax(onset, std::fabs(out[i]));
+    }
+    if (tail < 0.1f || onset < 2.0f * tail) {
+        test_failed(test_name, "Re-keying cut the decaying tail short");
+        printf("    Tail peak: %f, onset peak: %f\n", tail, onset);
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_offline_sound_sink() {
+    const char* test_name = "Offline sound sink";
+    SoundConfig config;
+    config.sink = SOUND_SINK_NULL;
+    config.synthesize = true;
+    if (!initSoundSystem(config)) {
+        test_failed(test_name, "Null sink failed to initialize");
+        return;
+    }
+    State8080 state;
+    initCPU(&state);
+    state.cycles = 0xFFFF0000;  // wraps during the frame
+    attachSound(&state);
+    uint32_t silent = soundHash();
+    state.cycles += CYCLES_PER_HALF_FRAME;
+    output_port(&state, 0x03, 0x02);
+    state.cycles += CYCLES_PER_HALF_FRAME;
+    renderSound(&state);
+    detachSound(&state);
+    shutdownSoundSystem();
+
+    uint64_t frames;
+    uint32_t hash = soundHash(&frames);
+    if (frames != (uint64_t)2 * CYCLES_PER_HALF_FRAME * 48000 / CPU_CLOCK_HZ || hash == silent) {
+        test_failed(test_name, "Output was not rendered up to the emulated cycle");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_embedded_sound_assets() {
+    const char* test_name = "Embedded sound effects";
+    for (const SoundAsset& asset : SOUND_ASSETS) {
+        if (asset.size < 44 || memcmp(asset.data, "RIFF", 4) || memcmp(asset.data + 8, "WAVE", 4)) {
+            test_failed(test_name, "Asset is not a WAV file");
+            printf("    Asset: %s\n", asset.name);
+            return;
+        }
+    }
+
+    // Decoded in the background; offline sinks wait for them when attached
+    SoundConfig config;
+    config.sink = SOUND_SINK_NULL;
+    if (!initSoundSystem(config)) {
+        test_failed(test_name, "Null sink failed to initialize");
+        return;
+    }
+    State8080 state;
+    initCPU(&state);
+    attachSound(&state);
+    bool ready = soundEffectsReady();
+    uint32_t silent = soundHash();
+    output_port(&state, 0x03, 0x02);
+    state.cycles += 2 * CYCLES_PER_HALF_FRAME;
+    renderSound(&state);
+    detachSound(&state);
+    shutdownSoundSystem();
+    if (!ready || soundHash() == silent) {
+        test_failed(test_name, "Effects were not ready when the sink was attached");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_audio_latency() {
+    const char* test_name = "OUT to output latency";
+    SoundMixer mixer;
+    initSoundClock(&mixer.clock, 48000, 480);
+    SoundEventQueue queue;
+    queue.events.push(SoundEvent{ 0, SOUND_SHOOT, 1, 1000000 });
+    static float out[480];
+
+    // Onset lands latency = 801 + 480 frames after the first buffer
+    const uint64_t buffer_ns[] = { 5000000, 15000000, 25000000 };
+    for (uint64_t ns : buffer_ns) {
+        mixer.host_ns = ns;
+        mixSound(&mixer, &queue, out, 480);
+        if (ns != buffer_ns[2] && mixer.latency.total != 0) {
+            test_failed(test_name, "Latency recorded before the first sample was played");
+            return;
+        }
+    }
+    uint64_t expected = 25000000 + 321ull * 1000000000 / 48000 - 1000000;
+    if (mixer.latency.total != 1 || mixer.latency.max_ns != expected || mixer.pending_count != 0) {
+        test_failed(test_name, "Latency of the onset was not measured at its first sample");
+        return;
+    }
+
+    LatencyHistogram histogram;
+    for (int i = 1; i <= 100; i++) {
+        addLatency(&histogram, i * 1000000ull);
+    }
+    if (latencyPercentile(&histogram, 0.5) != 50100000 || latencyPercentile(&histogram, 0.99) != 99100000) {
+        test_failed(test_name, "Wrong percentiles");
+        return;
+    }
+    test_passed(test_name);
+}
+
+/**
+* Runs rate control against an emulation whose clock is off by {drift}
+* for {seconds} of 48 kHz output in 480 frame buffers.
+*/
+static SoundClock simulateRateControl(double drift, uint32_t seconds, RateControlStats* stats) {
+    SoundClock clock;
+    initSoundClock(&clock, 48000, 480);
+    const uint32_t frame_cycles = 2 * CYCLES_PER_HALF_FRAME;
+    for (uint64_t now = 0; now < (uint64_t)seconds * 48000; now += 480) {
+        // The emulation publishes whole frames, running {drift} fast
+        double emulated = (double)now / 48000 * CPU_CLOCK_HZ * (1.0 + drift);
+        uint32_t cycle = (uint32_t)((uint64_t)(emulated / frame_cycles) * frame_cycles);
+        updateSoundRate(&clock, cycle, now, 480, stats);
+    }
+    return clock;
+}
+
+void test_rate_control() {
+    const char* test_name = "Audio rate control";
+    RateControlStats stats;
+    SoundClock clock = simulateRateControl(0.002, 3600, &stats);
+    double frame = 48000.0 * 2 * CYCLES_PER_HALF_FRAME / CPU_CLOCK_HZ;
+    double target = clock.latency - frame / 2;
+    if (std::fabs(clock.ratio * 1.002 - 1.0) > 0.0005 || stats.skipped != 0 || stats.limited != 0) {
+        test_failed(test_name, "Ratio did not settle on the drift");
+        return;
+    }
+    if (std::fabs(clock.fill - target) > 0.25 * target) {
+        test_failed(test_name, "Buffer fill drifted away from its set point over an hour");
+        return;
+    }
+
+    RateControlStats fast;
+    clock = simulateRateControl(0.02, 60, &fast);
+    if (fast.limited == 0 || clock.ratio < 1.0 - RATE_CONTROL_LIMIT - 1e-9) {
+        test_failed(test_name, "Correction was not limited");
+        return;
+    }
+    test_passed(test_name);
+}
+
+void test_trajectory_round_trip() {
+    const char* test_name = "Trajectory write/read";
+    const char* path = "trajectory_test.traj";
+    const uint32_t frames = 150;
+    State8080 state;
+    initCPU(&state);
+
+    TrajectoryWriter writer;
+    if (!openTrajectory(&writer, path, 0x2000, 0x100, 16)) {
+        test_failed(test_name, "Could not create trajectory file");
+        return;
+    }
+    for (uint32_t f = 0; f < frames; f++) {
+        state.memory[0x2400 + (f * 37) % 0x1C00] ^= (uint8_t)(f | 1);
+        state.memory[0x2000 + f % 0x100] = (uint8_t)f;
+        appendTrajectoryFrame(&writer, &state, (uint8_t)(f * 3));
+    }
+    if (!closeTrajectory(&writer)) {
+        test_failed(test_name, "Could not finish trajectory file");
+        return;
+    }
+
+    // Replay the same edits and compare frames read back in reverse order
+    uint8_t expected[frames][0x1C00];
+    uint8_t expected_ram[frames][0x100];
+    memset(state.memory, 0, MEMORY_SIZE);
+    for (uint32_t f = 0; f < frames; f++) {
+        state.memory[0x2400 + (f * 37) % 0x1C00] ^= (uint8_t)(f | 1);
+        state.memory[0x2000 + f % 0x100] = (uint8_t)f;
+        memcpy(expected[f], state.memory + 0x2400, 0x1C00);
+        memcpy(expected_ram[f], state.memory + 0x2000, 0x100);
+    }
+
+    TrajectoryReader reader;
+    if (!openTrajectoryReader(&reader, path) || reader.frame_count != frames) {
+        test_failed(test_name, "Could not open trajectory file");
+        remove(path);
+        return;
+    }
+    uint8_t vram[0x1C00], ram[0x100], port1;
+    for (uint32_t f = frames; f-- > 0;) {
+        if (!readTrajectoryFrame(&reader, f, &port1, vram, ram) || port1 != (uint8_t)(f * 3)
+            || memcmp(vram, expected[f], sizeof(vram)) || memcmp(ram, expected_ram[f], sizeof(ram))) {
+            test_failed(test_name, "Frame read back does not match");
+            printf("    Frame: %u\n", f);
+            closeTrajectoryReader(&reader);
+            remove(path);
+            return;
+        }
+    }
+    uint64_t file_size = reader.size;
+    closeTrajectoryReader(&reader);
+
+    // A chunk header that disagrees with its index entry
+    FILE* file = fopen(path, "r+b");
+    uint32_t bad_count = 1;
+    fseek(file, sizeof(TrajectoryFileHeader) + offsetof(TrajectoryChunkHeader, frame_count), SEEK_SET);
+    fwrite(&bad_count, sizeof(bad_count), 1, file);
+    fclose(file);
+    if (!openTrajectoryReader(&reader, path) || readTrajectoryFrame(&reader, 3, &port1, vram, ram)) {
+        test_failed(test_name, "Corrupt chunk header was decoded");
+        closeTrajectoryReader(&reader);
+        remove(path);
+        return;
+    }
+    closeTrajectoryReader(&reader);
+
+    // Frames but no chunks
+    TrajectoryTrailer trailer;
+    file = fopen(path, "r+b");
+    fseek(file, (long)(file_size - sizeof(trailer)), SEEK_SET);
+    fread(&trailer, sizeof(trailer), 1, file);
+    trailer.index_offset = file_size - sizeof(trailer);
+    trailer.chunk_count = 0;
+    fseek(file, (long)(file_size - sizeof(trailer)), SEEK_SET);
+    fwrite(&trailer, sizeof(trailer), 1, file);
+    fclose(file);
+    if (openTrajectoryReader(&reader, path)) {
+        test_failed(test_name, "Trailer with frames and no chunks was accepted");
+        closeTrajectoryReader(&reader);
+        remove(path);
+        return;
+    }
+    remove(path);
+
+    // Dropped without closeTrajectory: the destructor stops the thread
+    {
+        TrajectoryWriter abandoned;
+        openTrajectory(&abandoned, path, 0x2000, 0x100, 4);
+        for (uint32_t f = 0; f < 10; f++) {
+            appendTrajectoryFrame(&abandoned, &state, 0);
+        }
+    }
+    remove(path);
+    test_passed(test_name);
+}
+
+// Pixel (x, y) of the upright screen, as DrawScreen plots it
+static int screenPixel(const uint8_t* vram, int x, int y) {
+    int t = 255 - y;
+    return (vram[x * 32 + t / 8] >> (t % 8)) & 1;
+}
+
+void test_observation_unpack_and_pool() {
+    const char* test_name = "Observation unpack / max pool";
+    static uint8_t vram[0x1C00];
+    static uint8_t full[OBS_SCREEN_WIDTH * OBS_SCREEN_HEIGHT];
+    static uint8_t pooled[OBS_POOLED_WIDTH * OBS_POOLED_HEIGHT];
+    static float pooled_f[OBS_POOLED_WIDTH * OBS_POOLED_HEIGHT];
+    uint32_t seed = 12345;
+    for (int i = 0; i < 0x1C00; i++) {
+        seed = seed * 1103515245 + 12345;
+        vram[i] = (seed >> 16) & (seed >> 24); // sparse, like sprites
+    }
+
+    unpackScreen(vram, full);
+    maxPoolScreen(vram, pooled);
+    maxPoolScreen(vram, pooled_f);
+    for (int y = 0; y < OBS_SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < OBS_SCREEN_WIDTH; x++) {
+            if (full[y * OBS_SCREEN_WIDTH + x] != (screenPixel(vram, x, y) ? 255 : 0)) {
+                test_failed(test_name, "Unpacked pixel does not match VRAM");
+                printf("    x: %d, y: %d\n", x, y);
+                return;
+            }
+        }
+    }
+    for (int y = 0; y < OBS_POOLED_HEIGHT; y++) {
+        for (int x = 0; x < OBS_POOLED_WIDTH; x++) {
+            int lit = screenPixel(vram, 2 * x, 2 * y) | screenPixel(vram, 2 * x + 1, 2 * y)
+                | screenPixel(vram, 2 * x, 2 * y + 1) | screenPixel(vram, 2 * x + 1, 2 * y + 1);
+            int i = y * OBS_POOLED_WIDTH + x;
+            if (pooled[i] != (lit ? 255 : 0) || pooled_f[i] != (lit ? 1.0f : 0.0f)) {
+                test_failed(test_name, "Pooled pixel does not match VRAM");
+                printf("    x: %d, y: %d\n", x, y);
+                return;
+            }
+        }
+    }
+    test_passed(test_name);
+}
+
+void test_observation_resize() {
+    const char* test_name = "Observation 84x84 resize";
+    static uint8_t vram[0x1C00];
+    uint8_t max_out[84 * 84], area_out[84 * 84];
+    float area_f[84 * 84];
+    uint32_t seed = 777;
+    for (int i = 0; i < 0x1C00; i++) {
+        seed = seed * 1103515245 + 12345;
+        vram[i] = (seed >> 16) & (seed >> 24);
+    }
+
+    ObservationResizer resizer;
+    if (!initObservationResizer(&resizer, 84, 84)) {
+        test_failed(test_name, "84x84 should be a valid size");
+        return;
+    }
+    resizeScreenMax(&resizer, vram, max_out);
+    resizeScreenArea(&resizer, vram, area_out);
+    resizeScreenArea(&resizer, vram, area_f);
+
+    for (int oy = 0; oy < 84; oy++) {
+        for (int ox = 0; ox < 84; ox++) {
+            // Reference: exact overlap of the output cell with each source pixel
+            double x0 = ox * 224.0 / 84, x1 = (ox + 1) * 224.0 / 84;
+            double y0 = oy * 256.0 / 84, y1 = (oy + 1) * 256.0 / 84;
+            double area = 0;
+            int lit = 0;
+            for (int y = (int)y0; y < y1; y++) {
+                for (int x = (int)x0; x < x1; x++) {
+                    double wx = (x + 1 < x1 ? x + 1 : x1) - (x > x0 ? x : x0);
+                    double wy = (y + 1 < y1 ? y + 1 : y1) - (y > y0 ? y : y0);
+                    area += wx * wy * screenPixel(vram, x, y);
+                    lit |= screenPixel(vram, x, y);
+                }
+            }
+            area /= (x1 - x0) * (y1 - y0);
+            int i = oy * 84 + ox;
+            if (max_out[i] != (lit ? 255 : 0)) {
+                test_failed(test_name, "Max-pooled pixel does not match VRAM");
+                printf("    x: %d, y: %d\n", ox, oy);
+                return;
+            }
+            if (area_f[i] < area - 0.02 || area_f[i] > area + 0.02 || area_out[i] < area * 255 - 5 || area_out[i] > area * 255 + 5) {
+                test_failed(test_name, "Area-averaged pixel is off");
+                printf("    x: %d, y: %d, expected %f, got %f\n", ox, oy, area, area_f[i]);
+                return;
+            }
+        }
+    }
+    test_passed(test_name);
+}
+
 int main() {
     printf("Running Manual Emulator Tests...\n");
-    int failed_count = 0;
 
     // Call your test functions
     test_op_nop();
@@ -1530,11 +2897,37 @@ int main() {
     test_op_push_psw();
     test_op_ei();
     test_op_cpi_d8();
+    test_page_table_map();
+    test_address_wraparound();
+    test_dirty_scanlines();
+    test_snapshot_restore();
+    test_code_tracker();
+    test_memory_profile();
+    test_coverage_map();
+    test_debugger_stops();
+    test_watched_page_execution();
+    test_gdb_stub_packets();
+    test_trace_ring();
+    test_trace_divergence();
+    test_io_port_table();
+    test_input_queue();
+    test_shared_memory_layout();
+    test_sound_event_queue();
+    test_sound_clock();
+    test_voice_mixer();
+    test_sound_synth();
+    test_offline_sound_sink();
+    test_embedded_sound_assets();
+    test_audio_latency();
+    test_rate_control();
+    test_trajectory_round_trip();
+    test_observation_unpack_and_pool();
+    test_observation_resize();
     
     printf("Manual Tests Complete.\n");
 
     if (failed_count > 0) {
-        printf("failed %d unit tests", failed_count);
+        printf("failed %d unit tests\n", failed_count);
         return 1;
     }
 
@@ -0,0 +1,318 @@
+#include "trace.h"
+#include "disassembler.h"
+#include "machine.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+bool openTrace(TraceBuffer* trace, const char* path, uint32_t capacity) {
+    uint32_t records = 1;
+    while (records < capacity && records < (1u << 31)) {
+        records <<= 1;
+    }
+    size_t size = sizeof(TraceFileHeader) + (size_t)records * sizeof(TraceRecord);
+
+#if defined(_WIN32) || defined(_WIN64)
+    trace->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (trace->file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    trace->file_mapping = CreateFileMappingA(trace->file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+    trace->mapping = trace->file_mapping ? MapViewOfFile(trace->file_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : NULL;
+    if (trace->mapping == NULL) {
+        if (trace->file_mapping) CloseHandle(trace->file_mapping);
+        CloseHandle(trace->file);
+        trace->file = INVALID_HANDLE_VALUE;
+        return false;
+    }
+#else
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    trace->mapping = mapping;
+#endif
+
+    trace->mapping_size = size;
+    trace->header = (TraceFileHeader*)trace->mapping;
+    trace->records = (TraceRecord*)(trace->header + 1);
+    trace->mask = records - 1;
+    memcpy(trace->header->magic, TRACE_MAGIC, sizeof(trace->header->magic));
+    trace->header->record_size = sizeof(TraceRecord);
+    trace->header->capacity = records;
+    trace->header->written = 0;
+    return true;
+}
+
+void closeTrace(TraceBuffer* trace) {
+    if (trace->mapping == nullptr) {
+        return;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    FlushViewOfFile(trace->mapping, 0);
+    UnmapViewOfFile(trace->mapping);
+    CloseHandle(trace->file_mapping);
+    CloseHandle(trace->file);
+    trace->file = INVALID_HANDLE_VALUE;
+    trace->file_mapping = NULL;
+#else
+    munmap(trace->mapping, trace->mapping_size);
+#endif
+    trace->mapping = nullptr;
+    trace->header = nullptr;
+    trace->records = nullptr;
+}
+
+void attachTrace(State8080* cpu, TraceBuffer* trace) {
+    cpu->trace = trace;
+}
+
+void detachTrace(State8080* cpu) {
+    cpu->trace = nullptr;
+}
+
+void setTraceRange(TraceBuffer* trace, uint16_t start, uint16_t end) {
+    if (end < start) {
+        uint16_t swap = start;
+        start = end;
+        end = swap;
+    }
+    trace->range_start = start;
+    trace->range_span = end - start;
+}
+
+void setTraceTrigger(TraceBuffer* trace, uint16_t pc, uint64_t count) {
+    trace->trigger_pc = pc;
+    trace->triggered = false;
+    trace->remaining = count;
+}
+
+bool mapFile(MappedFile* mapped, const char* path) {
+#if defined(_WIN32) || defined(_WIN64)
+    mapped->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mapped->file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mapped->file, &size) || size.QuadPart == 0) {
+        CloseHandle(mapped->file);
+        mapped->file = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    mapped->file_mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    mapped->data = mapped->file_mapping ? (const uint8_t*)MapViewOfFile(mapped->file_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapped->data == nullptr) {
+        if (mapped->file_mapping) CloseHandle(mapped->file_mapping);
+        CloseHandle(mapped->file);
+        mapped->file = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    mapped->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+    mapped->data = (const uint8_t*)data;
+    mapped->size = (size_t)info.st_size;
+#endif
+    return true;
+}
+
+void unmapFile(MappedFile* mapped) {
+    if (mapped->data == nullptr) {
+        return;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    UnmapViewOfFile(mapped->data);
+    CloseHandle(mapped->file_mapping);
+    CloseHandle(mapped->file);
+    mapped->file = INVALID_HANDLE_VALUE;
+    mapped->file_mapping = NULL;
+#else
+    munmap((void*)mapped->data, mapped->size);
+#endif
+    mapped->data = nullptr;
+    mapped->size = 0;
+}
+
+bool openTraceView(TraceView* view, const char* path) {
+    if (!mapFile(&view->file, path)) {
+        return false;
+    }
+    const TraceFileHeader* header = (const TraceFileHeader*)view->file.data;
+    bool ok = view->file.size >= sizeof(TraceFileHeader)
+        && memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) == 0
+        && header->record_size == sizeof(TraceRecord)
+        && header->capacity != 0 && (header->capacity & (header->capacity - 1)) == 0
+        && view->file.size >= sizeof(TraceFileHeader) + (size_t)header->capacity * sizeof(TraceRecord);
+    if (!ok) {
+        unmapFile(&view->file);
+        return false;
+    }
+    view->header = header;
+    view->records = (const TraceRecord*)(header + 1);
+    view->written = header->written;
+    view->first = header->written > header->capacity ? header->written - header->capacity : 0;
+    return true;
+}
+
+void closeTraceView(TraceView* view) {
+    unmapFile(&view->file);
+    view->header = nullptr;
+    view->records = nullptr;
+}
+
+bool readTrace(const char* path, std::vector<TraceRecord>* records, uint64_t* written) {
+    TraceView view;
+    if (!openTraceView(&view, path)) {
+        return false;
+    }
+    records->resize((size_t)(view.written - view.first));
+    for (uint64_t n = view.first; n < view.written; n++) {
+        (*records)[(size_t)(n - view.first)] = *traceRecordAt(&view, n);
+    }
+    *written = view.written;
+    closeTraceView(&view);
+    return true;
+}
+
+FILE* createHashStream(const char* path) {
+    FILE* stream = fopen(path, "wb");
+    if (!stream) {
+        return nullptr;
+    }
+    HashStreamHeader header = {};
+    memcpy(header.magic, HASH_STREAM_MAGIC, sizeof(header.magic));
+    header.record_size = sizeof(HashStreamRecord);
+    if (fwrite(&header, sizeof(header), 1, stream) != 1) {
+        fclose(stream);
+        return nullptr;
+    }
+    return stream;
+}
+
+bool appendStateHash(FILE* stream, const State8080* cpu, uint32_t frame) {
+    HashStreamRecord record;
+    record.frame = frame;
+    record.hash = hashState(cpu);
+    record.instructions = cpu->trace ? cpu->trace->header->written : 0;
+    return fwrite(&record, sizeof(record), 1, stream) == 1;
+}
+
+bool openHashStreamView(HashStreamView* view, const char* path) {
+    if (!mapFile(&view->file, path)) {
+        return false;
+    }
+    const HashStreamHeader* header = (const HashStreamHeader*)view->file.data;
+    if (view->file.size < sizeof(HashStreamHeader)
+        || memcmp(header->magic, HASH_STREAM_MAGIC, sizeof(header->magic)) != 0
+        || header->record_size != sizeof(HashStreamRecord)) {
+        unmapFile(&view->file);
+        return false;
+    }
+    view->records = (const HashStreamRecord*)(header + 1);
+    view->count = (view->file.size - sizeof(HashStreamHeader)) / sizeof(HashStreamRecord);
+    return true;
+}
+
+void closeHashStreamView(HashStreamView* view) {
+    unmapFile(&view->file);
+    view->records = nullptr;
+    view->count = 0;
+}
+
+void printTraceRecord(FILE* out, uint64_t index, const TraceRecord* record, const TraceRecord* next) {
+    // The disassembler reads the instruction at its real address
+    static unsigned char image[0x10000 + 2];
+    memcpy(image + record->pc, record->code, 3);
+
+    fprintf(out, "%10llu  a=%02x f=%02x bc=%02x%02x de=%02x%02x hl=%02x%02x sp=%04x",
+        (unsigned long long)index, record->a, record->f, record->b, record->c,
+        record->d, record->e, record->h, record->l, record->sp);
+    if (next) {
+        fprintf(out, " +%-3u ", (uint8_t)(next->cycles - record->cycles));
+    }
+    else {
+        fprintf(out, "      ");
+    }
+    Disassemble8080Op(out, image, record->pc);
+}
+
+uint64_t findTraceDivergence(const TraceView* a, uint64_t start_a, const TraceView* b, uint64_t start_b, uint64_t count) {
+    const uint64_t CHUNK = 1 << 16;
+    uint64_t offset = 0;
+    while (offset < count) {
+        // Largest run that is contiguous in both rings
+        uint64_t index_a = (start_a + offset) & (a->header->capacity - 1);
+        uint64_t index_b = (start_b + offset) & (b->header->capacity - 1);
+        uint64_t run = count - offset;
+        run = run < CHUNK ? run : CHUNK;
+        run = run < a->header->capacity - index_a ? run : a->header->capacity - index_a;
+        run = run < b->header->capacity - index_b ? run : b->header->capacity - index_b;
+
+        const TraceRecord* ra = a->records + index_a;
+        const TraceRecord* rb = b->records + index_b;
+        if (memcmp(ra, rb, (size_t)run * sizeof(TraceRecord)) != 0) {
+            for (uint64_t i = 0; i < run; i++) {
+                if (memcmp(&ra[i], &rb[i], sizeof(TraceRecord)) != 0) {
+                    return offset + i;
+                }
+            }
+        }
+        offset += run;
+    }
+    return count;
+}
+
+uint64_t findHashDivergence(const HashStreamRecord* a, const HashStreamRecord* b, uint64_t count) {
+    auto differs = [&](uint64_t i) { return a[i].hash != b[i].hash; };
+
+    if (count == 0 || differs(0)) {
+        return 0;
+    }
+    // Gallop to a differing record, keeping the last matching one in {lo}
+    uint64_t lo = 0, hi, step = 1;
+    for (;;) {
+        hi = lo + step < count ? lo + step : count - 1;
+        if (differs(hi)) {
+            break;
+        }
+        if (hi == count - 1) {
+            return count;
+        }
+        lo = hi;
+        step *= 2;
+    }
+    // lo matches, hi differs: binary search for the boundary
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (differs(mid)) hi = mid;
+        else lo = mid;
+    }
+    return hi;
+}
@@ -0,0 +1,264 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "initcpu.h"
+#include "emulator.h"
+#include "pagetable.h"
+#include "debugger.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define TRACE_MAGIC "SITRACE1"
+#define HASH_STREAM_MAGIC "SIHASH01"
+#define TRACE_DEFAULT_RECORDS (1u << 20) // 16 MB of history
+
+/*
+ * Binary instruction trace.
+ *
+ * While a trace is attached, runFrame writes one 16 byte TraceRecord per
+ * instruction into a ring buffer that is mmap'd straight onto the trace
+ * file. The record is a handful of byte stores, so tracing costs
+ * nanoseconds per instruction where the DEBUG printf costs microseconds.
+ * Like the debugger check, it lives in runFrame's instrumented loop, so
+ * Emulate8080Op pays nothing when no trace is attached. The file always holds the
+ * latest records, even if the process dies, and the decoder
+ * (trace_tool.cpp) renders them as text with the disassembler.
+ *
+ * File layout: TraceFileHeader, then {capacity} records. Record n of the
+ * run is at index n & (capacity - 1); header.written counts all of them.
+ *
+ * A state hash stream is the coarse companion used to find where two
+ * runs diverge (see tracediff_tool.cpp): HashStreamHeader, then one
+ * HashStreamRecord per frame.
+ */
+
+struct TraceRecord {
+    uint16_t pc;
+    uint8_t code[3];    // opcode and operand bytes as fetched
+    uint8_t cycles;     // low byte of cpu->cycles before the instruction
+    uint8_t a;
+    uint8_t f;          // PSW flags byte, see packFlags
+    uint8_t b, c, d, e, h, l;
+    uint16_t sp;
+};
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord must stay 16 bytes");
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t capacity;      // power of two
+    uint64_t written;       // records written so far, including overwritten ones
+    uint64_t reserved;
+};
+
+struct TraceBuffer {
+    TraceFileHeader* header = nullptr;
+    TraceRecord* records = nullptr;
+    uint32_t mask = 0;
+
+    // Filters: only pcs in [range_start, range_start + range_span] are
+    // recorded, none before the trigger pc is reached, and recording stops
+    // (the trace detaches itself) after {remaining} records if nonzero.
+    uint16_t range_start = 0;
+    uint16_t range_span = 0xFFFF;
+    uint16_t trigger_pc = 0;
+    bool triggered = true;
+    uint64_t remaining = 0;
+
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE file_mapping = NULL;
+#endif
+};
+
+/**
+* Creates (or truncates) {path} and maps a ring of {capacity} records onto it.
+*
+* @param capacity Rounded up to a power of two.
+* @return false if the file could not be created or mapped.
+*/
+bool openTrace(TraceBuffer* trace, const char* path, uint32_t capacity = TRACE_DEFAULT_RECORDS);
+
+/**
+* Unmaps the ring; the file keeps the records. Detach first.
+*/
+void closeTrace(TraceBuffer* trace);
+
+void attachTrace(State8080* cpu, TraceBuffer* trace);
+
+void detachTrace(State8080* cpu);
+
+/**
+* Records only instructions at pcs in [start, end].
+*/
+void setTraceRange(TraceBuffer* trace, uint16_t start, uint16_t end);
+
+/**
+* Starts recording when the CPU reaches {pc}, then records {count}
+* instructions (0 for no limit).
+*/
+void setTraceTrigger(TraceBuffer* trace, uint16_t pc, uint64_t count);
+
+/**
+* Records the instruction at cpu->pc, before it runs. Called by runFrame
+* and stepInstruction while a trace is attached.
+*/
+inline void traceInstruction(State8080* cpu) {
+    TraceBuffer* trace = cpu->trace;
+    if ((uint16_t)(cpu->pc - trace->range_start) > trace->range_span) {
+        return;
+    }
+    if (!trace->triggered) {
+        if (cpu->pc != trace->trigger_pc) {
+            return;
+        }
+        trace->triggered = true;
+    }
+    TraceRecord* record = &trace->records[trace->header->written++ & trace->mask];
+    record->pc = cpu->pc;
+    const uint8_t* page = cpu->pages.read[cpu->pc >> PAGE_SHIFT];
+    uint8_t offset = cpu->pc & (PAGE_SIZE - 1);
+    if (page && offset <= PAGE_SIZE - 3) {
+        memcpy(record->code, page + offset, 3);
+    }
+    else {
+        for (int i = 0; i < 3; i++) {
+            record->code[i] = peekMemory(cpu, (uint16_t)(cpu->pc + i));
+        }
+    }
+    record->cycles = (uint8_t)cpu->cycles;
+    record->a = cpu->a;
+    record->f = packFlags(cpu);
+    record->b = cpu->b;
+    record->c = cpu->c;
+    record->d = cpu->d;
+    record->e = cpu->e;
+    record->h = cpu->h;
+    record->l = cpu->l;
+    record->sp = cpu->sp;
+    if (trace->remaining && --trace->remaining == 0) {
+        cpu->trace = nullptr;
+    }
+}
+
+struct HashStreamHeader {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+struct HashStreamRecord {
+    uint32_t frame;
+    uint32_t hash;          // hashState at the start of the frame
+    uint64_t instructions;  // records written to the attached trace so far, 0 without one
+};
+
+/**
+* Read-only mapping of a whole file.
+*/
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE file_mapping = NULL;
+#endif
+};
+
+bool mapFile(MappedFile* mapped, const char* path);
+
+void unmapFile(MappedFile* mapped);
+
+/**
+* A trace file mapped for reading, so traces of any size open instantly.
+*/
+struct TraceView {
+    MappedFile file;
+    const TraceFileHeader* header = nullptr;
+    const TraceRecord* records = nullptr;
+    uint64_t first = 0;     // oldest record number still in the ring
+    uint64_t written = 0;   // one past the newest record number
+};
+
+/**
+* @return false if the file is missing, truncated or not a trace.
+*/
+bool openTraceView(TraceView* view, const char* path);
+
+void closeTraceView(TraceView* view);
+
+/**
+* @param n Record number in [view->first, view->written).
+*/
+inline const TraceRecord* traceRecordAt(const TraceView* view, uint64_t n) {
+    return &view->records[n & (view->header->capacity - 1)];
+}
+
+/**
+* Reads the records still in the ring of a trace file, oldest first.
+*
+* @param written Set to the number of records the run wrote; the first
+*        record returned is number written - records->size().
+* @return false if the file is missing, truncated or not a trace.
+*/
+bool readTrace(const char* path, std::vector<TraceRecord>* records, uint64_t* written);
+
+/**
+* Finds the first of {count} records in {a} and {b} that differ.
+* Compares in large memcmp chunks over the mapped rings, so multi-GB
+* traces take seconds.
+*
+* @param start_a Record number in {a} to start from; likewise {start_b}.
+* @return offset from the starts of the first difference, or {count}.
+*/
+uint64_t findTraceDivergence(const TraceView* a, uint64_t start_a, const TraceView* b, uint64_t start_b, uint64_t count);
+
+/**
+* Finds the first frame whose state hashes differ. Gallops forward over
+* 1, 2, 4, ... records, then binary searches the last step, so only
+* O(log count) records are read. Assumes runs that diverged stay
+* diverged, which holds in practice because the hash covers all of RAM.
+*
+* @return index of the first differing record, or {count}.
+*/
+uint64_t findHashDivergence(const HashStreamRecord* a, const HashStreamRecord* b, uint64_t count);
+
+/**
+* Creates a hash stream file.
+*
+* @return nullptr if it could not be created.
+*/
+FILE* createHashStream(const char* path);
+
+/**
+* Appends the hash of {cpu} and the instruction count of its attached
+* trace. Call at the same point of every frame, e.g. from a FrameCallback.
+*/
+bool appendStateHash(FILE* stream, const State8080* cpu, uint32_t frame);
+
+struct HashStreamView {
+    MappedFile file;
+    const HashStreamRecord* records = nullptr;
+    uint64_t count = 0;
+};
+
+/**
+* @return false if the file is missing or not a hash stream.
+*/
+bool openHashStreamView(HashStreamView* view, const char* path);
+
+void closeHashStreamView(HashStreamView* view);
+
+/**
+* Prints {record} as "n  registers  pc: opcode: MNEMONIC operands".
+*
+* @param index Record number in the run.
+* @param next The record after it, for the cycles until that instruction; may be null.
+*/
+void printTraceRecord(FILE* out, uint64_t index, const TraceRecord* record, const TraceRecord* next);
+
+#endif
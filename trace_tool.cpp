@@ -0,0 +1,69 @@
+/*
+ * Renders a binary instruction trace as text:
+ *
+ * ./SpaceInvadersHeadless ./path/to/invaders --frames 600 --trace run.trace --trace-range 0000-1fff
+ *
+ * ./SpaceInvadersTrace run.trace [--last N] [--range START-END]
+ *
+ * One line per instruction: record number, registers and flags before
+ * the instruction, cycles until the next record, then the disassembly.
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "trace.h"
+
+static void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " <trace> [--last N] [--range START-END]\n";
+}
+
+/**
+   Entry point for the trace decoder.
+
+   @param argc - argument count
+   @param argv - argument vector (expects the trace file path as argv[1])
+   @return 0 on success, 1 on failure
+*/
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    uint64_t last = 0;
+    unsigned long start = 0, end = 0xFFFF;
+    for (int i = 2; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--last") && has_value) last = strtoull(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--range") && has_value) {
+            char* dash;
+            start = strtoul(argv[++i], &dash, 16);
+            end = (*dash == '-') ? strtoul(dash + 1, nullptr, 16) : start;
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    TraceView view;
+    if (!openTraceView(&view, argv[1])) {
+        std::cerr << "Failed to read trace file " << argv[1] << std::endl;
+        return 1;
+    }
+    uint64_t from = (last && last < view.written - view.first) ? view.written - last : view.first;
+    for (uint64_t n = from; n < view.written; n++) {
+        const TraceRecord* record = traceRecordAt(&view, n);
+        if (record->pc < start || record->pc > end) {
+            continue;
+        }
+        printTraceRecord(stdout, n, record, n + 1 < view.written ? traceRecordAt(&view, n + 1) : nullptr);
+    }
+    if (view.first > 0) {
+        fprintf(stderr, "%llu older records were overwritten\n", (unsigned long long)view.first);
+    }
+    closeTraceView(&view);
+    return 0;
+}
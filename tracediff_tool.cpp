@@ -0,0 +1,182 @@
+/*
+ * Finds where two runs diverge, e.g. before and after a core change:
+ *
+ * ./SpaceInvadersHeadless ./path/to/invaders --autostart --frames 50000 --hash-stream a.hashes --trace a.trace --trace-size 268435456
+ * (same again with the other build into b.hashes / b.trace)
+ *
+ * ./SpaceInvadersTraceDiff a.hashes b.hashes [--traces a.trace b.trace] [--context N]
+ * ./SpaceInvadersTraceDiff a.trace b.trace [--context N]
+ *
+ * With hash streams the first differing frame is found by a galloping
+ * search; --traces then compares the instructions of the frame before it
+ * to find the exact instruction. Two traces are compared directly, record
+ * by record. Either way both sides are printed around the divergence with
+ * disassembly.
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "trace.h"
+
+static void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " <a.hashes> <b.hashes> [--traces <a.trace> <b.trace>] [--context N]\n"
+        << "       " << argv0 << " <a.trace> <b.trace> [--context N]\n";
+}
+
+/**
+* Lists the fields in which two records differ.
+*/
+static void printFieldDifferences(const TraceRecord* a, const TraceRecord* b) {
+    printf("differs in:");
+    if (a->pc != b->pc) printf(" pc");
+    if (memcmp(a->code, b->code, sizeof(a->code))) printf(" opcode");
+    if (a->cycles != b->cycles) printf(" cycles");
+    if (a->a != b->a) printf(" a");
+    if (a->f != b->f) printf(" flags");
+    if (a->b != b->b || a->c != b->c) printf(" bc");
+    if (a->d != b->d || a->e != b->e) printf(" de");
+    if (a->h != b->h || a->l != b->l) printf(" hl");
+    if (a->sp != b->sp) printf(" sp");
+    printf("\n");
+}
+
+/**
+* Prints the shared history before records {na} / {nb}, then both sides
+* from there on.
+*/
+static void printDivergence(const TraceView* a, uint64_t na, const TraceView* b, uint64_t nb, uint64_t context) {
+    uint64_t shared = context;
+    shared = (na - a->first < shared) ? na - a->first : shared;
+    shared = (nb - b->first < shared) ? nb - b->first : shared;
+    printf("\nshared history:\n");
+    for (uint64_t i = shared; i > 0; i--) {
+        printTraceRecord(stdout, na - i, traceRecordAt(a, na - i), traceRecordAt(a, na - i + 1));
+    }
+    const TraceView* views[] = { a, b };
+    const uint64_t starts[] = { na, nb };
+    for (int side = 0; side < 2; side++) {
+        printf("\n%c:\n", 'a' + side);
+        const TraceView* view = views[side];
+        for (uint64_t n = starts[side]; n < view->written && n <= starts[side] + context; n++) {
+            printTraceRecord(stdout, n, traceRecordAt(view, n), n + 1 < view->written ? traceRecordAt(view, n + 1) : nullptr);
+        }
+    }
+    printf("\n");
+    printFieldDifferences(traceRecordAt(a, na), traceRecordAt(b, nb));
+}
+
+/**
+* Compares two traces from record numbers {start_a} / {start_b}.
+*
+* @return 0 if they match, 2 if they diverge, 1 on error.
+*/
+static int diffTraces(const TraceView* a, uint64_t start_a, const TraceView* b, uint64_t start_b, uint64_t context) {
+    if (start_a < a->first || start_b < b->first || start_a > a->written || start_b > b->written) {
+        std::cerr << "Records " << start_a << " / " << start_b
+            << " were overwritten in the trace rings; rerun with a larger --trace-size" << std::endl;
+        return 1;
+    }
+    uint64_t count = a->written - start_a;
+    count = (b->written - start_b < count) ? b->written - start_b : count;
+    uint64_t offset = findTraceDivergence(a, start_a, b, start_b, count);
+    if (offset == count) {
+        printf("traces match for %llu records", (unsigned long long)count);
+        if (a->written - start_a != b->written - start_b) {
+            printf(", then one ends");
+        }
+        printf("\n");
+        return a->written - start_a == b->written - start_b ? 0 : 2;
+    }
+    printf("first differing instruction: record %llu of a, %llu of b\n",
+        (unsigned long long)(start_a + offset), (unsigned long long)(start_b + offset));
+    printDivergence(a, start_a + offset, b, start_b + offset, context);
+    return 2;
+}
+
+static int diffHashStreams(const char* path_a, const char* path_b, const char* trace_a, const char* trace_b, uint64_t context) {
+    HashStreamView a, b;
+    if (!openHashStreamView(&a, path_a) || !openHashStreamView(&b, path_b)) {
+        std::cerr << "Failed to read hash streams " << path_a << " / " << path_b << std::endl;
+        return 1;
+    }
+    uint64_t count = a.count < b.count ? a.count : b.count;
+    uint64_t frame = findHashDivergence(a.records, b.records, count);
+    if (frame == count) {
+        printf("state hashes match for %llu frames%s\n", (unsigned long long)count, a.count != b.count ? ", then one ends" : "");
+        closeHashStreamView(&a);
+        closeHashStreamView(&b);
+        return a.count == b.count ? 0 : 2;
+    }
+    const HashStreamRecord& ra = a.records[frame];
+    const HashStreamRecord& rb = b.records[frame];
+    printf("state hashes diverge at the start of frame %u (a=%08x b=%08x)\n", ra.frame, ra.hash, rb.hash);
+    int result = 2;
+    if (frame == 0) {
+        printf("the runs differ from the first frame: check the ROM and options\n");
+    }
+    else if (trace_a) {
+        // Divergence happened during the last matching frame
+        TraceView ta, tb;
+        if (!openTraceView(&ta, trace_a) || !openTraceView(&tb, trace_b)) {
+            std::cerr << "Failed to read traces " << trace_a << " / " << trace_b << std::endl;
+            result = 1;
+        }
+        else {
+            printf("frame %u starts at record %llu of a, %llu of b\n", a.records[frame - 1].frame,
+                (unsigned long long)a.records[frame - 1].instructions, (unsigned long long)b.records[frame - 1].instructions);
+            int traced = diffTraces(&ta, a.records[frame - 1].instructions, &tb, b.records[frame - 1].instructions, context);
+            result = traced == 1 ? 1 : 2;
+            closeTraceView(&ta);
+            closeTraceView(&tb);
+        }
+    }
+    closeHashStreamView(&a);
+    closeHashStreamView(&b);
+    return result;
+}
+
+/**
+   Entry point for the trace diff tool.
+
+   @param argc - argument count
+   @param argv - argument vector (expects two trace or hash stream paths)
+   @return 0 if the runs match, 2 if they diverge, 1 on error
+*/
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const char* trace_a = nullptr;
+    const char* trace_b = nullptr;
+    uint64_t context = 8;
+    for (int i = 3; i < argc; ++i) {
+        if (!strcmp(argv[i], "--traces") && i + 2 < argc) {
+            trace_a = argv[++i];
+            trace_b = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--context") && i + 1 < argc) context = strtoull(argv[++i], nullptr, 0);
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    TraceView a, b;
+    if (openTraceView(&a, argv[1])) {
+        if (!openTraceView(&b, argv[2])) {
+            std::cerr << "Failed to read trace file " << argv[2] << std::endl;
+            return 1;
+        }
+        // Align on record numbers; both runs start at record 0
+        uint64_t start = a.first > b.first ? a.first : b.first;
+        int result = diffTraces(&a, start, &b, start, context);
+        closeTraceView(&a);
+        closeTraceView(&b);
+        return result;
+    }
+    return diffHashStreams(argv[1], argv[2], trace_a, trace_b, context);
+}
@@ -0,0 +1,375 @@
+#include "trajectory.h"
+#include <cstring>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#define TRAJECTORY_TRAILER_MAGIC "SITRAJIX"
+
+static void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t* v) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+* XORs each frame with the one before it, then encodes the result as
+* varint tokens: (length << 1 | 1) for a run of zero bytes, (length << 1)
+* followed by {length} literal bytes otherwise.
+*/
+static void compressChunk(const std::vector<uint8_t>& raw, uint32_t frame_size, std::vector<uint8_t>& out) {
+    size_t n = raw.size();
+    std::vector<uint8_t> delta(raw);
+    for (size_t i = n; i-- > frame_size;) {
+        delta[i] ^= raw[i - frame_size];
+    }
+
+    out.clear();
+    const uint8_t* d = delta.data();
+    size_t i = 0;
+    while (i < n) {
+        size_t z = i;
+        while (z < n && d[z] == 0) z++;
+        if (z - i >= 2 || z == n) {
+            putVarint(out, ((uint64_t)(z - i) << 1) | 1);
+            i = z;
+            continue;
+        }
+        size_t j = i;
+        while (j < n && !(d[j] == 0 && (j + 1 == n || d[j + 1] == 0))) j++;
+        putVarint(out, (uint64_t)(j - i) << 1);
+        out.insert(out.end(), d + i, d + j);
+        i = j;
+    }
+}
+
+static bool decompressChunk(const uint8_t* p, const uint8_t* end, uint32_t frame_size, std::vector<uint8_t>& raw) {
+    size_t n = raw.size();
+    size_t i = 0;
+    while (i < n) {
+        uint64_t token;
+        if (!getVarint(p, end, &token)) {
+            return false;
+        }
+        uint64_t len = token >> 1;
+        if (len > n - i) {
+            return false;
+        }
+        if (token & 1) {
+            memset(&raw[i], 0, len);
+        } else {
+            if (len > (uint64_t)(end - p)) {
+                return false;
+            }
+            memcpy(&raw[i], p, len);
+            p += len;
+        }
+        i += len;
+    }
+    for (size_t k = frame_size; k < n; k++) {
+        raw[k] ^= raw[k - frame_size];
+    }
+    return true;
+}
+
+static void compressionWorker(TrajectoryWriter* writer) {
+    std::vector<uint8_t> packed;
+    for (;;) {
+        std::pair<uint32_t, std::vector<uint8_t>> job;
+        {
+            std::unique_lock<std::mutex> guard(writer->lock);
+            writer->wake.wait(guard, [writer] { return writer->closing || !writer->pending.empty(); });
+            if (writer->pending.empty()) {
+                return;
+            }
+            job = std::move(writer->pending.front());
+            writer->pending.pop_front();
+        }
+
+        uint32_t frame_size = writer->header.frame_size;
+        compressChunk(job.second, frame_size, packed);
+
+        TrajectoryChunkHeader chunk = {};
+        chunk.first_frame = job.first;
+        chunk.frame_count = (uint32_t)(job.second.size() / frame_size);
+        chunk.compressed_size = (uint32_t)packed.size();
+
+        TrajectoryIndexEntry entry = {};
+        entry.offset = (uint64_t)ftell(writer->file);
+        entry.first_frame = chunk.first_frame;
+        entry.frame_count = chunk.frame_count;
+        bool ok = fwrite(&chunk, sizeof(chunk), 1, writer->file) == 1
+            && fwrite(packed.data(), 1, packed.size(), writer->file) == packed.size();
+
+        std::lock_guard<std::mutex> guard(writer->lock);
+        writer->index.push_back(entry);
+        writer->failed |= !ok;
+        job.second.clear();
+        writer->spare.push_back(std::move(job.second));
+    }
+}
+
+bool openTrajectory(TrajectoryWriter* writer, const char* path, uint16_t ram_start, uint16_t ram_size, uint32_t chunk_frames) {
+    if ((uint32_t)ram_start + ram_size > 0x10000 || chunk_frames == 0) {
+        return false;
+    }
+    writer->file = fopen(path, "wb");
+    if (writer->file == nullptr) {
+        return false;
+    }
+
+    memcpy(writer->header.magic, TRAJECTORY_MAGIC, sizeof(writer->header.magic));
+    writer->header.version = TRAJECTORY_VERSION;
+    writer->header.chunk_frames = chunk_frames;
+    writer->header.ram_start = ram_start;
+    writer->header.ram_size = ram_size;
+    writer->header.frame_size = 1 + TRAJECTORY_VRAM_SIZE + ram_size;
+    if (fwrite(&writer->header, sizeof(writer->header), 1, writer->file) != 1) {
+        fclose(writer->file);
+        writer->file = nullptr;
+        return false;
+    }
+
+    writer->chunk.reserve((size_t)chunk_frames * writer->header.frame_size);
+    writer->closing = false;
+    writer->failed = false;
+    writer->worker = std::thread(compressionWorker, writer);
+    return true;
+}
+
+static void submitChunk(TrajectoryWriter* writer) {
+    std::vector<uint8_t> next;
+    {
+        std::lock_guard<std::mutex> guard(writer->lock);
+        writer->pending.emplace_back(writer->chunk_first_frame, std::move(writer->chunk));
+        if (!writer->spare.empty()) {
+            next = std::move(writer->spare.back());
+            writer->spare.pop_back();
+        }
+    }
+    writer->wake.notify_one();
+    writer->chunk = std::move(next);
+    writer->chunk.reserve((size_t)writer->header.chunk_frames * writer->header.frame_size);
+}
+
+void appendTrajectoryFrame(TrajectoryWriter* writer, const State8080* state, uint8_t port1) {
+    uint32_t frame_size = writer->header.frame_size;
+    if (writer->chunk.empty()) {
+        writer->chunk_first_frame = writer->frame_count;
+    }
+    size_t at = writer->chunk.size();
+    writer->chunk.resize(at + frame_size);
+
+    uint8_t* frame = &writer->chunk[at];
+    frame[0] = port1;
+    memcpy(frame + 1, state->memory + TRAJECTORY_VRAM_START, TRAJECTORY_VRAM_SIZE);
+    memcpy(frame + 1 + TRAJECTORY_VRAM_SIZE, state->memory + writer->header.ram_start, writer->header.ram_size);
+    writer->frame_count++;
+
+    if (writer->chunk.size() == (size_t)writer->header.chunk_frames * frame_size) {
+        submitChunk(writer);
+    }
+}
+
+static void stopWorker(TrajectoryWriter* writer) {
+    if (!writer->worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(writer->lock);
+        writer->closing = true;
+    }
+    writer->wake.notify_one();
+    writer->worker.join();
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    stopWorker(this);
+    if (file) {
+        fclose(file);
+    }
+}
+
+bool closeTrajectory(TrajectoryWriter* writer) {
+    if (writer->file == nullptr) {
+        return false;
+    }
+    if (!writer->chunk.empty()) {
+        submitChunk(writer);
+    }
+    stopWorker(writer);
+
+    TrajectoryTrailer trailer = {};
+    trailer.index_offset = (uint64_t)ftell(writer->file);
+    trailer.chunk_count = (uint32_t)writer->index.size();
+    trailer.frame_count = writer->frame_count;
+    memcpy(trailer.magic, TRAJECTORY_TRAILER_MAGIC, sizeof(trailer.magic));
+
+    bool ok = !writer->failed
+        && fwrite(writer->index.data(), sizeof(TrajectoryIndexEntry), writer->index.size(), writer->file) == writer->index.size()
+        && fwrite(&trailer, sizeof(trailer), 1, writer->file) == 1;
+    ok &= fclose(writer->file) == 0;
+    writer->file = nullptr;
+    return ok;
+}
+
+bool openTrajectoryReader(TrajectoryReader* reader, const char* path) {
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE map = NULL;
+    if (!GetFileSizeEx(file, &size) || (map = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+    reader->data = (const uint8_t*)MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    if (reader->data == NULL) {
+        CloseHandle(map);
+        CloseHandle(file);
+        return false;
+    }
+    reader->file_handle = file;
+    reader->map_handle = map;
+    reader->size = (size_t)size.QuadPart;
+#else
+    reader->fd = open(path, O_RDONLY);
+    if (reader->fd == -1) {
+        return false;
+    }
+    struct stat statbuf;
+    if (fstat(reader->fd, &statbuf) == -1 || statbuf.st_size == 0) {
+        close(reader->fd);
+        reader->fd = -1;
+        return false;
+    }
+    void* data = mmap(NULL, statbuf.st_size, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if (data == MAP_FAILED) {
+        close(reader->fd);
+        reader->fd = -1;
+        return false;
+    }
+    reader->data = (const uint8_t*)data;
+    reader->size = statbuf.st_size;
+#endif
+
+    TrajectoryTrailer trailer;
+    if (reader->size < sizeof(TrajectoryFileHeader) + sizeof(trailer)) {
+        closeTrajectoryReader(reader);
+        return false;
+    }
+    memcpy(&reader->header, reader->data, sizeof(reader->header));
+    memcpy(&trailer, reader->data + reader->size - sizeof(trailer), sizeof(trailer));
+
+    bool valid = !memcmp(reader->header.magic, TRAJECTORY_MAGIC, sizeof(reader->header.magic))
+        && reader->header.version == TRAJECTORY_VERSION
+        && reader->header.frame_size == 1 + TRAJECTORY_VRAM_SIZE + reader->header.ram_size
+        && !memcmp(trailer.magic, TRAJECTORY_TRAILER_MAGIC, sizeof(trailer.magic))
+        && trailer.index_offset + (uint64_t)trailer.chunk_count * sizeof(TrajectoryIndexEntry) + sizeof(trailer) == reader->size
+        && (trailer.chunk_count > 0 || trailer.frame_count == 0);
+    if (!valid) {
+        closeTrajectoryReader(reader);
+        return false;
+    }
+
+    reader->index = reader->data + trailer.index_offset;
+    reader->chunk_count = trailer.chunk_count;
+    reader->frame_count = trailer.frame_count;
+    reader->cached_chunk = -1;
+    return true;
+}
+
+/**
+* Index entry {chunk}. The index follows variable size chunks, so it can
+* sit at any offset and is copied out rather than dereferenced.
+*/
+static TrajectoryIndexEntry indexEntry(const TrajectoryReader* reader, uint32_t chunk) {
+    TrajectoryIndexEntry entry;
+    memcpy(&entry, reader->index + (size_t)chunk * sizeof(entry), sizeof(entry));
+    return entry;
+}
+
+bool readTrajectoryFrame(TrajectoryReader* reader, uint32_t frame, uint8_t* port1, uint8_t* vram, uint8_t* ram) {
+    if (frame >= reader->frame_count) {
+        return false;
+    }
+
+    // Chunks are written in order, so the index is sorted by first_frame
+    uint32_t lo = 0, hi = reader->chunk_count;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (indexEntry(reader, mid).first_frame <= frame) lo = mid;
+        else hi = mid;
+    }
+    TrajectoryIndexEntry entry = indexEntry(reader, lo);
+    if (frame < entry.first_frame || frame - entry.first_frame >= entry.frame_count) {
+        return false;
+    }
+
+    uint32_t frame_size = reader->header.frame_size;
+    if (reader->cached_chunk != lo) {
+        TrajectoryChunkHeader chunk;
+        if (entry.offset + sizeof(chunk) > reader->size) {
+            return false;
+        }
+        memcpy(&chunk, reader->data + entry.offset, sizeof(chunk));
+        const uint8_t* payload = reader->data + entry.offset + sizeof(chunk);
+        if (entry.offset + sizeof(chunk) + chunk.compressed_size > reader->size
+            || chunk.first_frame != entry.first_frame || chunk.frame_count != entry.frame_count) {
+            return false;
+        }
+        reader->cache.resize((size_t)chunk.frame_count * frame_size);
+        if (!decompressChunk(payload, payload + chunk.compressed_size, frame_size, reader->cache)) {
+            reader->cached_chunk = -1;
+            return false;
+        }
+        reader->cached_chunk = lo;
+    }
+
+    const uint8_t* data = &reader->cache[(size_t)(frame - entry.first_frame) * frame_size];
+    if (port1) *port1 = data[0];
+    if (vram) memcpy(vram, data + 1, TRAJECTORY_VRAM_SIZE);
+    if (ram) memcpy(ram, data + 1 + TRAJECTORY_VRAM_SIZE, reader->header.ram_size);
+    return true;
+}
+
+void closeTrajectoryReader(TrajectoryReader* reader) {
+#if defined(_WIN32) || defined(_WIN64)
+    if (reader->data) UnmapViewOfFile(reader->data);
+    if (reader->map_handle) CloseHandle(reader->map_handle);
+    if (reader->file_handle) CloseHandle(reader->file_handle);
+    reader->map_handle = nullptr;
+    reader->file_handle = nullptr;
+#else
+    if (reader->data) munmap((void*)reader->data, reader->size);
+    if (reader->fd != -1) close(reader->fd);
+    reader->fd = -1;
+#endif
+    reader->data = nullptr;
+    reader->index = nullptr;
+    reader->cache.clear();
+    reader->cached_chunk = -1;
+}
@@ -0,0 +1,156 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "initcpu.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#define TRAJECTORY_MAGIC "SITRAJ01"
+#define TRAJECTORY_VERSION 1
+#define TRAJECTORY_VRAM_START 0x2400
+#define TRAJECTORY_VRAM_SIZE 0x1C00 // 224 columns x 32 bytes, 1bpp rotated
+#define TRAJECTORY_DEFAULT_CHUNK_FRAMES 64
+
+/*
+ * File layout (all integers little endian):
+ *
+ *   TrajectoryFileHeader
+ *   chunk 0 .. chunk N-1         TrajectoryChunkHeader + compressed payload
+ *   TrajectoryIndexEntry[N]
+ *   TrajectoryTrailer
+ *
+ * A chunk holds up to chunk_frames frames. Each frame is the port 1 byte,
+ * VRAM and the selected RAM slice, XORed with the previous frame of the
+ * same chunk and zero-run-length encoded, so unchanged bytes cost almost
+ * nothing and any chunk decodes on its own.
+ */
+
+struct TrajectoryFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t chunk_frames;
+    uint32_t ram_start;
+    uint32_t ram_size;
+    uint32_t frame_size; // 1 + TRAJECTORY_VRAM_SIZE + ram_size
+    uint32_t reserved;
+};
+
+struct TrajectoryChunkHeader {
+    uint32_t first_frame;
+    uint32_t frame_count;
+    uint32_t compressed_size;
+    uint32_t reserved;
+};
+
+struct TrajectoryIndexEntry {
+    uint64_t offset; // of the chunk header
+    uint32_t first_frame;
+    uint32_t frame_count;
+};
+
+struct TrajectoryTrailer {
+    uint64_t index_offset;
+    uint32_t chunk_count;
+    uint32_t frame_count;
+    char magic[8];
+};
+
+/**
+* Append-only writer. Frames are packed on the caller's thread (one
+* 7 KB copy); compression and file I/O run on a background thread so
+* emulation never waits on the disk.
+*
+* A writer destroyed without closeTrajectory stops the thread and closes
+* the file without an index, which readers reject.
+*/
+struct TrajectoryWriter {
+    ~TrajectoryWriter();
+
+    FILE* file = nullptr;
+    TrajectoryFileHeader header = {};
+    std::vector<uint8_t> chunk;     // raw frames being filled
+    uint32_t chunk_first_frame = 0;
+    uint32_t frame_count = 0;
+
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<std::pair<uint32_t, std::vector<uint8_t>>> pending;
+    std::vector<std::vector<uint8_t>> spare;    // recycled chunk buffers
+    std::vector<TrajectoryIndexEntry> index;    // owned by the worker until close
+    bool closing = false;
+    bool failed = false;
+};
+
+/**
+* Creates {path} and starts the compression thread.
+*
+* @param ram_start First RAM address stored with each frame.
+* @param ram_size Number of RAM bytes stored with each frame (may be 0).
+* @param chunk_frames Frames per independently decodable chunk.
+* @return true on success.
+*/
+bool openTrajectory(TrajectoryWriter* writer, const char* path, uint16_t ram_start, uint16_t ram_size,
+    uint32_t chunk_frames = TRAJECTORY_DEFAULT_CHUNK_FRAMES);
+
+/**
+* Appends the current VRAM, the selected RAM and {port1}.
+*
+* @param state Pointer to a State8080 struct.
+* @param port1 Input byte applied for this frame.
+*/
+void appendTrajectoryFrame(TrajectoryWriter* writer, const State8080* state, uint8_t port1);
+
+/**
+* Flushes the last chunk, writes the index and closes the file.
+*
+* @return true if every chunk reached the disk; false if already closed.
+*/
+bool closeTrajectory(TrajectoryWriter* writer);
+
+/**
+* Read-only, mmap backed view of a trajectory file.
+*/
+struct TrajectoryReader {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    TrajectoryFileHeader header = {};
+    const uint8_t* index = nullptr;     // TrajectoryIndexEntry[chunk_count], not aligned: read with indexEntry
+    uint32_t chunk_count = 0;
+    uint32_t frame_count = 0;
+
+    // Last decoded chunk, so sequential reads decode each chunk once
+    int64_t cached_chunk = -1;
+    std::vector<uint8_t> cache;
+
+#if defined(_WIN32) || defined(_WIN64)
+    void* file_handle = nullptr;
+    void* map_handle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+/**
+* Maps {path} and validates its header and index.
+*
+* @return true on success.
+*/
+bool openTrajectoryReader(TrajectoryReader* reader, const char* path);
+
+/**
+* Decodes frame {frame}. {vram} receives TRAJECTORY_VRAM_SIZE bytes and
+* {ram} header.ram_size bytes; either may be null.
+*
+* @return false if {frame} is out of range or the file is corrupt.
+*/
+bool readTrajectoryFrame(TrajectoryReader* reader, uint32_t frame, uint8_t* port1, uint8_t* vram, uint8_t* ram);
+
+void closeTrajectoryReader(TrajectoryReader* reader);
+
+#endif